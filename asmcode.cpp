@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "errors.h"
+#include "growarray.h"
+#include "node.h"
+#include "flattree.h"
+#include "treeio.h"
+#include "asmcode.h"
+
+static const char* const OPCODE_NAMES[ASM_OPCODE_COUNT] =
+    {
+    "", "push", "pop", "add", "sub", "mul", "div", "pow",
+    "gt", "lt", "ge", "le", "eq", "ne", "and", "or", "not",
+    "sin", "cos", "sqrt", "in", "out",
+    "jmp", "je", "jne", "call", "ret", "nop",
+    "pushi", "popi"
+    };
+
+static const char* const LABEL_NAMES[] =
+    {
+    "func_", "func_guard_", "while_", "end_while_", "if_", "end_if_", "label_"
+    };
+
+static void  WriteLabelName(TextWriter* writer, const AsmLabel* label);
+
+Error_t AsmCodeCtor(AsmCode* code)
+    {
+    assert(code);
+
+    code->code              = nullptr;
+    code->size              = 0;
+    code->capacity          = 0;
+    code->labels            = nullptr;
+    code->label_count       = 0;
+    code->label_capacity    = 0;
+    code->functions         = nullptr;
+    code->function_capacity = 0;
+    code->if_count          = 0;
+    code->while_count       = 0;
+    code->error             = Ok;
+
+    return Ok;
+    }
+
+Error_t AsmCodeDtor(AsmCode* code)
+    {
+    assert(code);
+
+    free(code->code);
+    free(code->labels);
+    free(code->functions);
+
+    code->code              = nullptr;
+    code->labels            = nullptr;
+    code->functions         = nullptr;
+    code->size              = 0;
+    code->capacity          = 0;
+    code->label_count       = 0;
+    code->label_capacity    = 0;
+    code->function_capacity = 0;
+
+    return Ok;
+    }
+
+// Команды и метки удаляются, счётчики if/while остаются, чтобы имена меток
+// не повторялись в следующих кусках кода
+void AsmCodeClear(AsmCode* code)
+    {
+    assert(code);
+
+    code->size        = 0;
+    code->label_count = 0;
+
+    for (int i = 0; i < code->function_capacity; i++) code->functions[i] = NO_LABEL;
+    }
+
+void AsmEmit(AsmCode* code, const int opcode, const int kind, const int id)
+    {
+    assert(code);
+    assert(0 <= opcode && opcode < ASM_OPCODE_COUNT);
+
+    if (code->size == code->capacity)
+        {
+        Instruction* new_code = (Instruction*) GrowArray(code->code, &code->capacity, sizeof(Instruction), &code->error);
+        if (!new_code) return;
+        code->code = new_code;
+        }
+
+    Instruction* instruction = code->code + code->size++;
+    instruction->arg.val = 0;
+    instruction->arg.id  = id;
+    instruction->opcode  = (unsigned char) opcode;
+    instruction->kind    = (unsigned char) kind;
+    }
+
+void AsmEmitNumber(AsmCode* code, const double value)
+    {
+    assert(code);
+
+    AsmEmit(code, ASM_PUSH, ARG_NUMBER);
+    if (code->error == Ok) code->code[code->size - 1].arg.val = value;
+    }
+
+int AsmNewLabel(AsmCode* code, const int kind, const int number, const int order)
+    {
+    assert(code);
+
+    if (code->label_count == code->label_capacity)
+        {
+        AsmLabel* new_labels = (AsmLabel*) GrowArray(code->labels, &code->label_capacity, sizeof(AsmLabel), &code->error);
+        if (!new_labels) return NO_LABEL;
+        code->labels = new_labels;
+        }
+
+    code->labels[code->label_count] = {kind, number, order};
+
+    return code->label_count++;
+    }
+
+// У каждой функции одна метка func_N, сколько бы раз её ни вызывали
+int AsmFunctionLabel(AsmCode* code, const int id)
+    {
+    assert(code);
+    assert(id >= 0);
+
+    while (id >= code->function_capacity)
+        {
+        int  old_capacity  = code->function_capacity;
+        int* new_functions = (int*) GrowArray(code->functions, &code->function_capacity, sizeof(int), &code->error);
+        if (!new_functions) return NO_LABEL;
+
+        code->functions = new_functions;
+        for (int i = old_capacity; i < code->function_capacity; i++) code->functions[i] = NO_LABEL;
+        }
+
+    if (code->functions[id] == NO_LABEL) code->functions[id] = AsmNewLabel(code, LABEL_FUNC, id);
+
+    return code->functions[id];
+    }
+
+Error_t WriteAsmText(const AsmCode* code, TextWriter* writer)
+    {
+    assert(code);
+    assert(writer);
+
+    for (int i = 0; i < code->size; i++)
+        {
+        const Instruction* instruction = code->code + i;
+
+        if (instruction->opcode == ASM_NOP) continue;
+        if (instruction->opcode == ASM_LABEL)
+            {
+            WriteChars(writer, "\n", 1);
+            WriteLabelName(writer, code->labels + instruction->arg.id);
+            WriteChars(writer, ":\n", 2);
+            continue;
+            }
+
+        const char* name = OPCODE_NAMES[instruction->opcode];
+        WriteChars(writer, name, (int) strlen(name));
+
+        switch (instruction->kind)
+            {
+            case ARG_NUMBER:
+                WriteChars(writer, " ", 1);
+                WriteDouble(writer, instruction->arg.val);
+                break;
+            case ARG_MEMORY:
+            case ARG_ELEMENT:
+                WriteChars(writer, " [", 2);
+                WriteInt(writer, instruction->arg.id);
+                WriteChars(writer, "]", 1);
+                break;
+            case ARG_REGISTER:
+                WriteChars(writer, " reg", 4);
+                WriteInt(writer, instruction->arg.id);
+                break;
+            case ARG_TRASH:
+                WriteChars(writer, " trash", 6);
+                break;
+            case ARG_LABEL:
+                WriteChars(writer, " ", 1);
+                WriteLabelName(writer, code->labels + instruction->arg.id);
+                break;
+            case ARG_NONE:
+            default:
+                break;
+            }
+
+        WriteChars(writer, "\n", 1);
+        }
+
+    return writer->error;
+    }
+
+// Код команды по её имени в тексте, для неизвестных имён - NO_OPCODE
+int FindAsmOpcode(const char* name, int length)
+    {
+    assert(name);
+
+    for (int opcode = ASM_PUSH; opcode < ASM_OPCODE_COUNT; opcode++)
+        {
+        if ((int) strlen(OPCODE_NAMES[opcode]) == length && !strncmp(OPCODE_NAMES[opcode], name, (size_t) length)) return opcode;
+        }
+
+    return NO_OPCODE;
+    }
+
+static void WriteLabelName(TextWriter* writer, const AsmLabel* label)
+    {
+    const char* name = LABEL_NAMES[label->kind];
+    WriteChars(writer, name, (int) strlen(name));
+    WriteInt(writer, label->number);
+
+    if (label->kind == LABEL_IF)
+        {
+        WriteChars(writer, "_", 1);
+        WriteInt(writer, label->order);
+        }
+    }
@@ -0,0 +1,119 @@
+#ifndef ASMCODE_H
+#define ASMCODE_H
+
+const int ASM_REGISTER_COUNT = 8;
+const int ASM_ARRAY_SIZE     = 60;
+const int NO_LABEL           = -1;
+const int NO_OPCODE          = -1;
+
+enum AsmOpcode
+    {
+    ASM_LABEL   = 0,
+    ASM_PUSH    = 1,
+    ASM_POP     = 2,
+    ASM_ADD     = 3,
+    ASM_SUB     = 4,
+    ASM_MUL     = 5,
+    ASM_DIV     = 6,
+    ASM_POW     = 7,
+    ASM_GT      = 8,
+    ASM_LT      = 9,
+    ASM_GE      = 10,
+    ASM_LE      = 11,
+    ASM_EQ      = 12,
+    ASM_NE      = 13,
+    ASM_AND     = 14,
+    ASM_OR      = 15,
+    ASM_NOT     = 16,
+    ASM_SIN     = 17,
+    ASM_COS     = 18,
+    ASM_SQRT    = 19,
+    ASM_IN      = 20,
+    ASM_OUT     = 21,
+    ASM_JMP     = 22,
+    ASM_JE      = 23,
+    ASM_JNE     = 24,
+    ASM_CALL    = 25,
+    ASM_RET     = 26,
+    ASM_NOP     = 27,
+    ASM_PUSHI   = 28,
+    ASM_POPI    = 29,
+    ASM_OPCODE_COUNT
+    };
+
+enum AsmArgKind
+    {
+    ARG_NONE        = 0,
+    ARG_NUMBER      = 1,
+    ARG_MEMORY      = 2,
+    ARG_REGISTER    = 3,
+    ARG_TRASH       = 4,
+    ARG_LABEL       = 5,
+    ARG_ELEMENT     = 6,
+    };
+
+enum LabelKind
+    {
+    LABEL_FUNC          = 0,
+    LABEL_FUNC_GUARD    = 1,
+    LABEL_WHILE         = 2,
+    LABEL_END_WHILE     = 3,
+    LABEL_IF            = 4,
+    LABEL_END_IF        = 5,
+    LABEL_TARGET        = 6,
+    };
+
+// Имя метки собирается из вида и номеров: func_N, while_N, if_N_M, ...
+// label_N - безымянная цель перехода N, такие появляются при разборе байткода
+struct AsmLabel
+    {
+    int         kind;
+    int         number;
+    int         order;
+    };
+
+// Аргумент: val для ARG_NUMBER, id - адрес, номер регистра или номер метки.
+// pushi/popi [n] (ARG_ELEMENT) берут индекс с вершины стека и обращаются
+// к ячейке n + индекс, индекс должен быть от 0 до ASM_ARRAY_SIZE - 1.
+struct Instruction
+    {
+    Data_t          arg;
+    unsigned char   opcode;
+    unsigned char   kind;
+    };
+
+// Линейный код бэкенда. Ошибка выделения памяти запоминается в error,
+// поэтому генератор может проверять её один раз в конце.
+struct AsmCode
+    {
+    Instruction*    code;
+    int             size;
+    int             capacity;
+
+    AsmLabel*       labels;
+    int             label_count;
+    int             label_capacity;
+
+    int*            functions;
+    int             function_capacity;
+
+    int             if_count;
+    int             while_count;
+
+    Error_t         error;
+    };
+
+Error_t AsmCodeCtor(AsmCode* code);
+Error_t AsmCodeDtor(AsmCode* code);
+void    AsmCodeClear(AsmCode* code);
+
+void    AsmEmit(AsmCode* code, const int opcode, const int kind = ARG_NONE, const int id = 0);
+void    AsmEmitNumber(AsmCode* code, const double value);
+
+int     AsmNewLabel(AsmCode* code, const int kind, const int number, const int order = 0);
+int     AsmFunctionLabel(AsmCode* code, const int id);
+
+Error_t WriteAsmText(const AsmCode* code, TextWriter* writer);
+int     FindAsmOpcode(const char* name, int length);
+
+#endif //ASMCODE_H
@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <charconv>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "errors.h"
+#include "node.h"
+#include "flattree.h"
+#include "treeio.h"
+#include "asmcode.h"
+#include "nametable.h"
+#include "bytecode.h"
+#include "assembler.h"
+
+// Строка ассемблера: слово (команда или "метка:") и необязательный аргумент
+struct AsmLine
+    {
+    const char* word;
+    int         word_length;
+    const char* arg;
+    int         arg_length;
+    int         number;
+    };
+
+struct AsmText
+    {
+    const char* pos;
+    const char* end;
+    int         line;
+    };
+
+static bool    ReadLine(AsmText* text, AsmLine* line);
+static int     ReadWord(AsmText* text, const char** word);
+static bool    IsLabel(const AsmLine* line);
+static Error_t CollectLabels(NameTable* labels, const char* text, size_t size);
+static Error_t EmitLine(ByteCode* code, const NameTable* labels, const AsmLine* line);
+static bool    ReadArgInt(const char* first, const char* last, int* value);
+
+Error_t AssembleText(ByteCode* code, const char* text, size_t size)
+    {
+    assert(code);
+    assert(text || !size);
+
+    NameTable labels = {};
+    if (NameTableCtor(&labels, text) != Ok) return AllocationError;
+
+    Error_t state = CollectLabels(&labels, text, size);
+
+    AsmText asm_text = {text, text + size, 0};
+    AsmLine line     = {};
+    while (state == Ok && ReadLine(&asm_text, &line))
+        {
+        if (!IsLabel(&line)) state = EmitLine(code, &labels, &line);
+        }
+
+    if (state == Ok) ByteEmit(code, BC_HALT);
+    if (state == Ok) state = code->error;
+
+    NameTableDtor(&labels);
+
+    return state;
+    }
+
+Error_t AssembleFile(ByteCode* code, const char* filename)
+    {
+    assert(code);
+    assert(filename);
+
+    FILE* fp = fopen(filename, "rb");
+    if (!fp)
+        {
+        perror("Cannot open file\n");
+        return FileError;
+        }
+
+    if (IsByteCodeFile(fp))
+        {
+        Error_t state = ByteCodeMap(code, fileno(fp));
+        fclose(fp);
+        return state;
+        }
+
+    struct stat sb = {};
+    if (fstat(fileno(fp), &sb) != 0)
+        {
+        perror("Cannot read file\n");
+        fclose(fp);
+        return FileError;
+        }
+
+    size_t size = (size_t) sb.st_size;
+    void*  map  = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileno(fp), 0) : nullptr;
+    fclose(fp);
+    if (map == MAP_FAILED)
+        {
+        perror("Cannot map file\n");
+        return FileError;
+        }
+
+    Error_t state = AssembleText(code, (const char*) map, size);
+    if (map) munmap(map, size);
+
+    return state;
+    }
+
+// Первый проход: номер команды, на которую указывает каждая метка
+static Error_t CollectLabels(NameTable* labels, const char* text, size_t size)
+    {
+    AsmText asm_text = {text, text + size, 0};
+    AsmLine line     = {};
+    int     pos      = 0;
+
+    while (ReadLine(&asm_text, &line))
+        {
+        if (!IsLabel(&line))
+            {
+            pos++;
+            continue;
+            }
+
+        int length = line.word_length - 1;
+        if (NameTableFind(labels, line.word, length) != NO_NAME)
+            {
+            printf("Error: line %d: label %.*s is defined twice\n", line.number, length, line.word);
+            return SyntaxError;
+            }
+        if (NameTableInsert(labels, line.word, length, 0, pos) == NO_NAME) return AllocationError;
+        }
+
+    return Ok;
+    }
+
+static Error_t EmitLine(ByteCode* code, const NameTable* labels, const AsmLine* line)
+    {
+    int opcode = FindAsmOpcode(line->word, line->word_length);
+    if (opcode == NO_OPCODE || opcode == ASM_NOP)
+        {
+        printf("Error: line %d: unknown command %.*s\n", line->number, line->word_length, line->word);
+        return SyntaxError;
+        }
+
+    const char* arg  = line->arg;
+    const char* last = line->arg + line->arg_length;
+    int         kind = ARG_NONE;
+    int         id   = 0;
+    double      val  = 0;
+
+    if (!line->arg_length)
+        {
+        kind = ARG_NONE;
+        }
+    else if (opcode == ASM_JMP || opcode == ASM_JE || opcode == ASM_JNE || opcode == ASM_CALL)
+        {
+        int label = NameTableFind(labels, arg, line->arg_length);
+        if (label == NO_NAME)
+            {
+            printf("Error: line %d: unknown label %.*s\n", line->number, line->arg_length, arg);
+            return SyntaxError;
+            }
+        kind = ARG_LABEL;
+        id   = labels->names[label].index;
+        }
+    else if (*arg == '[' && last[-1] == ']' && ReadArgInt(arg + 1, last - 1, &id) && id >= 0)
+        {
+        kind = (opcode == ASM_PUSHI || opcode == ASM_POPI) ? ARG_ELEMENT : ARG_MEMORY;
+        }
+    else if (line->arg_length > 3 && !strncmp(arg, "reg", 3) && ReadArgInt(arg + 3, last, &id) &&
+             0 <= id && id < ASM_REGISTER_COUNT)
+        {
+        kind = ARG_REGISTER;
+        }
+    else if (line->arg_length == 5 && !strncmp(arg, "trash", 5))
+        {
+        kind = ARG_TRASH;
+        }
+    else if (std::from_chars(arg, last, val).ptr == last)
+        {
+        kind = ARG_NUMBER;
+        }
+
+    int byte_opcode = ByteOpcodeOf(opcode, kind);
+    if (byte_opcode == NO_OPCODE)
+        {
+        printf("Error: line %d: wrong argument %.*s of %.*s\n", line->number,
+               line->arg_length, arg, line->word_length, line->word);
+        return SyntaxError;
+        }
+
+    ByteEmit(code, byte_opcode, kind == ARG_NUMBER ? ByteConstant(code, val) : id);
+
+    return code->error;
+    }
+
+static bool ReadLine(AsmText* text, AsmLine* line)
+    {
+    while (text->pos < text->end)
+        {
+        text->line++;
+        line->number      = text->line;
+        line->word_length = ReadWord(text, &line->word);
+        line->arg_length  = ReadWord(text, &line->arg);
+
+        while (text->pos < text->end && *text->pos != '\n') text->pos++;
+        if (text->pos < text->end) text->pos++;
+
+        if (line->word_length) return true;
+        }
+
+    return false;
+    }
+
+// Слово до пробела или конца строки, сама строка не пропускается
+static int ReadWord(AsmText* text, const char** word)
+    {
+    while (text->pos < text->end && (*text->pos == ' ' || *text->pos == '\t' || *text->pos == '\r')) text->pos++;
+
+    *word = text->pos;
+    while (text->pos < text->end && *text->pos != ' ' && *text->pos != '\t' &&
+           *text->pos != '\r' && *text->pos != '\n') text->pos++;
+
+    return (int) (text->pos - *word);
+    }
+
+static bool IsLabel(const AsmLine* line)
+    {
+    return line->word[line->word_length - 1] == ':';
+    }
+
+static bool ReadArgInt(const char* first, const char* last, int* value)
+    {
+    std::from_chars_result result = std::from_chars(first, last, *value);
+    return result.ec == std::errc() && result.ptr == last;
+    }
@@ -0,0 +1,10 @@
+#ifndef ASSEMBLER_H
+#define ASSEMBLER_H
+
+// Переводит текст ассемблера (в том виде, как его пишет WriteAsmText) в байткод.
+// Первый проход собирает метки, второй заменяет их номерами команд.
+// AssembleFile объектный файл байткода не собирает, а отображает как есть.
+Error_t AssembleText(ByteCode* code, const char* text, size_t size);
+Error_t AssembleFile(ByteCode* code, const char* filename);
+
+#endif //ASSEMBLER_H
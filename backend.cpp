@@ -1,78 +1,74 @@
 #include <stdio.h>
 #include <assert.h>
 #include <stdlib.h>
-#include <ctype.h>
 #include <string.h>
 #include "errors.h"
 #include "node.h"
-#include "tree.h"
+#include "flattree.h"
+#include "treeio.h"
+#include "asmcode.h"
+#include "bytecode.h"
+#include "peephole.h"
+#include "regalloc.h"
 #include "backend.h"
+#include "native.h"
 
-static const char DEFAULT_ASM_FILENAME[] = "output.txt";
-
-int main(int argc, char *argv[])
+Error_t Backend(const char* file_from, const char* file_to, const BackendFlags* flags)
     {
-    const char* file_from = nullptr;
-    const char* file_to   = DEFAULT_ASM_FILENAME;
+    assert(file_from);
+    assert(file_to);
+    assert(flags);
 
-    if (argc < 2)
+    AsmCompiler cmp = {};
+    if (AsmCompilerCtor(&cmp, file_from, file_to) != Ok)
         {
-        printf("Incorrect args number\n");
-        return FileError;
+        return AllocationError;
         }
-    else if (argc == 2)
+
+    // Двоичное дерево отображается в память как есть, текстовое разбирается сразу в плоское
+    Error_t state = Ok;
+    if (IsFlatTreeFile(cmp.file_from))
         {
-        file_from = argv[1];
+        state = FlatTreeMap(&cmp.flat, fileno(cmp.file_from));
         }
-    else if (argc > 2)
+    else if (flags->stream && !flags->native && !flags->bytecode)
         {
-        file_from = argv[1];
-        file_to   = argv[2];
+        state = StreamAsmCode(&cmp, flags);
+        AsmCompilerDtor(&cmp);
+        return state;
         }
-
-    Backend(file_from, file_to);
-    return 0;
-    }
-
-Error_t Backend(const char* file_from, const char* file_to)
-    {
-    assert(file_from);
-    assert(file_to);
-
-    Compiler cmp = {};
-    if (CompilerCtor(&cmp, file_from, file_to) != Ok)
+    else
         {
-        return AllocationError;
+        state = ReadTextTreeFile(&cmp.flat, cmp.file_from);
         }
 
-    if (ReadTree(&cmp.tree.root, cmp.file_from) != Ok)
+    if (state != Ok)
         {
-        CompilerDtor(&cmp);
-        return SyntaxError;
+        AsmCompilerDtor(&cmp);
+        return state;
         }
 
-    WriteAsmCode(&cmp);
-    TreeDump(&cmp.tree, 0);
-    CompilerDtor(&cmp);
+    if (flags->native) state = WriteNativeCode(&cmp.flat, cmp.file_to);
+    else               state = WriteAsmCode(&cmp.flat, cmp.file_to, flags);
+    AsmCompilerDtor(&cmp);
 
-    return Ok;
+    return state;
     }
 
-
-Error_t CompilerCtor(Compiler* cmp, const char* file_from, const char* file_to)
+Error_t AsmCompilerCtor(AsmCompiler* cmp, const char* file_from, const char* file_to)
     {
     assert(cmp);
     assert(file_from);
     assert(file_to);
 
-    cmp->file_from = fopen(file_from, "r");
+    cmp->file_from = fopen(file_from, "rb");
     if (cmp->file_from == NULL)
         {
         perror("Cannot open file\n");
         return FileError;
         }
 
-    cmp->file_to = fopen(file_to, "w");
+    cmp->file_to = fopen(file_to, "wb");
     if (cmp->file_to == NULL)
         {
         perror("Cannot open file\n");
@@ -80,103 +76,244 @@ Error_t CompilerCtor(Compiler* cmp, const char* file_from, const char* file_to)
         return FileError;
         }
 
-    TreeCtor(&cmp->tree);
+    if (FlatTreeCtor(&cmp->flat) != Ok)
+        {
+        fclose(cmp->file_from);
+        fclose(cmp->file_to);
+        return AllocationError;
+        }
 
     return Ok;
     }
 
-Error_t CompilerDtor(Compiler* cmp)
+Error_t AsmCompilerDtor(AsmCompiler* cmp)
     {
     assert(cmp);
 
     fclose(cmp->file_from);
     fclose(cmp->file_to);
 
-    TreeDtor(&cmp->tree);
+    FlatTreeDtor(&cmp->flat);
 
     return Ok;
     }
 
-Error_t ReadTree(Node** node, FILE* fp)
+Error_t WriteAsmCode(const FlatTree* tree, FILE* fp, const BackendFlags* flags)
     {
-    assert(node);
+    assert(tree);
     assert(fp);
+    assert(flags);
 
-    char c = ' ';
-    while (isspace(c)) c = fgetc(fp);
+    AsmCode code = {};
+    AsmCodeCtor(&code);
 
-    switch (c)
+    Error_t state = Ok;
+    for (NodeIndex command = tree->root; command != NIL_NODE && state == Ok; command = tree->right[command])
         {
-        case '_': return Ok;
-        case '(': break;
-        case EOF: printf("Error: reached End of file\n");
-                  return SyntaxError;
-        default:  printf("Syntax error, wrong %c symbol\n", c);
-                  return SyntaxError;
+        if (WriteCommand(tree, tree->left[command], &code) != Ok)
+            {
+            printf("Syntax error in program\n");
+            state = SyntaxError;
+            }
         }
+    if (state == Ok) state = code.error;
 
-    int type = 0;
-    Data_t data = {.val = 0};
-    fscanf(fp, "%d", &type);
-
-    if  (type == VALUE)  fscanf(fp, "%lf", &data.val);
-    else                 fscanf(fp, "%d", &data.id);
-
-    if (NewNode(node, type, data) == AllocationError)
+    RegAllocStats registers = {};
+    PeepholeStats stats     = {};
+    if (state == Ok && flags->optimize) state = RegAlloc(&code, &registers);
+    if (state == Ok && flags->optimize) state = Peephole(&code, &stats);
+    if (state == Ok && flags->optimize && flags->report)
         {
-        return AllocationError;
+        RegAllocReport(&registers, stdout);
+        PeepholeReport(&stats, stdout);
         }
 
-    if (ReadTree(&(*node)->left,  fp) != Ok ||
-        ReadTree(&(*node)->right, fp) != Ok)
+    // Объектный файл собирается прямо из кода, без печати и разбора текста
+    if (state == Ok && flags->bytecode)
         {
-        return SyntaxError;
+        ByteCode byte = {};
+        ByteCodeCtor(&byte);
+        state = AsmToByteCode(&byte, &code);
+        if (state == Ok) state = ByteCodeWrite(&byte, fp);
+        ByteCodeDtor(&byte);
         }
-
-    c = ' ';
-    while (isspace(c)) c = fgetc(fp);
-
-    if (c == ')') return Ok;
-    else
+    else if (state == Ok)
         {
-        printf("Error: forget to close bracket\n");
-        return SyntaxError;
+        TextWriter writer = {};
+        state = TextWriterCtor(&writer, fp);
+        if (state == Ok)
+            {
+            WriteAsmText(&code, &writer);
+            state = TextWriterDtor(&writer);
+            }
         }
 
-    return Ok;
+    AsmCodeDtor(&code);
+
+    return state;
     }
 
-Error_t WriteAsmCode(Compiler* cmp)
+// Программа - правая цепочка ';', поэтому команды верхнего уровня читаются и
+// переводятся по одной: в плоском дереве и в коде в каждый момент лежит только одна команда.
+Error_t StreamAsmCode(AsmCompiler* cmp, const BackendFlags* flags)
     {
     assert(cmp);
+    assert(flags);
+
+    TextReader reader = {};
+    TextWriter writer = {};
+    AsmCode    code   = {};
+    AsmCodeCtor(&code);
 
-    Node* command = cmp->tree.root;
+    PeepholeStats stats = {};
 
-    while (command)
+    Error_t state    = TextStreamCtor(&reader, cmp->file_from);
+    int     commands = 0;
+    if (state == Ok) state = TextWriterCtor(&writer, cmp->file_to);
+
+    while (state == Ok)
         {
-        if (WriteCommand(command->left, cmp->file_to) != Ok)
+        bool   opened = false;
+        int    type   = 0;
+        Data_t data   = {.val = 0};
+        state = ReadTextHead(&reader, &opened, &type, &data);
+        if (state != Ok || !opened) break;
+
+        commands++;
+        if (type != OPERATION || data.id != OP_NEXT_COMMAND)
+            {
+            printf("Syntax error: program is not a command list\n");
+            state = SyntaxError;
+            break;
+            }
+
+        NodeIndex command = NIL_NODE;
+        FlatTreeClear(&cmp->flat);
+        state = ReadTextNode(&cmp->flat, &reader, &command);
+
+        AsmCodeClear(&code);
+        if (state == Ok && (command == NIL_NODE || WriteCommand(&cmp->flat, command, &code) != Ok))
             {
             printf("Syntax error in program\n");
+            state = SyntaxError;
+            }
+        if (state == Ok) state = code.error;
+        if (state == Ok && flags->optimize) state = Peephole(&code, &stats);
+        if (state == Ok) WriteAsmText(&code, &writer);
+        }
+
+    if (state == Ok) state = ReadTextClose(&reader, commands);
+    if (state == Ok && flags->optimize && flags->report) PeepholeReport(&stats, stdout);
+
+    if (writer.buffer && TextWriterDtor(&writer) != Ok && state == Ok) state = FileError;
+    TextReaderDtor(&reader);
+    AsmCodeDtor(&code);
+
+    return state;
+    }
+
+// opcode - ASM_PUSH или ASM_POP. Элемент с константным индексом - обычная ячейка,
+// иначе индекс считается на стеке и ячейку выбирает pushi/popi
+static Error_t WritePlace(const FlatTree* tree, NodeIndex place, AsmCode* code, int opcode)
+    {
+    assert(tree);
+    assert(code);
+
+    if (FlatType(tree, place) == VARIABLE)
+        {
+        AsmEmit(code, opcode, ARG_MEMORY, FlatId(tree, place));
+        return Ok;
+        }
+    if (FlatType(tree, place) != ARRAY)
+        {
+        printf("Syntax error: assigment to not variable\n");
+        return SyntaxError;
+        }
+
+    int       base  = FlatId(tree, place) * ARRAY_MAX_SIZE + ARRAY_SEGMENT;
+    NodeIndex index = tree->right[place];
+    if (index == NIL_NODE || FlatType(tree, index) == VALUE)
+        {
+        double shift = index != NIL_NODE ? FlatValue(tree, index) : 0;
+        if (!(0 <= shift && shift < ARRAY_MAX_SIZE))
+            {
+            printf("Syntax error: array index %lg out of range\n", shift);
             return SyntaxError;
             }
-        command = command->right;
+        AsmEmit(code, opcode, ARG_MEMORY, base + (int) shift);
+        return Ok;
         }
 
+    if (WriteEquation(tree, index, code) != Ok) return SyntaxError;
+    AsmEmit(code, opcode == ASM_PUSH ? ASM_PUSHI : ASM_POPI, ARG_ELEMENT, base);
+
     return Ok;
     }
 
-static int if_number = 0;
-static int while_number = 0;
+// Выражение без вызовов, ввода, вывода и ++/--: его можно посчитать ещё раз
+static bool IsRepeatable(const FlatTree* tree, NodeIndex node)
+    {
+    if (node == NIL_NODE) return true;
+    if (FlatType(tree, node) == FUNCTION) return false;
+    if (FlatType(tree, node) == OPERATION)
+        switch (FlatCode(tree, node))
+            {
+            case OP_INCREMENT: case OP_DECREMENT: case OP_INPUT: case OP_OUTPUT:
+                return false;
+            default:
+                break;
+            }
 
-Error_t WriteCommand(Node* node, FILE* fp)
+    return IsRepeatable(tree, tree->left[node]) && IsRepeatable(tree, tree->right[node]);
+    }
+
+// Вычисляемый индекс читается и пишется отдельными командами, поэтому считается
+// дважды: ни он сам, ни value между чтением и записью не должны ничего менять
+static Error_t CheckTwicePlace(const FlatTree* tree, NodeIndex place, NodeIndex value)
     {
-    assert(node);
-    assert(fp);
+    if (FlatType(tree, place) != ARRAY) return Ok;
 
-    fprintf(fp, "\n");
+    NodeIndex index = tree->right[place];
+    if (index == NIL_NODE || FlatType(tree, index) == VALUE)          return Ok;
+    if (IsRepeatable(tree, index) && IsRepeatable(tree, value))       return Ok;
+
+    printf("Syntax error: array index with side effects is used to read and write\n");
+    return SyntaxError;
+    }
+
+// ++ и --: значение ячейки после изменения остаётся на стеке
+static Error_t WriteStep(const FlatTree* tree, NodeIndex place, AsmCode* code, int opcode)
+    {
+    if (CheckTwicePlace(tree, place, NIL_NODE)     != Ok) return SyntaxError;
+    if (WritePlace(tree, place, code, ASM_PUSH)    != Ok) return SyntaxError;
+    AsmEmitNumber(code, 1);
+    AsmEmit(code, opcode);
+    if (WritePlace(tree, place, code, ASM_POP)     != Ok) return SyntaxError;
+    return WritePlace(tree, place, code, ASM_PUSH);
+    }
+
+static Error_t WriteInput(const FlatTree* tree, NodeIndex place, AsmCode* code)
+    {
+    if (FlatType(tree, place) != VARIABLE && FlatType(tree, place) != ARRAY)
+        {
+        printf("Syntax error: input type is not variable\n");
+        return SyntaxError;
+        }
+
+    if (CheckTwicePlace(tree, place, NIL_NODE) != Ok) return SyntaxError;
+    AsmEmit(code, ASM_IN);
+    if (WritePlace(tree, place, code, ASM_POP) != Ok) return SyntaxError;
+    return WritePlace(tree, place, code, ASM_PUSH);
+    }
+
+Error_t WriteCommand(const FlatTree* tree, NodeIndex node, AsmCode* code)
+    {
+    assert(tree);
+    assert(node != NIL_NODE);
+    assert(code);
 
-    if (node->type == OPERATION)
-        switch (node->data.id)
+    if (FlatType(tree, node) == OPERATION)
+        switch (FlatCode(tree, node))
             {
             case OP_ASSIGMENT:
             case OP_ADD_ASSIGMENT:
@@ -185,103 +322,92 @@ Error_t WriteCommand(Node* node, FILE* fp)
             case OP_DIV_ASSIGMENT:
             case OP_POW_ASSIGMENT:
                 {
-                return WriteAssigment(node, fp);
+                return WriteAssigment(tree, node, code);
                 }
             case OP_WHILE:
                 {
-                while_number += 1;
-                WriteWhile(node, fp);
-                fprintf(fp, "end_while_%d:\n", while_number);
-                return Ok;
+                return WriteWhile(tree, node, code);
                 }
             case OP_IF: case OP_ELSE:
                 {
-                if_number += 1;
-                WriteIf(node, fp, 0);
-                fprintf(fp, "end_if_%d:\n", if_number);
-                return Ok;
+                int     end   = AsmNewLabel(code, LABEL_END_IF, ++code->if_count);
+                Error_t state = WriteIf(tree, node, code, end, 0);
+                AsmEmit(code, ASM_LABEL, ARG_LABEL, end);
+                return state;
                 }
             case OP_NEXT_COMMAND:
                 {
-                return WriteBody(node, fp);
+                return WriteBody(tree, node, code);
                 }
             case OP_DEFINE_VARIABLE:
                 {
-                return WriteDefineVariable(node, fp);
+                return WriteDefineVariable(tree, node, code);
                 }
             case OP_DEFINE_FUNCTION:
                 {
-                return WriteDefineFunction(node, fp);
+                return WriteDefineFunction(tree, node, code);
                 }
             case OP_DEFINE_ARRAY:
                 {
-                return WriteDefineArray(node, fp);
+                return WriteDefineArray(tree, node, code);
                 }
             }
 
-    Error_t state = WriteEquation(node, fp);
-    fprintf(fp, "pop trash\n");
+    Error_t state = WriteEquation(tree, node, code);
+    AsmEmit(code, ASM_POP, ARG_TRASH);
     return state;
     }
 
-Error_t WriteEquation(Node* node, FILE* fp)
+Error_t WriteEquation(const FlatTree* tree, NodeIndex node, AsmCode* code)
     {
-    assert(node);
-    assert(fp);
+    assert(tree);
+    assert(node != NIL_NODE);
+    assert(code);
 
-    #define DEFINE_OPERATION(oper, code) case oper: code; break;
+    #define DEFINE_OPERATION(oper, generate) case oper: generate; break;
 
-    switch (node->type)
+    switch (FlatType(tree, node))
         {
         case VALUE:
             {
-            fprintf(fp, "push %f\n", node->data.val);
+            AsmEmitNumber(code, FlatValue(tree, node));
             break;
             }
         case VARIABLE:
+        case ARRAY:
             {
-            fprintf(fp, "push [%d]\n", node->data.id);
-            break;
+            return WritePlace(tree, node, code, ASM_PUSH);
             }
         case FUNCTION:
             {
-            Node* parametr = node->right;
-            int   param_number = 0;
-            while (parametr)
+            // Аргументы сначала копятся на стеке: вызов внутри следующего
+            // аргумента испортил бы уже заполненные регистры
+            NodeIndex parametr     = tree->right[node];
+            int       param_number = 0;
+            while (parametr != NIL_NODE)
                 {
-                switch (parametr->left->type)
+                if (param_number == ASM_REGISTER_COUNT)
                     {
-                    case VALUE:
-                        fprintf(fp, "push %f\n", parametr->left->data.val);
-                        break;
-                    case VARIABLE:
-                        fprintf(fp, "push [%d]\n", parametr->left->data.id);
-                        break;
-                    case ARRAY:
-                        fprintf(fp, "push [%d]\n", node->data.id * ARRAY_MAX_SIZE + ARRAY_SEGMENT + (int) node->right->data.val);
-                        break;
+                    printf("Syntax error: too many parametrs in call of function %d\n", FlatId(tree, node));
+                    return SyntaxError;
                     }
-                fprintf(fp, "pop reg%d\n", param_number);
+                if (WriteEquation(tree, tree->left[parametr], code) != Ok) return SyntaxError;
 
-                parametr = parametr->right;
+                parametr = tree->right[parametr];
                 param_number += 1;
                 }
-            fprintf(fp, "call func_%d\n", node->data.id);
-            fprintf(fp, "push reg0\n");
-            break;
-            }
-        case ARRAY:
-            {
-            fprintf(fp, "push [%d]\n", node->data.id * ARRAY_MAX_SIZE + ARRAY_SEGMENT + (int) node->right->data.val);
+            while (param_number > 0) AsmEmit(code, ASM_POP, ARG_REGISTER, --param_number);
+            AsmEmit(code, ASM_CALL, ARG_LABEL, AsmFunctionLabel(code, FlatId(tree, node)));
+            AsmEmit(code, ASM_PUSH, ARG_REGISTER, 0);
             break;
             }
         case OPERATION:
             {
-            switch (node->data.id)
+            switch (FlatCode(tree, node))
                 {
                 #include "operations.h"
                 default:
-                    printf("Syntax error: wrong operation %d %d\n", node->type, node->data.id);
+                    printf("Syntax error: wrong operation %d %d\n", FlatType(tree, node), FlatCode(tree, node));
                     return SyntaxError;
                 }
             break;
@@ -298,170 +424,192 @@ Error_t WriteEquation(Node* node, FILE* fp)
     return Ok;
     }
 
-Error_t WriteAssigment(Node* node, FILE* fp)
+Error_t WriteAssigment(const FlatTree* tree, NodeIndex node, AsmCode* code)
     {
-    assert(node);
-    assert(fp);
+    assert(tree);
+    assert(node != NIL_NODE);
+    assert(code);
 
-    int index = 0;
+    NodeIndex dest  = tree->left[node];
+    NodeIndex value = tree->right[node];
 
-    if (node->left->type == VARIABLE)
-        {
-        index = node->left->data.id;
-        }
-    else if (node->left->type == ARRAY)
+    if (FlatCode(tree, node) == OP_ASSIGMENT)
         {
-        index = node->left->data.id * ARRAY_MAX_SIZE + ARRAY_SEGMENT + (int) node->left->right->data.val;
+        if (WriteEquation(tree, value, code) != Ok) return SyntaxError;
+        return WritePlace(tree, dest, code, ASM_POP);
         }
 
-    fprintf(fp, "push [%d]\n", index);
-    WriteEquation(node->right, fp);
-    switch (node->data.id)
+    if (CheckTwicePlace(tree, dest, value)     != Ok) return SyntaxError;
+    if (WritePlace(tree, dest, code, ASM_PUSH) != Ok) return SyntaxError;
+    if (WriteEquation(tree, value, code)       != Ok) return SyntaxError;
+    switch (FlatCode(tree, node))
         {
-        case OP_ASSIGMENT:
-            fprintf(fp, "pop [%d]\n", index);
-            fprintf(fp, "pop trash\n");
-            return Ok;
         case OP_ADD_ASSIGMENT:
-            fprintf(fp, "add\n");
+            AsmEmit(code, ASM_ADD);
             break;
         case OP_SUB_ASSIGMENT:
-            fprintf(fp, "sub\n");
+            AsmEmit(code, ASM_SUB);
             break;
         case OP_MUL_ASSIGMENT:
-            fprintf(fp, "mul\n");
+            AsmEmit(code, ASM_MUL);
             break;
         case OP_DIV_ASSIGMENT:
-            fprintf(fp, "div\n");
+            AsmEmit(code, ASM_DIV);
             break;
         case OP_POW_ASSIGMENT:
-            fprintf(fp, "pow\n");
+            AsmEmit(code, ASM_POW);
+            break;
+        default:
             break;
         }
-    fprintf(fp, "pop [%d]\n", index);
 
-    return Ok;
+    return WritePlace(tree, dest, code, ASM_POP);
     }
 
-Error_t WriteDefineVariable(Node* node, FILE* fp)
+Error_t WriteDefineVariable(const FlatTree* tree, NodeIndex node, AsmCode* code)
     {
-    assert(node);
-    assert(fp);
+    assert(tree);
+    assert(node != NIL_NODE);
+    assert(code);
 
-    WriteEquation(node->right, fp);
-    fprintf(fp, "pop [%d]\n", node->left->data.id);
+    WriteEquation(tree, tree->right[node], code);
+    AsmEmit(code, ASM_POP, ARG_MEMORY, FlatId(tree, tree->left[node]));
 
     return Ok;
     }
 
-Error_t WriteDefineFunction(Node* node, FILE* fp)
+Error_t WriteDefineFunction(const FlatTree* tree, NodeIndex node, AsmCode* code)
     {
-    assert(node);
-    assert(fp);
+    assert(tree);
+    assert(node != NIL_NODE);
+    assert(code);
 
-    fprintf(fp, "jmp func_guard_%d\n", node->left->data.id);
+    NodeIndex function = tree->left[node];
+    int       id       = FlatId(tree, function);
+    int       guard    = AsmNewLabel(code, LABEL_FUNC_GUARD, id);
 
-    fprintf(fp, "func_%d:\n", node->left->data.id);
+    AsmEmit(code, ASM_JMP, ARG_LABEL, guard);
 
-    Node* parametr = node->left->right;
-    int   param_number = 0;
-    while (parametr)
+    AsmEmit(code, ASM_LABEL, ARG_LABEL, AsmFunctionLabel(code, id));
+
+    NodeIndex parametr     = tree->right[function];
+    int       param_number = 0;
+    while (parametr != NIL_NODE)
         {
-        fprintf(fp, "push reg%d\n", param_number);
-        fprintf(fp, "pop [%d]\n", parametr->left->left->data.id);
+        // Параметры передаются в регистрах
+        if (param_number == ASM_REGISTER_COUNT)
+            {
+            printf("Syntax error: too many parametrs of function %d\n", id);
+            return SyntaxError;
+            }
+        AsmEmit(code, ASM_PUSH, ARG_REGISTER, param_number);
+        AsmEmit(code, ASM_POP, ARG_MEMORY, FlatId(tree, tree->left[tree->left[parametr]]));
 
-        parametr = parametr->right;
+        parametr = tree->right[parametr];
         param_number += 1;
         }
 
-    WriteBody(node->right, fp);
-    fprintf(fp, "ret\n");
+    WriteBody(tree, tree->right[node], code);
+    AsmEmit(code, ASM_RET);
 
-    fprintf(fp, "func_guard_%d:\n", node->left->data.id);
+    AsmEmit(code, ASM_LABEL, ARG_LABEL, guard);
 
     return Ok;
     }
 
-Error_t WriteDefineArray(Node* node, FILE* fp)
+Error_t WriteDefineArray(const FlatTree* tree, NodeIndex node, AsmCode* code)
     {
-    assert(node);
-    assert(fp);
-
-    Node* parametr = node->right;
-    int   param_number = 0;
-    while (parametr && param_number < node->left->right->data.val)
+    assert(tree);
+    assert(node != NIL_NODE);
+    assert(code);
+
+    NodeIndex array        = tree->left[node];
+    NodeIndex size         = tree->right[array];
+    NodeIndex parametr     = tree->right[node];
+    int       param_number = 0;
+    while (parametr != NIL_NODE && param_number < FlatValue(tree, size))
         {
-        WriteEquation(parametr->left, fp);
-        fprintf(fp, "pop [%d]\n", node->left->data.id * ARRAY_MAX_SIZE + ARRAY_SEGMENT + param_number);
+        WriteEquation(tree, tree->left[parametr], code);
+        AsmEmit(code, ASM_POP, ARG_MEMORY, FlatId(tree, array) * ARRAY_MAX_SIZE + ARRAY_SEGMENT + param_number);
 
-        parametr = parametr->right;
+        parametr = tree->right[parametr];
         param_number += 1;
         }
 
     return Ok;
     }
 
-Error_t WriteBody(Node* node, FILE* fp)
+Error_t WriteBody(const FlatTree* tree, NodeIndex node, AsmCode* code)
     {
-    assert(node);
-    assert(fp);
+    assert(tree);
+    assert(code);
 
-    while (node)
+    while (node != NIL_NODE)
         {
-        if (WriteCommand(node->left, fp) != Ok)
+        if (WriteCommand(tree, tree->left[node], code) != Ok)
             {
             printf("Syntax error in program body\n");
             return SyntaxError;
             }
-        node = node->right;
+        node = tree->right[node];
         }
 
     return Ok;
     }
 
-Error_t WriteWhile(Node* node, FILE* fp)
+// Номер цикла берётся один раз до генерации тела, поэтому вложенные циклы
+// не сбивают метки внешнего
+Error_t WriteWhile(const FlatTree* tree, NodeIndex node, AsmCode* code)
     {
-    assert(node);
-    assert(fp);
-
-    fprintf(fp, "while_%d:\n", while_number);
-    WriteEquation(node->left, fp);
-    fprintf(fp, "push 0\n");
-    fprintf(fp, "je end_while_%d", while_number);
-    WriteBody(node->right, fp);
-    fprintf(fp, "jmp while_%d\n", while_number);
+    assert(tree);
+    assert(node != NIL_NODE);
+    assert(code);
+
+    int number = ++code->while_count;
+    int start  = AsmNewLabel(code, LABEL_WHILE,     number);
+    int end    = AsmNewLabel(code, LABEL_END_WHILE, number);
+
+    AsmEmit(code, ASM_LABEL, ARG_LABEL, start);
+    WriteEquation(tree, tree->left[node], code);
+    AsmEmitNumber(code, 0);
+    AsmEmit(code, ASM_JE, ARG_LABEL, end);
+    Error_t state = WriteBody(tree, tree->right[node], code);
+    AsmEmit(code, ASM_JMP, ARG_LABEL, start);
+    AsmEmit(code, ASM_LABEL, ARG_LABEL, end);
 
-    return Ok;
+    return state;
     }
 
-Error_t WriteIf(Node* node, FILE* fp, int order)
+Error_t WriteIf(const FlatTree* tree, NodeIndex node, AsmCode* code, const int end, const int order)
     {
-    assert(node);
-    assert(fp);
+    assert(tree);
+    assert(code);
 
-    if (node->type == OPERATION && node->data.id == OP_IF)
+    if (IsFlatOperation(tree, node, OP_IF))
         {
-        WriteEquation(node->left, fp);
-        fprintf(fp, "push 0\n");
-        fprintf(fp, "je end_if_%d\n", if_number);
-        WriteBody(node->right, fp);
-        fprintf(fp, "jmp end_if_%d\n\n", if_number);
+        WriteEquation(tree, tree->left[node], code);
+        AsmEmitNumber(code, 0);
+        AsmEmit(code, ASM_JE, ARG_LABEL, end);
+        WriteBody(tree, tree->right[node], code);
+        AsmEmit(code, ASM_JMP, ARG_LABEL, end);
         }
-    else if (node->type == OPERATION && node->data.id == OP_ELSE)
+    else if (IsFlatOperation(tree, node, OP_ELSE))
         {
-        Node* if_node = node->left;
-        WriteEquation(if_node->left, fp);
-        fprintf(fp, "push 0\n");
-        fprintf(fp, "jne if_%d_%d\n", if_number, order);
-        WriteIf(node->right, fp, order + 1);
-        fprintf(fp, "if_%d_%d:\n", if_number, order);
-        WriteBody(if_node->right, fp);
-        fprintf(fp, "jmp end_if_%d\n\n", if_number);
+        NodeIndex if_node = tree->left[node];
+        int       branch  = AsmNewLabel(code, LABEL_IF, (end == NO_LABEL) ? 0 : code->labels[end].number, order);
+
+        WriteEquation(tree, tree->left[if_node], code);
+        AsmEmitNumber(code, 0);
+        AsmEmit(code, ASM_JNE, ARG_LABEL, branch);
+        WriteIf(tree, tree->right[node], code, end, order + 1);
+        AsmEmit(code, ASM_LABEL, ARG_LABEL, branch);
+        WriteBody(tree, tree->right[if_node], code);
+        AsmEmit(code, ASM_JMP, ARG_LABEL, end);
         }
     else
         {
-        WriteBody(node, fp);
-        fprintf(fp, "jmp end_if_%d\n", if_number);
+        WriteBody(tree, node, code);
+        AsmEmit(code, ASM_JMP, ARG_LABEL, end);
         }
 
     return Ok;
@@ -1,33 +1,46 @@
 #ifndef BACKEND_H
 #define BACKEND_H
 
-const int ARRAY_MAX_SIZE = 60;
+const int ARRAY_MAX_SIZE = ASM_ARRAY_SIZE;
 const int ARRAY_SEGMENT  = 800;
 
-struct Compiler
+struct AsmCompiler
     {
     FILE*       file_from;
     FILE*       file_to;
-    Tree        tree;
+    FlatTree    flat;
     };
 
-Error_t Backend(const char* file_from, const char* file_to);
+// stream - переводить текстовое дерево по одной команде, optimize - распределять
+// регистры (кроме stream, где вся программа не видна) и прогонять Peephole,
+// report - печатать статистику оптимизаций, native - писать ассемблер x86-64
+// для GNU as вместо кода стековой машины (без stream, optimize на него не влияет),
+// bytecode - писать вместо текста объектный файл байткода (тоже без stream)
+struct BackendFlags
+    {
+    bool        stream;
+    bool        optimize;
+    bool        report;
+    bool        native;
+    bool        bytecode;
+    };
 
-Error_t CompilerCtor(Compiler* cmp, const char* file_from, const char* file_to);
-Error_t CompilerDtor(Compiler* cmp);
+Error_t Backend(const char* file_from, const char* file_to, const BackendFlags* flags);
 
-Error_t ReadTree(Node** node, FILE* fp);
+Error_t AsmCompilerCtor(AsmCompiler* cmp, const char* file_from, const char* file_to);
+Error_t AsmCompilerDtor(AsmCompiler* cmp);
 
-Error_t WriteAsmCode(Compiler* cmp);
-Error_t WriteCommand(Node* node, FILE* fp);
+Error_t WriteAsmCode(const FlatTree* tree, FILE* fp, const BackendFlags* flags);
+Error_t StreamAsmCode(AsmCompiler* cmp, const BackendFlags* flags);
+Error_t WriteCommand(const FlatTree* tree, NodeIndex node, AsmCode* code);
 
-Error_t WriteEquation(Node* node, FILE* fp);
-Error_t WriteAssigment(Node* node, FILE* fp);
-Error_t WriteBody(Node* node, FILE* fp);
-Error_t WriteDefineVariable(Node* node, FILE* fp);
-Error_t WriteDefineFunction(Node* node, FILE* fp);
-Error_t WriteDefineArray(Node* node, FILE* fp);
-Error_t WriteIf(Node* node, FILE* fp, const int order);
-Error_t WriteWhile(Node* node, FILE* fp);
+Error_t WriteEquation(const FlatTree* tree, NodeIndex node, AsmCode* code);
+Error_t WriteAssigment(const FlatTree* tree, NodeIndex node, AsmCode* code);
+Error_t WriteBody(const FlatTree* tree, NodeIndex node, AsmCode* code);
+Error_t WriteDefineVariable(const FlatTree* tree, NodeIndex node, AsmCode* code);
+Error_t WriteDefineFunction(const FlatTree* tree, NodeIndex node, AsmCode* code);
+Error_t WriteDefineArray(const FlatTree* tree, NodeIndex node, AsmCode* code);
+Error_t WriteIf(const FlatTree* tree, NodeIndex node, AsmCode* code, const int end, const int order);
+Error_t WriteWhile(const FlatTree* tree, NodeIndex node, AsmCode* code);
 
 #endif //BACKEND_H
@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include <string.h>
+#include "errors.h"
+#include "node.h"
+#include "flattree.h"
+#include "treeio.h"
+#include "asmcode.h"
+#include "bytecode.h"
+#include "peephole.h"
+#include "backend.h"
+#include "native.h"
+
+static const char DEFAULT_ASM_FILENAME[] = "output.txt";
+static const char STREAM_FLAG[]          = "--stream";
+static const char OPTIMIZE_FLAG[]        = "-O";
+static const char STATS_FLAG[]           = "--stats";
+static const char NATIVE_FLAG[]          = "--native";
+static const char BYTECODE_FLAG[]        = "--bytecode";
+
+int main(int argc, char *argv[])
+    {
+    const char*  file_from = nullptr;
+    const char*  file_to   = nullptr;
+    BackendFlags flags     = {};
+
+    for (int i = 1; i < argc; i++)
+        {
+        if      (!strcmp(argv[i], STREAM_FLAG))   flags.stream   = true;
+        else if (!strcmp(argv[i], OPTIMIZE_FLAG)) flags.optimize = true;
+        else if (!strcmp(argv[i], STATS_FLAG))    flags.report   = true;
+        else if (!strcmp(argv[i], NATIVE_FLAG))   flags.native   = true;
+        else if (!strcmp(argv[i], BYTECODE_FLAG)) flags.bytecode = true;
+        else if (!file_from)                      file_from      = argv[i];
+        else if (!file_to)                        file_to        = argv[i];
+        }
+
+    if (!file_from)
+        {
+        printf("Incorrect args number\n");
+        return FileError;
+        }
+    if (!file_to) file_to = DEFAULT_ASM_FILENAME;
+
+    Backend(file_from, file_to, &flags);
+    return 0;
+    }
@@ -0,0 +1,462 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "errors.h"
+#include "section.h"
+#include "growarray.h"
+#include "node.h"
+#include "flattree.h"
+#include "treeio.h"
+#include "asmcode.h"
+#include "bytecode.h"
+
+static int      AsmOpcodeOf(const int opcode, int* kind);
+static Error_t  ByteCodeCheck(const ByteCode* code);
+
+Error_t ByteCodeCtor(ByteCode* code)
+    {
+    assert(code);
+
+    code->code              = nullptr;
+    code->size              = 0;
+    code->capacity          = 0;
+    code->constants         = nullptr;
+    code->constant_count    = 0;
+    code->constant_capacity = 0;
+    code->labels            = nullptr;
+    code->label_count       = 0;
+    code->label_capacity    = 0;
+    code->memory_size       = 0;
+    code->mapping           = nullptr;
+    code->mapping_size      = 0;
+    code->error             = Ok;
+
+    return Ok;
+    }
+
+Error_t ByteCodeDtor(ByteCode* code)
+    {
+    assert(code);
+
+    if (code->mapping)
+        {
+        munmap(code->mapping, code->mapping_size);
+        }
+    else
+        {
+        free(code->code);
+        free(code->constants);
+        free(code->labels);
+        }
+
+    code->code              = nullptr;
+    code->constants         = nullptr;
+    code->labels            = nullptr;
+    code->size              = 0;
+    code->capacity          = 0;
+    code->constant_count    = 0;
+    code->constant_capacity = 0;
+    code->label_count       = 0;
+    code->label_capacity    = 0;
+    code->memory_size       = 0;
+    code->mapping           = nullptr;
+    code->mapping_size      = 0;
+
+    return Ok;
+    }
+
+// Команда байткода для команды ассемблера с аргументом вида kind,
+// для меток и неверных сочетаний - NO_OPCODE
+int ByteOpcodeOf(const int opcode, const int kind)
+    {
+    switch (opcode)
+        {
+        case ASM_PUSH:
+            if (kind == ARG_NUMBER)   return BC_PUSH_NUMBER;
+            if (kind == ARG_MEMORY)   return BC_PUSH_MEMORY;
+            if (kind == ARG_REGISTER) return BC_PUSH_REG;
+            return NO_OPCODE;
+        case ASM_POP:
+            if (kind == ARG_MEMORY)   return BC_POP_MEMORY;
+            if (kind == ARG_REGISTER) return BC_POP_REG;
+            if (kind == ARG_TRASH)    return BC_POP_TRASH;
+            return NO_OPCODE;
+        case ASM_PUSHI:
+            return kind == ARG_ELEMENT ? BC_PUSH_ELEMENT : NO_OPCODE;
+        case ASM_POPI:
+            return kind == ARG_ELEMENT ? BC_POP_ELEMENT : NO_OPCODE;
+        case ASM_JMP:
+        case ASM_JE:
+        case ASM_JNE:
+        case ASM_CALL:
+            return kind == ARG_LABEL ? opcode - ASM_ADD + BC_ADD : NO_OPCODE;
+        case ASM_LABEL:
+        case ASM_NOP:
+            return NO_OPCODE;
+        default:
+            return (kind == ARG_NONE && ASM_ADD <= opcode && opcode <= ASM_RET) ? opcode - ASM_ADD + BC_ADD : NO_OPCODE;
+        }
+    }
+
+void ByteEmit(ByteCode* code, const int opcode, const int arg)
+    {
+    assert(code);
+    assert(0 <= opcode && opcode < BC_OPCODE_COUNT);
+
+    if (code->size == code->capacity)
+        {
+        ByteInstr* new_code = (ByteInstr*) GrowArray(code->code, &code->capacity, sizeof(ByteInstr), &code->error);
+        if (!new_code) return;
+        code->code = new_code;
+        }
+
+    code->code[code->size++] = {opcode, arg};
+
+    if ((opcode == BC_PUSH_MEMORY || opcode == BC_POP_MEMORY) && arg >= code->memory_size) code->memory_size = arg + 1;
+    if ((opcode == BC_PUSH_ELEMENT || opcode == BC_POP_ELEMENT) && arg + ASM_ARRAY_SIZE > code->memory_size)
+        code->memory_size = arg + ASM_ARRAY_SIZE;
+    }
+
+int ByteConstant(ByteCode* code, const double value)
+    {
+    assert(code);
+
+    if (code->constant_count == code->constant_capacity)
+        {
+        double* new_constants = (double*) GrowArray(code->constants, &code->constant_capacity, sizeof(double), &code->error);
+        if (!new_constants) return 0;
+        code->constants = new_constants;
+        }
+
+    code->constants[code->constant_count] = value;
+
+    return code->constant_count++;
+    }
+
+void ByteAddLabel(ByteCode* code, const AsmLabel* label, const int target)
+    {
+    assert(code);
+    assert(label);
+
+    if (code->label_count == code->label_capacity)
+        {
+        ByteLabel* new_labels = (ByteLabel*) GrowArray(code->labels, &code->label_capacity, sizeof(ByteLabel), &code->error);
+        if (!new_labels) return;
+        code->labels = new_labels;
+        }
+
+    code->labels[code->label_count++] = {label->kind, label->number, label->order, target};
+    }
+
+// То же, что AssembleText, но без текста: первый проход ставит меткам номера
+// команд, второй пишет команды. Метки попадают в таблицу по возрастанию target.
+Error_t AsmToByteCode(ByteCode* byte, const AsmCode* code)
+    {
+    assert(byte);
+    assert(code);
+
+    int* targets = (int*) calloc((size_t) code->label_count + 1, sizeof(int));
+    if (!targets)
+        {
+        printf("Error: cannot allocate memory for bytecode\n");
+        return AllocationError;
+        }
+    for (int label = 0; label < code->label_count; label++) targets[label] = NO_LABEL;
+
+    int pos = 0;
+    for (int i = 0; i < code->size; i++)
+        {
+        const Instruction* instruction = code->code + i;
+
+        if (instruction->opcode == ASM_NOP) continue;
+        if (instruction->opcode != ASM_LABEL)
+            {
+            pos++;
+            continue;
+            }
+
+        targets[instruction->arg.id] = pos;
+        ByteAddLabel(byte, code->labels + instruction->arg.id, pos);
+        }
+
+    Error_t state = Ok;
+    for (int i = 0; i < code->size && state == Ok; i++)
+        {
+        const Instruction* instruction = code->code + i;
+        if (instruction->opcode == ASM_NOP || instruction->opcode == ASM_LABEL) continue;
+
+        int opcode = ByteOpcodeOf(instruction->opcode, instruction->kind);
+        int arg    = instruction->arg.id;
+        if (opcode == NO_OPCODE)
+            {
+            printf("Error: wrong argument of command %d\n", instruction->opcode);
+            state = SyntaxError;
+            break;
+            }
+
+        if (instruction->kind == ARG_NUMBER) arg = ByteConstant(byte, instruction->arg.val);
+        if (instruction->kind == ARG_LABEL)
+            {
+            arg = targets[instruction->arg.id];
+            if (arg == NO_LABEL)
+                {
+                printf("Error: jump to label %d, which is not defined\n", instruction->arg.id);
+                state = SyntaxError;
+                break;
+                }
+            }
+
+        ByteEmit(byte, opcode, arg);
+        }
+
+    if (state == Ok) ByteEmit(byte, BC_HALT);
+    if (state == Ok) state = byte->error;
+
+    free(targets);
+
+    return state;
+    }
+
+// Обратный перевод для просмотра в виде текста. Последний halt дописан
+// ассемблером и пропускается; цели переходов без имени получают метки label_N.
+Error_t ByteCodeToAsm(AsmCode* code, const ByteCode* byte)
+    {
+    assert(code);
+    assert(byte);
+
+    int* names = (int*) calloc((size_t) byte->size + 1, sizeof(int));
+    if (!names)
+        {
+        printf("Error: cannot allocate memory for asm code\n");
+        return AllocationError;
+        }
+    for (int pos = 0; pos <= byte->size; pos++) names[pos] = NO_LABEL;
+
+    // Метка номер label в AsmCode - это метка номер label из таблицы
+    for (int label = 0; label < byte->label_count; label++)
+        {
+        const ByteLabel* name  = byte->labels + label;
+        int              index = AsmNewLabel(code, name->kind, name->number, name->order);
+        if (names[name->target] == NO_LABEL) names[name->target] = index;
+        }
+    for (int pos = 0; pos < byte->size; pos++)
+        {
+        int target = byte->code[pos].arg;
+        if (BC_JMP <= byte->code[pos].opcode && byte->code[pos].opcode <= BC_CALL && names[target] == NO_LABEL)
+            names[target] = AsmNewLabel(code, LABEL_TARGET, target);
+        }
+
+    int size  = (byte->size && byte->code[byte->size - 1].opcode == BC_HALT) ? byte->size - 1 : byte->size;
+    int label = 0;
+    for (int pos = 0; pos <= size && code->error == Ok; pos++)
+        {
+        for (; label < byte->label_count && byte->labels[label].target == pos; label++)
+            AsmEmit(code, ASM_LABEL, ARG_LABEL, label);
+        if (names[pos] >= byte->label_count) AsmEmit(code, ASM_LABEL, ARG_LABEL, names[pos]);
+        if (pos == size) break;
+
+        int kind   = ARG_NONE;
+        int opcode = AsmOpcodeOf(byte->code[pos].opcode, &kind);
+        int arg    = byte->code[pos].arg;
+
+        if      (kind == ARG_NUMBER) AsmEmitNumber(code, byte->constants[arg]);
+        else if (kind == ARG_LABEL)  AsmEmit(code, opcode, kind, names[arg]);
+        else                         AsmEmit(code, opcode, kind, arg);
+        }
+
+    free(names);
+
+    return code->error;
+    }
+
+// Команда ассемблера и вид аргумента для команды байткода, обратно ByteOpcodeOf
+static int AsmOpcodeOf(const int opcode, int* kind)
+    {
+    switch (opcode)
+        {
+        case BC_PUSH_NUMBER: *kind = ARG_NUMBER;   return ASM_PUSH;
+        case BC_PUSH_MEMORY: *kind = ARG_MEMORY;   return ASM_PUSH;
+        case BC_PUSH_REG:    *kind = ARG_REGISTER; return ASM_PUSH;
+        case BC_POP_MEMORY:  *kind = ARG_MEMORY;   return ASM_POP;
+        case BC_POP_REG:     *kind = ARG_REGISTER; return ASM_POP;
+        case BC_POP_TRASH:   *kind = ARG_TRASH;    return ASM_POP;
+        case BC_PUSH_ELEMENT: *kind = ARG_ELEMENT; return ASM_PUSHI;
+        case BC_POP_ELEMENT:  *kind = ARG_ELEMENT; return ASM_POPI;
+        case BC_JMP:
+        case BC_JE:
+        case BC_JNE:
+        case BC_CALL:
+            *kind = ARG_LABEL;
+            return opcode - BC_ADD + ASM_ADD;
+        case BC_HALT:
+            return NO_OPCODE;
+        default:
+            *kind = ARG_NONE;
+            return opcode - BC_ADD + ASM_ADD;
+        }
+    }
+
+Error_t ByteCodeWrite(const ByteCode* code, FILE* fp)
+    {
+    assert(code);
+    assert(fp);
+
+    ByteFileHeader header = {};
+    memcpy(&header.magic, BYTE_MAGIC, BYTE_MAGIC_SIZE);
+    header.version        = BYTE_VERSION;
+    header.memory_size    = (unsigned) code->memory_size;
+    header.code_count     = (unsigned) code->size;
+    header.constant_count = (unsigned) code->constant_count;
+    header.label_count    = (unsigned) code->label_count;
+
+    header.code_offset      = AlignOffset(sizeof(header));
+    header.constants_offset = AlignOffset(header.code_offset      + header.code_count     * (unsigned) sizeof(ByteInstr));
+    header.labels_offset    = AlignOffset(header.constants_offset + header.constant_count * (unsigned) sizeof(double));
+    header.file_size        = header.labels_offset + header.label_count * (unsigned) sizeof(ByteLabel);
+
+    unsigned offset = 0;
+    WriteSection(&header,         sizeof(header),                                       &offset, fp);
+    WriteSection(code->code,      header.code_count     * (unsigned) sizeof(ByteInstr), &offset, fp);
+    WriteSection(code->constants, header.constant_count * (unsigned) sizeof(double),    &offset, fp);
+    WriteSection(code->labels,    header.label_count    * (unsigned) sizeof(ByteLabel), &offset, fp);
+
+    if (ferror(fp))
+        {
+        perror("Cannot write bytecode file");
+        return FileError;
+        }
+
+    return Ok;
+    }
+
+// Текст ассемблера не может начинаться с BYTE_MAGIC: команды и метки пишутся строчными буквами
+bool IsByteCodeFile(FILE* fp)
+    {
+    assert(fp);
+
+    unsigned magic = 0;
+    long     pos   = ftell(fp);
+    size_t   read  = fread(&magic, sizeof(char), BYTE_MAGIC_SIZE, fp);
+    fseek(fp, pos, SEEK_SET);
+
+    return read == BYTE_MAGIC_SIZE && !memcmp(&magic, BYTE_MAGIC, BYTE_MAGIC_SIZE);
+    }
+
+// Массивы кода указывают прямо в отображённый файл, разбора нет:
+// проверяется заголовок и то, что аргументы всех команд в пределах.
+Error_t ByteCodeMap(ByteCode* code, int fd)
+    {
+    assert(code);
+
+    struct stat sb = {};
+    if (fstat(fd, &sb) == -1 || (size_t) sb.st_size < sizeof(ByteFileHeader))
+        {
+        printf("Error: bytecode file is too short\n");
+        return SyntaxError;
+        }
+
+    size_t size = (size_t) sb.st_size;
+    void*  map  = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+        {
+        perror("Cannot map bytecode file");
+        return FileError;
+        }
+
+    char*                 file   = (char*) map;
+    const ByteFileHeader* header = (const ByteFileHeader*) map;
+
+    if (memcmp(&header->magic, BYTE_MAGIC, BYTE_MAGIC_SIZE) || header->version != BYTE_VERSION ||
+        header->file_size != size || header->code_count == 0 || header->memory_size > INT_MAX ||
+        header->code_offset      + (size_t) header->code_count     * sizeof(ByteInstr) > size ||
+        header->constants_offset + (size_t) header->constant_count * sizeof(double)    > size ||
+        header->labels_offset    + (size_t) header->label_count    * sizeof(ByteLabel) > size ||
+        (header->code_offset | header->constants_offset | header->labels_offset) % SECTION_ALIGNMENT)
+        {
+        printf("Error: wrong bytecode file header\n");
+        munmap(map, size);
+        return SyntaxError;
+        }
+
+    ByteCodeDtor(code);
+
+    code->mapping           = map;
+    code->mapping_size      = size;
+
+    code->code              = (ByteInstr*) (void*) (file + header->code_offset);
+    code->constants         = (double*)    (void*) (file + header->constants_offset);
+    code->labels            = (ByteLabel*) (void*) (file + header->labels_offset);
+    code->size              = (int) header->code_count;
+    code->capacity          = (int) header->code_count;
+    code->constant_count    = (int) header->constant_count;
+    code->constant_capacity = (int) header->constant_count;
+    code->label_count       = (int) header->label_count;
+    code->label_capacity    = (int) header->label_count;
+    code->memory_size       = (int) header->memory_size;
+
+    if (ByteCodeCheck(code) != Ok)
+        {
+        printf("Error: wrong bytecode in file\n");
+        ByteCodeDtor(code);
+        return SyntaxError;
+        }
+
+    return Ok;
+    }
+
+// Код из файла должен быть таким же, какой собирает ассемблер: halt только в конце,
+// аргументы в пределах таблиц, метки по возрастанию номеров команд
+static Error_t ByteCodeCheck(const ByteCode* code)
+    {
+    if (code->code[code->size - 1].opcode != BC_HALT) return SyntaxError;
+
+    for (int pos = 0; pos < code->size; pos++)
+        {
+        int opcode = code->code[pos].opcode;
+        int arg    = code->code[pos].arg;
+
+        switch (opcode)
+            {
+            case BC_HALT:
+                if (pos != code->size - 1) return SyntaxError;
+                break;
+            case BC_PUSH_NUMBER:
+                if (arg < 0 || arg >= code->constant_count) return SyntaxError;
+                break;
+            case BC_PUSH_MEMORY:
+            case BC_POP_MEMORY:
+                if (arg < 0 || arg >= code->memory_size) return SyntaxError;
+                break;
+            case BC_PUSH_ELEMENT:
+            case BC_POP_ELEMENT:
+                if (arg < 0 || arg > code->memory_size - ASM_ARRAY_SIZE) return SyntaxError;
+                break;
+            case BC_PUSH_REG:
+            case BC_POP_REG:
+                if (arg < 0 || arg >= ASM_REGISTER_COUNT) return SyntaxError;
+                break;
+            case BC_JMP:
+            case BC_JE:
+            case BC_JNE:
+            case BC_CALL:
+                if (arg < 0 || arg >= code->size) return SyntaxError;
+                break;
+            default:
+                if (opcode < 0 || opcode >= BC_OPCODE_COUNT) return SyntaxError;
+                break;
+            }
+        }
+
+    for (int label = 0; label < code->label_count; label++)
+        {
+        const ByteLabel* name = code->labels + label;
+        if (name->kind < LABEL_FUNC || name->kind > LABEL_TARGET || name->target < 0 || name->target >= code->size ||
+            (label && name->target < code->labels[label - 1].target)) return SyntaxError;
+        }
+
+    return Ok;
+    }
@@ -0,0 +1,124 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+const char     BYTE_MAGIC[]      = "RABC";
+const int      BYTE_MAGIC_SIZE   = 4;
+const unsigned BYTE_VERSION      = 1;
+
+// Команды ассемблера, разделённые по виду аргумента, чтобы исполнителю не
+// приходилось разбирать аргумент во время работы
+enum ByteOpcode
+    {
+    BC_HALT         = 0,
+    BC_PUSH_NUMBER  = 1,
+    BC_PUSH_MEMORY  = 2,
+    BC_PUSH_REG     = 3,
+    BC_POP_MEMORY   = 4,
+    BC_POP_REG      = 5,
+    BC_POP_TRASH    = 6,
+    BC_ADD          = 7,
+    BC_SUB          = 8,
+    BC_MUL          = 9,
+    BC_DIV          = 10,
+    BC_POW          = 11,
+    BC_GT           = 12,
+    BC_LT           = 13,
+    BC_GE           = 14,
+    BC_LE           = 15,
+    BC_EQ           = 16,
+    BC_NE           = 17,
+    BC_AND          = 18,
+    BC_OR           = 19,
+    BC_NOT          = 20,
+    BC_SIN          = 21,
+    BC_COS          = 22,
+    BC_SQRT         = 23,
+    BC_IN           = 24,
+    BC_OUT          = 25,
+    BC_JMP          = 26,
+    BC_JE           = 27,
+    BC_JNE          = 28,
+    BC_CALL         = 29,
+    BC_RET          = 30,
+    BC_PUSH_ELEMENT = 31,
+    BC_POP_ELEMENT  = 32,
+    BC_OPCODE_COUNT
+    };
+
+// arg - номер константы, адрес (у элементов - начало массива), номер регистра или номер команды перехода
+struct ByteInstr
+    {
+    int         opcode;
+    int         arg;
+    };
+
+// Метка бэкенда (вид и номера, как в AsmLabel) и номер команды, на которую она указывает.
+// Исполнителю не нужна, по ней восстанавливается текст ассемблера.
+struct ByteLabel
+    {
+    int         kind;
+    int         number;
+    int         order;
+    int         target;
+    };
+
+// Упакованный код: метки уже заменены номерами команд, числа лежат в constants,
+// memory_size - сколько ячеек памяти нужно программе. Если код отображён из
+// объектного файла, массивы указывают в mapping и дописывать в них нельзя.
+struct ByteCode
+    {
+    ByteInstr*  code;
+    int         size;
+    int         capacity;
+
+    double*     constants;
+    int         constant_count;
+    int         constant_capacity;
+
+    ByteLabel*  labels;
+    int         label_count;
+    int         label_capacity;
+
+    int         memory_size;
+
+    void*       mapping;
+    size_t      mapping_size;
+
+    Error_t     error;
+    };
+
+// Объектный файл: заголовок, затем команды, константы и метки как есть.
+// Смещения считаются от начала файла и кратны SECTION_ALIGNMENT.
+// magic - байты BYTE_MAGIC, хранятся числом, чтобы в заголовке не было массивов
+struct ByteFileHeader
+    {
+    unsigned    magic;
+    unsigned    version;
+    unsigned    file_size;
+    unsigned    memory_size;
+
+    unsigned    code_count;
+    unsigned    constant_count;
+    unsigned    label_count;
+
+    unsigned    code_offset;
+    unsigned    constants_offset;
+    unsigned    labels_offset;
+    };
+
+Error_t ByteCodeCtor(ByteCode* code);
+Error_t ByteCodeDtor(ByteCode* code);
+
+int     ByteOpcodeOf(const int opcode, const int kind);
+void    ByteEmit(ByteCode* code, const int opcode, const int arg = 0);
+int     ByteConstant(ByteCode* code, const double value);
+void    ByteAddLabel(ByteCode* code, const AsmLabel* label, const int target);
+
+Error_t AsmToByteCode(ByteCode* byte, const AsmCode* code);
+Error_t ByteCodeToAsm(AsmCode* code, const ByteCode* byte);
+
+Error_t ByteCodeWrite(const ByteCode* code, FILE* fp);
+Error_t ByteCodeMap(ByteCode* code, int fd);
+bool    IsByteCodeFile(FILE* fp);
+
+#endif //BYTECODE_H
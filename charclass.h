@@ -0,0 +1,77 @@
+#ifndef CHARCLASS_H
+#define CHARCLASS_H
+
+enum CharClass
+    {
+    CHAR_OTHER      = 0,
+    CHAR_SPACE      = 1,
+    CHAR_DIGIT      = 2,
+    CHAR_LETTER     = 3,
+    CHAR_OPERATOR   = 4,
+    CHAR_LEAD       = 8,
+    };
+
+const int CHAR_ALPHABET     = 256;
+const int CHAR_MAX_LEADS    = 8;
+const int CHAR_CONT_MASK    = 0x3F;
+
+// Классы байтов для разбора UTF-8. Первый байт двухбайтовой буквы получает
+// класс CHAR_LEAD + номер строки, строка - битовая маска допустимых вторых байтов.
+struct CharClasses
+    {
+    unsigned char       byte[CHAR_ALPHABET];
+    unsigned long long  second[CHAR_MAX_LEADS];
+    int                 lead_count;
+    };
+
+template <size_t Count>
+constexpr CharClasses BuildCharClasses(const char* const (&letters)[Count])
+    {
+    CharClasses classes = {};
+
+    for (int c = 0x21; c < 0x7F; c++) classes.byte[c] = CHAR_OPERATOR;
+    for (int c = '0'; c <= '9'; c++)  classes.byte[c] = CHAR_DIGIT;
+    for (int c = 'A'; c <= 'Z'; c++)  classes.byte[c] = CHAR_LETTER;
+    for (int c = 'a'; c <= 'z'; c++)  classes.byte[c] = CHAR_LETTER;
+    classes.byte['_'] = CHAR_LETTER;
+    classes.byte['$'] = CHAR_LETTER;
+
+    const char spaces[] = " \t\n\v\f\r";
+    for (const char* c = spaces; *c; c++) classes.byte[(unsigned char) *c] = CHAR_SPACE;
+
+    // Допускаются только двухбайтовые буквы
+    for (size_t i = 0; i < Count; i++)
+        {
+        unsigned char lead   = (unsigned char) letters[i][0];
+        unsigned char second = (unsigned char) letters[i][1];
+
+        if (classes.byte[lead] < CHAR_LEAD)
+            {
+            classes.byte[lead] = (unsigned char) (CHAR_LEAD + classes.lead_count++);
+            }
+        classes.second[classes.byte[lead] - CHAR_LEAD] |= 1ull << (second & CHAR_CONT_MASK);
+        }
+
+    return classes;
+    }
+
+inline int CharClassOf(const CharClasses* classes, const char c)
+    {
+    return classes->byte[(unsigned char) c];
+    }
+
+// Длина буквы в байтах, начиная с str, или 0, если там не буква
+inline int CharLetterLength(const CharClasses* classes, const char* str)
+    {
+    int cls = classes->byte[(unsigned char) str[0]];
+
+    if (cls == CHAR_LETTER) return 1;
+    if (cls <  CHAR_LEAD)   return 0;
+
+    unsigned char second = (unsigned char) str[1];
+    if ((second & ~CHAR_CONT_MASK) != 0x80) return 0;
+
+    return (classes->second[cls - CHAR_LEAD] >> (second & CHAR_CONT_MASK) & 1) ? 2 : 0;
+    }
+
+#endif //CHARCLASS_H
@@ -0,0 +1,398 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "errors.h"
+#include "section.h"
+#include "node.h"
+#include "stack.h"
+#include "flattree.h"
+
+struct FlattenFrame
+    {
+    const Node* node;
+    NodeIndex   parent;
+    bool        right;
+    };
+
+static Error_t FlatTreeResize(FlatTree* tree, int capacity);
+static Error_t FlatTreeCheck(const FlatTree* tree, int value_count, unsigned names_size);
+
+Error_t FlatTreeCtor(FlatTree* tree)
+    {
+    assert(tree);
+
+    tree->tag   = nullptr;
+    tree->left  = nullptr;
+    tree->right = nullptr;
+    tree->data  = nullptr;
+    tree->size  = 0;
+    tree->capacity = 0;
+
+    tree->values         = nullptr;
+    tree->value_count    = 0;
+    tree->value_capacity = 0;
+
+    tree->root = NIL_NODE;
+
+    tree->symbols      = nullptr;
+    tree->names        = nullptr;
+    tree->symbol_count = 0;
+
+    tree->mapping      = nullptr;
+    tree->mapping_size = 0;
+
+    if (FlatTreeResize(tree, FLAT_DEFAULT_SIZE) != Ok)
+        {
+        return AllocationError;
+        }
+
+    tree->tag[NIL_NODE]   = 0;
+    tree->left[NIL_NODE]  = NIL_NODE;
+    tree->right[NIL_NODE] = NIL_NODE;
+    tree->data[NIL_NODE]  = 0;
+    tree->size = 1;
+
+    return Ok;
+    }
+
+Error_t FlatTreeDtor(FlatTree* tree)
+    {
+    assert(tree);
+
+    if (tree->mapping)
+        {
+        munmap(tree->mapping, tree->mapping_size);
+        }
+    else
+        {
+        free(tree->tag);
+        free(tree->left);
+        free(tree->right);
+        free(tree->data);
+        free(tree->values);
+        }
+
+    tree->mapping      = nullptr;
+    tree->mapping_size = 0;
+    tree->symbols      = nullptr;
+    tree->names        = nullptr;
+    tree->symbol_count = 0;
+
+    tree->tag    = nullptr;
+    tree->left   = nullptr;
+    tree->right  = nullptr;
+    tree->data   = nullptr;
+    tree->values = nullptr;
+
+    tree->size        = 0;
+    tree->capacity    = 0;
+    tree->value_count = 0;
+    tree->root        = NIL_NODE;
+
+    return Ok;
+    }
+
+// Удаляет все узлы, но оставляет память под следующее дерево
+void FlatTreeClear(FlatTree* tree)
+    {
+    assert(tree);
+    assert(!tree->mapping);
+
+    tree->size        = 1;
+    tree->value_count = 0;
+    tree->root        = NIL_NODE;
+    }
+
+NodeIndex FlatTreeAdd(FlatTree* tree, const int type, const Data_t data)
+    {
+    assert(tree);
+
+    if (tree->size == tree->capacity &&
+        FlatTreeResize(tree, tree->capacity * FLAT_GROW_COEFF) != Ok)
+        {
+        return NIL_NODE;
+        }
+
+    NodeIndex node = (NodeIndex) tree->size;
+
+    tree->left[node]  = NIL_NODE;
+    tree->right[node] = NIL_NODE;
+
+    switch (type)
+        {
+        case OPERATION:
+        case PUNCTUATION:
+            tree->tag[node]  = (NodeTag) (type << FLAT_TYPE_SHIFT | (data.id & FLAT_CODE_MASK));
+            tree->data[node] = 0;
+            break;
+        case VALUE:
+            {
+            if (tree->value_count == tree->value_capacity)
+                {
+                int     capacity   = tree->value_capacity ? tree->value_capacity * FLAT_GROW_COEFF : FLAT_DEFAULT_SIZE;
+                double* new_values = (double*) realloc(tree->values, (size_t) capacity * sizeof(double));
+                if (!new_values)
+                    {
+                    printf("Error: cannot allocate memory for flat tree values\n");
+                    return NIL_NODE;
+                    }
+                tree->values         = new_values;
+                tree->value_capacity = capacity;
+                }
+
+            tree->values[tree->value_count] = data.val;
+            tree->tag[node]  = (NodeTag) (type << FLAT_TYPE_SHIFT);
+            tree->data[node] = tree->value_count++;
+            break;
+            }
+        default:
+            tree->tag[node]  = (NodeTag) (type << FLAT_TYPE_SHIFT);
+            tree->data[node] = data.id;
+            break;
+        }
+
+    tree->size++;
+
+    return node;
+    }
+
+// Узлы нумеруются в прямом порядке. В стеке лежат ещё не созданные потомки
+// вместе с местом, куда записать их номер; правый кладётся раньше левого.
+Error_t FlattenTree(FlatTree* tree, const Node* root)
+    {
+    assert(tree);
+
+    tree->root = NIL_NODE;
+    if (!root) return Ok;
+
+    Stack stack = {};
+    if (StackCtor(&stack, sizeof(FlattenFrame)) != Ok) return AllocationError;
+
+    FlattenFrame frame = {root, NIL_NODE, false};
+    Error_t      state = StackPush(&stack, &frame);
+
+    while (state == Ok && stack.size)
+        {
+        StackPop(&stack, &frame);
+
+        NodeIndex node = FlatTreeAdd(tree, frame.node->type, frame.node->data);
+        if (node == NIL_NODE)
+            {
+            state = AllocationError;
+            break;
+            }
+
+        if      (frame.parent == NIL_NODE) tree->root                = node;
+        else if (frame.right)              tree->right[frame.parent] = node;
+        else                               tree->left[frame.parent]  = node;
+
+        FlattenFrame right = {frame.node->right, node, true};
+        FlattenFrame left  = {frame.node->left,  node, false};
+        if (right.node) state = StackPush(&stack, &right);
+        if (left.node && state == Ok) state = StackPush(&stack, &left);
+        }
+
+    StackDtor(&stack);
+
+    return state;
+    }
+
+Error_t FlatTreeWrite(const FlatTree* tree, const FlatSymbol* symbols, int symbol_count, const char* names, FILE* fp)
+    {
+    assert(tree);
+    assert(fp);
+    assert(symbols || !symbol_count);
+
+    FlatFileHeader header = {};
+    memcpy(&header.magic, FLAT_MAGIC, FLAT_MAGIC_SIZE);
+    header.version      = FLAT_VERSION;
+    header.root         = tree->root;
+    header.node_count   = (unsigned) tree->size;
+    header.value_count  = (unsigned) tree->value_count;
+    header.symbol_count = (unsigned) symbol_count;
+
+    for (int i = 0; i < symbol_count; i++) header.names_size += (unsigned) symbols[i].length;
+
+    unsigned nodes = header.node_count;
+    header.tag_offset     = AlignOffset(sizeof(header));
+    header.left_offset    = AlignOffset(header.tag_offset     + nodes * (unsigned) sizeof(NodeTag));
+    header.right_offset   = AlignOffset(header.left_offset    + nodes * (unsigned) sizeof(NodeIndex));
+    header.data_offset    = AlignOffset(header.right_offset   + nodes * (unsigned) sizeof(NodeIndex));
+    header.values_offset  = AlignOffset(header.data_offset    + nodes * (unsigned) sizeof(int));
+    header.symbols_offset = AlignOffset(header.values_offset  + header.value_count  * (unsigned) sizeof(double));
+    header.names_offset   = AlignOffset(header.symbols_offset + header.symbol_count * (unsigned) sizeof(FlatSymbol));
+    header.file_size      = header.names_offset + header.names_size;
+
+    unsigned offset = 0;
+    WriteSection(&header,      sizeof(header),                                      &offset, fp);
+    WriteSection(tree->tag,    nodes * (unsigned) sizeof(NodeTag),                  &offset, fp);
+    WriteSection(tree->left,   nodes * (unsigned) sizeof(NodeIndex),                &offset, fp);
+    WriteSection(tree->right,  nodes * (unsigned) sizeof(NodeIndex),                &offset, fp);
+    WriteSection(tree->data,   nodes * (unsigned) sizeof(int),                      &offset, fp);
+    WriteSection(tree->values, header.value_count * (unsigned) sizeof(double),      &offset, fp);
+
+    // Имена пишутся подряд, смещения символов пересчитываются
+    int names_offset = 0;
+    for (int i = 0; i < symbol_count; i++)
+        {
+        FlatSymbol symbol = symbols[i];
+        symbol.offset = names_offset;
+        names_offset += symbol.length;
+
+        WriteSection(&symbol, sizeof(symbol), &offset, fp);
+        }
+
+    WriteSection(nullptr, 0, &offset, fp);
+    for (int i = 0; i < symbol_count; i++)
+        {
+        fwrite(names + symbols[i].offset, sizeof(char), (size_t) symbols[i].length, fp);
+        }
+
+    if (ferror(fp))
+        {
+        perror("Cannot write tree file");
+        return FileError;
+        }
+
+    return Ok;
+    }
+
+// Текстовое дерево не может начинаться с первой буквы FLAT_MAGIC, поэтому хватает
+// одного байта, и файл не нужно перематывать: так можно читать и из канала.
+// Полностью заголовок проверяет FlatTreeMap.
+bool IsFlatTreeFile(FILE* fp)
+    {
+    assert(fp);
+
+    int c = getc(fp);
+    ungetc(c, fp);
+
+    return c == FLAT_MAGIC[0];
+    }
+
+// Массивы дерева указывают прямо в отображённый файл, разбора нет:
+// проверяется только заголовок и то, что все номера узлов и констант в пределах.
+Error_t FlatTreeMap(FlatTree* tree, int fd)
+    {
+    assert(tree);
+
+    struct stat sb = {};
+    if (fstat(fd, &sb) == -1 || (size_t) sb.st_size < sizeof(FlatFileHeader))
+        {
+        printf("Error: tree file is too short\n");
+        return SyntaxError;
+        }
+
+    size_t size = (size_t) sb.st_size;
+    void*  map  = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+        {
+        perror("Cannot map tree file");
+        return FileError;
+        }
+
+    char*                 file   = (char*) map;
+    const FlatFileHeader* header = (const FlatFileHeader*) map;
+    unsigned              nodes  = header->node_count;
+
+    if (memcmp(&header->magic, FLAT_MAGIC, FLAT_MAGIC_SIZE) || header->version != FLAT_VERSION ||
+        header->file_size != size || nodes == 0 ||
+        header->tag_offset     + (size_t) nodes * sizeof(NodeTag)                  > size ||
+        header->left_offset    + (size_t) nodes * sizeof(NodeIndex)                > size ||
+        header->right_offset   + (size_t) nodes * sizeof(NodeIndex)                > size ||
+        header->data_offset    + (size_t) nodes * sizeof(int)                      > size ||
+        header->values_offset  + (size_t) header->value_count  * sizeof(double)     > size ||
+        header->symbols_offset + (size_t) header->symbol_count * sizeof(FlatSymbol) > size ||
+        header->names_offset   + (size_t) header->names_size                        > size ||
+        (header->tag_offset | header->left_offset | header->right_offset | header->data_offset |
+         header->values_offset | header->symbols_offset) % SECTION_ALIGNMENT)
+        {
+        printf("Error: wrong tree file header\n");
+        munmap(map, size);
+        return SyntaxError;
+        }
+
+    FlatTreeDtor(tree);
+
+    tree->mapping        = map;
+    tree->mapping_size   = size;
+
+    tree->tag            = (NodeTag*)   (void*) (file + header->tag_offset);
+    tree->left           = (NodeIndex*) (void*) (file + header->left_offset);
+    tree->right          = (NodeIndex*) (void*) (file + header->right_offset);
+    tree->data           = (int*)       (void*) (file + header->data_offset);
+    tree->values         = (double*)    (void*) (file + header->values_offset);
+    tree->size           = (int) nodes;
+    tree->capacity       = (int) nodes;
+    tree->value_count    = (int) header->value_count;
+    tree->value_capacity = (int) header->value_count;
+    tree->root           = header->root;
+
+    tree->symbols        = (const FlatSymbol*) (void*) (file + header->symbols_offset);
+    tree->symbol_count   = (int) header->symbol_count;
+    tree->names          = file + header->names_offset;
+
+    if (tree->root >= nodes || FlatTreeCheck(tree, tree->value_count, header->names_size) != Ok)
+        {
+        printf("Error: tree file is damaged\n");
+        FlatTreeDtor(tree);
+        return SyntaxError;
+        }
+
+    return Ok;
+    }
+
+static Error_t FlatTreeCheck(const FlatTree* tree, int value_count, unsigned names_size)
+    {
+    assert(tree);
+
+    NodeIndex nodes = (NodeIndex) tree->size;
+    for (NodeIndex node = 0; node < nodes; node++)
+        {
+        if (tree->left[node] >= nodes || tree->right[node] >= nodes) return SyntaxError;
+        if (FlatType(tree, node) == VALUE && (tree->data[node] < 0 || tree->data[node] >= value_count))
+            {
+            return SyntaxError;
+            }
+        }
+
+    for (int i = 0; i < tree->symbol_count; i++)
+        {
+        const FlatSymbol* symbol = tree->symbols + i;
+        if (symbol->offset < 0 || symbol->length < 0 ||
+            (unsigned) symbol->offset + (unsigned) symbol->length > names_size)
+            {
+            return SyntaxError;
+            }
+        }
+
+    return Ok;
+    }
+
+
+static Error_t FlatTreeResize(FlatTree* tree, int capacity)
+    {
+    assert(tree);
+
+    NodeTag*   new_tag   = (NodeTag*)   realloc(tree->tag,   (size_t) capacity * sizeof(NodeTag));
+    if (new_tag)   tree->tag   = new_tag;
+    NodeIndex* new_left  = (NodeIndex*) realloc(tree->left,  (size_t) capacity * sizeof(NodeIndex));
+    if (new_left)  tree->left  = new_left;
+    NodeIndex* new_right = (NodeIndex*) realloc(tree->right, (size_t) capacity * sizeof(NodeIndex));
+    if (new_right) tree->right = new_right;
+    int*       new_data  = (int*)       realloc(tree->data,  (size_t) capacity * sizeof(int));
+    if (new_data)  tree->data  = new_data;
+
+    if (!new_tag || !new_left || !new_right || !new_data)
+        {
+        printf("Error: cannot allocate memory for flat tree\n");
+        return AllocationError;
+        }
+
+    tree->capacity = capacity;
+
+    return Ok;
+    }
@@ -0,0 +1,112 @@
+#ifndef FLATTREE_H
+#define FLATTREE_H
+
+typedef unsigned int   NodeIndex;
+typedef unsigned short NodeTag;
+
+const NodeIndex NIL_NODE            = 0;
+const int       FLAT_TYPE_SHIFT     = 12;
+const int       FLAT_CODE_MASK      = (1 << FLAT_TYPE_SHIFT) - 1;
+const int       FLAT_DEFAULT_SIZE   = 256;
+const int       FLAT_GROW_COEFF     = 2;
+
+const char      FLAT_MAGIC[]        = "RAST";
+const int       FLAT_MAGIC_SIZE     = 4;
+const unsigned  FLAT_VERSION        = 1;
+
+// Имя из таблицы имён фронтенда: тип и номер узла, байты имени в names
+struct FlatSymbol
+    {
+    int         type;
+    int         index;
+    int         offset;
+    int         length;
+    };
+
+// Дерево в виде структуры массивов: узел - это номер, 0 зарезервирован под nil.
+// tag = тип << 12 | код операции, data - номер имени или номер константы в values.
+struct FlatTree
+    {
+    NodeTag*    tag;
+    NodeIndex*  left;
+    NodeIndex*  right;
+    int*        data;
+    int         size;
+    int         capacity;
+
+    double*     values;
+    int         value_count;
+    int         value_capacity;
+
+    NodeIndex   root;
+
+    const FlatSymbol*   symbols;
+    const char*         names;
+    int                 symbol_count;
+
+    void*       mapping;
+    size_t      mapping_size;
+    };
+
+// Двоичный файл дерева: заголовок, затем массивы FlatTree как есть, константы,
+// символы и байты имён. Смещения считаются от начала файла и кратны SECTION_ALIGNMENT.
+// magic - байты FLAT_MAGIC, хранятся числом, чтобы в заголовке не было массивов
+struct FlatFileHeader
+    {
+    unsigned    magic;
+    unsigned    version;
+    unsigned    file_size;
+    NodeIndex   root;
+
+    unsigned    node_count;
+    unsigned    value_count;
+    unsigned    symbol_count;
+    unsigned    names_size;
+
+    unsigned    tag_offset;
+    unsigned    left_offset;
+    unsigned    right_offset;
+    unsigned    data_offset;
+    unsigned    values_offset;
+    unsigned    symbols_offset;
+    unsigned    names_offset;
+    unsigned    reserved;
+    };
+
+Error_t   FlatTreeCtor(FlatTree* tree);
+Error_t   FlatTreeDtor(FlatTree* tree);
+void      FlatTreeClear(FlatTree* tree);
+
+NodeIndex FlatTreeAdd(FlatTree* tree, const int type, const Data_t data);
+Error_t   FlattenTree(FlatTree* tree, const Node* root);
+
+Error_t   FlatTreeWrite(const FlatTree* tree, const FlatSymbol* symbols, int symbol_count, const char* names, FILE* fp);
+Error_t   FlatTreeMap(FlatTree* tree, int fd);
+bool      IsFlatTreeFile(FILE* fp);
+
+inline int FlatType(const FlatTree* tree, const NodeIndex node)
+    {
+    return tree->tag[node] >> FLAT_TYPE_SHIFT;
+    }
+
+inline int FlatCode(const FlatTree* tree, const NodeIndex node)
+    {
+    return tree->tag[node] & FLAT_CODE_MASK;
+    }
+
+inline int FlatId(const FlatTree* tree, const NodeIndex node)
+    {
+    return tree->data[node];
+    }
+
+inline double FlatValue(const FlatTree* tree, const NodeIndex node)
+    {
+    return tree->values[tree->data[node]];
+    }
+
+inline bool IsFlatOperation(const FlatTree* tree, const NodeIndex node, const int code)
+    {
+    return tree->tag[node] == (NodeTag) (OPERATION << FLAT_TYPE_SHIFT | code);
+    }
+
+#endif //FLATTREE_H
@@ -1,53 +1,81 @@
 #include <stdio.h>
 #include <assert.h>
 #include <stdlib.h>
-#include <ctype.h>
 #include <string.h>
+#include <limits.h>
+#include <charconv>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "errors.h"
 #include "node.h"
 #include "tree.h"
-#include "list.h"
+#include "tokens.h"
+#include "trie.h"
+#include "charclass.h"
+#include "scan.h"
+#include "nametable.h"
+#include "flattree.h"
+#include "treeio.h"
+#include "middlend.h"
+#include "interp.h"
+#include "timer.h"
 #include "frontend.h"
 
-static void ReadNumber(Compiler* cmp, Node* node);
-static void ReadKeyWord(Compiler* cmp, Node* node);
-static void NewKeyWord(Compiler* cmp, Node* node, int index);
-static void ReadOperation(Compiler* cmp, Node* node);
-
-static int  IsLetter(char* str, int pos);
-static int  IsNumber(char* str, int pos);
-
-static const char DEFAULT_TREE_FILENAME[] = "tree.txt";
-
-int main(int argc, char *argv[])
+static void ReadNumber(Compiler* cmp);
+static void ReadKeyWord(Compiler* cmp);
+static void NewKeyWord(Compiler* cmp, const Token* last, int length);
+static void UpdateScope(Compiler* cmp, int punctuation);
+static void ReadOperation(Compiler* cmp);
+static void AddToken(Compiler* cmp, int type, Data_t data, int length);
+static void NextToken(Compiler* cmp);
+static void StopTokens(Compiler* cmp);
+static int  FindKeyWord(Compiler* cmp, bool whole_word, int* length);
+
+static Error_t MapSource(Compiler* cmp, int fd, size_t size);
+static Error_t OpenStream(Compiler* cmp, int fd);
+static void    ReadChunk(Compiler* cmp);
+static void    CloseSource(Compiler* cmp);
+
+static int  IsLetter(const char* str, int pos);
+static int  IsNumber(const char* str, int pos);
+static bool IsWordContinue(Compiler* cmp, int pos);
+
+static constexpr size_t KEY_WORDS_TRIE_SIZE = TrieMaxNodes(KEY_WORDS);
+static constexpr Trie<KEY_WORDS_TRIE_SIZE> KEY_WORDS_TRIE = BuildTrie<KEY_WORDS_TRIE_SIZE>(KEY_WORDS);
+static constexpr CharClasses CHAR_CLASSES = BuildCharClasses(BASHKIR_LETTERS);
+
+static constexpr OperatorTable BuildOperatorTable()
     {
-    const char* file_from = nullptr;
-    const char* file_to   = DEFAULT_TREE_FILENAME;
+    OperatorTable table = {};
 
-    if (argc < 2)
-        {
-        printf("Incorrect args number\n");
-        return FileError;
-        }
-    else if (argc == 2)
-        {
-        file_from = argv[1];
-        }
-    else if (argc > 2)
+    for (const BinaryOperator& oper : BINARY_OPERATORS)
         {
-        file_from = argv[1];
-        file_to   = argv[2];
+        table.info[oper.code].level = (unsigned char) oper.level;
+        table.info[oper.code].assoc = (unsigned char) oper.assoc;
         }
 
-    Frontend(file_from, file_to);
-    return 0;
+    for (const int code : PREFIX_OPERATORS) table.info[code].prefix = true;
+
+    return table;
     }
 
-Error_t Frontend(const char* file_from, const char* file_to)
+static constexpr OperatorTable OPERATORS = BuildOperatorTable();
+
+static const char   STDIN_FILENAME[]  = "-";
+static const off_t  SOURCE_MAP_LIMIT  = 1 << 30;
+static const int    SOURCE_CHUNK_SIZE = 1 << 16;
+static const int    SOURCE_LOOKAHEAD  = 1 << 10;
+
+#define TOKEN           (cmp->tokens.array[cmp->tokens.pos - cmp->tokens.first])
+#define SKIP_TOKEN()    NextToken(cmp)
+
+Error_t Frontend(const char* file_from, const char* file_to, const FrontendFlags* flags)
     {
     assert(file_from);
     assert(file_to);
+    assert(flags);
 
     Compiler cmp = {};
     CompilerCtor(&cmp, file_from);
@@ -56,24 +84,29 @@ Error_t Frontend(const char* file_from, const char* file_to)
         return cmp.error;
         }
 
-    TokenParsing(&cmp);
-    if (cmp.error)
+    if (flags->lex)
         {
+        LexProgram(&cmp);
         CompilerDtor(&cmp);
         return cmp.error;
         }
 
-    //ListDump(&cmp.tokens, 0);
+    if (ParseProgram(&cmp) != Ok)
+        {
+        CompilerDtor(&cmp);
+        return cmp.error;
+        }
 
-    if (GetGrammar(&cmp) != Ok)
+    if (flags->optimize) OptimizeProgram(&cmp, flags->report);
+    if (cmp.error)
         {
-        TreeDump(&cmp.tree, 0);
         CompilerDtor(&cmp);
-        return SyntaxError;
+        return cmp.error;
         }
-    TreeDump(&cmp.tree, 0);
 
-    WriteTree(&cmp, file_to);
+    if      (flags->run)  RunProgram(&cmp, flags->report);
+    else if (flags->text) WriteTree(&cmp, file_to);
+    else                  WriteFlatTree(&cmp, file_to);
     if (cmp.error)
         {
         CompilerDtor(&cmp);
@@ -84,13 +117,85 @@ Error_t Frontend(const char* file_from, const char* file_to)
     return Ok;
     }
 
+// Упрощение выражений дерева программы, ошибка остаётся в cmp->error
+Error_t OptimizeProgram(Compiler* cmp, bool report)
+    {
+    assert(cmp);
+
+    long simplified = 0;
+    cmp->error = Middlend(&cmp->tree.root, &cmp->tree.arena, &simplified);
+    if (report) printf("Middlend: %ld simplifications\n", simplified);
+
+    return cmp->error;
+    }
+
+// Исполнение дерева программы без бэкенда, ошибка остаётся в cmp->error
+Error_t RunProgram(Compiler* cmp, bool report)
+    {
+    assert(cmp);
+
+    Interp interp = {};
+    cmp->error = InterpCtor(&interp, cmp->tree.root, stdin, stdout);
+    if (cmp->error) return cmp->error;
+
+    cmp->error = InterpRun(&interp);
+    if (report) InterpReport(&interp, stdout);
+    InterpDtor(&interp);
+
+    return cmp->error;
+    }
+
+// Дерево программы в cmp->tree, ошибка остаётся в cmp->error. Лексемы читаются
+// по мере разбора, так что в памяти лежит только окно вокруг текущей.
+Error_t ParseProgram(Compiler* cmp)
+    {
+    assert(cmp);
+
+    TokenParsing(cmp);
+
+    //TokensDump(&cmp->tokens, 0);
+
+    if (GetGrammar(cmp) != Ok || cmp->error)
+        {
+        TreeDump(&cmp->tree, 0);
+        if (!cmp->error) cmp->error = SyntaxError;
+        return cmp->error;
+        }
+    TreeDump(&cmp->tree, 0);
+
+    return Ok;
+    }
+
+// Только лексемы, без дерева: сколько байт исходника в секунду читает TokenParsing
+Error_t LexProgram(Compiler* cmp)
+    {
+    assert(cmp);
+
+    long   count = 0;
+    double start = Now();
+
+    TokenParsing(cmp);
+    while (!cmp->error && !(TOKEN.type == PUNCTUATION && TOKEN.data.id == NULL_TERMINATOR))
+        {
+        count++;
+        SKIP_TOKEN();
+        }
+
+    double time  = Now() - start;
+    long   bytes = cmp->base + cmp->size;
+    printf("Lexer: %ld bytes, %ld tokens in %.3f s, %.1f MB/s\n",
+           bytes, count, time, time > 0 ? (double) bytes / time / 1e6 : 0.0);
+
+    return cmp->error;
+    }
+
 Error_t CompilerCtor(Compiler* cmp, const char* filename)
     {
     assert(cmp);
     assert(filename);
 
-    FILE *fp = fopen(filename, "rb");
-    if (fp == NULL)
+    int fd = strcmp(filename, STDIN_FILENAME) ? open(filename, O_RDONLY) : dup(STDIN_FILENO);
+    if (fd == -1)
         {
         perror("Cannot open file\n");
         cmp->error = FileError;
@@ -98,62 +203,48 @@ Error_t CompilerCtor(Compiler* cmp, const char* filename)
         }
 
     struct stat sb = {0};
-    int fd = fileno(fp);
-
     if (fstat(fd, &sb) == -1)
         {
         perror("fstat() returned -1");
-        fclose(fp);
+        close(fd);
         cmp->error = FileError;
         return FileError;
         }
 
-    cmp->size = sb.st_size;
-
-    cmp->str = (char*) calloc(cmp->size, sizeof(char));
-    if (cmp->str == nullptr)
+    // Большие файлы и каналы читаются кусками, остальное отображается в память
+    Error_t state = Ok;
+    if (S_ISREG(sb.st_mode) && sb.st_size < SOURCE_MAP_LIMIT)
         {
-        perror("Cannot allocate memory for cmp->str");
-        fclose(fp);
-        cmp->error = AllocationError;
-        return AllocationError;
+        state = MapSource(cmp, fd, (size_t) sb.st_size);
+        close(fd);
         }
-
-    fread(cmp->str, sizeof(char), cmp->size, fp);
-    if (ferror(fp))
+    else
         {
-        perror("Cannot read file\n");
-        fclose(fp);
-        free(cmp->str);
-        cmp->error = FileError;
-        return FileError;
+        state = OpenStream(cmp, fd);
         }
 
-    fclose(fp);
-
-    cmp->name_count = DEFAULT_NAME_COUNT;
-    cmp->name_table = (Object*) calloc(cmp->name_count, sizeof(Object));
-    if (cmp->name_table == nullptr)
+    if (state != Ok)
         {
-        perror("Cannot allocate memory for cmp->name_table");
-        free(cmp->str);
-        cmp->error = AllocationError;
-        return AllocationError;
+        cmp->error = state;
+        return state;
         }
 
-    for (int i = 0; i < cmp->name_count; i++)
+    // В потоковом режиме окно перезаписывается, поэтому имена копируются в пул
+    if (NameTableCtor(&cmp->names, cmp->source ? nullptr : cmp->str) != Ok)
         {
-        cmp->name_table[i].type = VARIABLE;
-        cmp->name_table[i].name = nullptr;
+        CloseSource(cmp);
+        cmp->error = AllocationError;
+        return AllocationError;
         }
 
+    cmp->brace_depth = 0;
     cmp->arr_count = 0;
     cmp->var_count = 0;
     cmp->func_count = 0;
 
     cmp->error      = Ok;
 
-    ListCtor(&cmp->tokens);
+    TokensCtor(&cmp->tokens);
     TreeCtor(&cmp->tree);
 
     return Ok;
@@ -167,23 +258,137 @@ Error_t CompilerDtor(Compiler* cmp)
     cmp->size       = 0;
     cmp->error      = Ok;
 
-    free(cmp->str);
-    for (int i = 0; i < cmp->name_count; i++)
-        {
-        if (cmp->name_table[i].name) free(cmp->name_table[i].name);
-        }
-    free(cmp->name_table);
+    CloseSource(cmp);
+    NameTableDtor(&cmp->names);
 
-    cmp->name_count = 0;
+    cmp->brace_depth = 0;
     cmp->var_count = 0;
     cmp->func_count = 0;
 
-    ListDtor(&cmp->tokens);
+    TokensDtor(&cmp->tokens);
     TreeDtor(&cmp->tree);
 
     return Ok;
     }
 
+// Исходник отображается в память только для чтения. За последним байтом файла
+// всегда есть ноль: либо хвост последней страницы, либо лишняя анонимная страница.
+static Error_t MapSource(Compiler* cmp, int fd, size_t size)
+    {
+    assert(cmp);
+
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+
+    cmp->source   = nullptr;
+    cmp->window   = nullptr;
+    cmp->base     = 0;
+    cmp->eof      = true;
+    cmp->size     = (int) size;
+    cmp->map_size = (size / page_size + 1) * page_size;
+
+    void* map = mmap(nullptr, cmp->map_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED)
+        {
+        perror("Cannot map memory for source");
+        return AllocationError;
+        }
+
+    if (size && mmap(map, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+        {
+        perror("Cannot map source file");
+        munmap(map, cmp->map_size);
+        return FileError;
+        }
+
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    cmp->map = map;
+    cmp->str = (const char*) map;
+
+    return Ok;
+    }
+
+// Окно из SOURCE_CHUNK_SIZE байт, которое ReadChunk сдвигает по файлу.
+// Память под исходник не зависит от размера файла.
+static Error_t OpenStream(Compiler* cmp, int fd)
+    {
+    assert(cmp);
+
+    cmp->source = fdopen(fd, "rb");
+    if (cmp->source == nullptr)
+        {
+        perror("Cannot open source stream");
+        close(fd);
+        return FileError;
+        }
+
+    cmp->window = (char*) calloc(SOURCE_CHUNK_SIZE + 1, sizeof(char));
+    if (cmp->window == nullptr)
+        {
+        perror("Cannot allocate memory for source window");
+        fclose(cmp->source);
+        cmp->source = nullptr;
+        return AllocationError;
+        }
+
+    cmp->str      = cmp->window;
+    cmp->map      = nullptr;
+    cmp->size     = 0;
+    cmp->map_size = 0;
+    cmp->base     = 0;
+    cmp->eof      = false;
+
+    return Ok;
+    }
+
+// Переносит непрочитанный хвост окна в начало и дочитывает файл. Перед cmp->pos
+// остаётся один байт: ReadKeyWord смотрит на предыдущий символ.
+static void ReadChunk(Compiler* cmp)
+    {
+    assert(cmp);
+    assert(cmp->source);
+
+    char* window = cmp->window;
+    int   start  = cmp->pos > 0 ? cmp->pos - 1 : 0;
+    int   rest   = cmp->size - start;
+
+    memmove(window, window + start, (size_t) rest);
+    cmp->base += start;
+    cmp->pos  -= start;
+
+    size_t read = fread(window + rest, sizeof(char), (size_t) (SOURCE_CHUNK_SIZE - rest), cmp->source);
+    if (ferror(cmp->source))
+        {
+        perror("Cannot read file\n");
+        cmp->error = FileError;
+        }
+
+    cmp->size = rest + (int) read;
+    cmp->eof  = feof(cmp->source) || cmp->error;
+    window[cmp->size] = '\0';
+    }
+
+static void CloseSource(Compiler* cmp)
+    {
+    assert(cmp);
+
+    if (cmp->source)
+        {
+        fclose(cmp->source);
+        free(cmp->window);
+        }
+    else if (cmp->map)
+        {
+        munmap(cmp->map, cmp->map_size);
+        }
+
+    cmp->source   = nullptr;
+    cmp->window   = nullptr;
+    cmp->str      = nullptr;
+    cmp->map      = nullptr;
+    cmp->map_size = 0;
+    }
+
 Error_t WriteTree(Compiler* cmp, const char* filename)
     {
     assert(cmp);
@@ -197,288 +402,401 @@ Error_t WriteTree(Compiler* cmp, const char* filename)
         return FileError;
         }
 
-    PreorderNode(cmp->tree.root, fp);
+    if (WriteTextTree(cmp->tree.root, fp) != Ok) cmp->error = FileError;
 
     fclose(fp);
 
     return Ok;
     }
 
-Error_t TokenParsing(Compiler* cmp)
+// Двоичное дерево для бэкенда: плоские массивы и таблица имён
+Error_t WriteFlatTree(Compiler* cmp, const char* filename)
     {
     assert(cmp);
+    assert(filename);
+
+    FlatTree flat = {};
+    if (FlatTreeCtor(&flat) != Ok)
+        {
+        cmp->error = AllocationError;
+        return AllocationError;
+        }
+
+    int         symbol_count = cmp->names.size;
+    FlatSymbol* symbols      = (FlatSymbol*) calloc((size_t) symbol_count + 1, sizeof(FlatSymbol));
+    if (!symbols || FlattenTree(&flat, cmp->tree.root) != Ok)
+        {
+        free(symbols);
+        FlatTreeDtor(&flat);
+        cmp->error = AllocationError;
+        return AllocationError;
+        }
+
+    for (int i = 0; i < symbol_count; i++)
+        {
+        const Name* name = cmp->names.names + i;
+        symbols[i] = {name->type, name->index, name->offset, name->length};
+        }
+
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL)
+        {
+        perror("Cannot open file\n");
+        cmp->error = FileError;
+        }
+    else
+        {
+        if (FlatTreeWrite(&flat, symbols, symbol_count, cmp->names.text, fp) != Ok) cmp->error = FileError;
+        fclose(fp);
+        }
+
+    free(symbols);
+    FlatTreeDtor(&flat);
+
+    return cmp->error;
+    }
 
-    Node* node = cmp->tokens.head;
+// Дочитывает исходник, пока в окне не появится лексема номер tokens.pos
+Error_t TokenParsing(Compiler* cmp)
+    {
+    assert(cmp);
 
-    while (cmp->pos < cmp->size)
+    while (!cmp->error && cmp->tokens.pos >= cmp->tokens.first + cmp->tokens.size)
         {
-        if (isspace(cmp->str[cmp->pos])) cmp->pos++;
+        // Перед каждой лексемой в окне есть SOURCE_LOOKAHEAD байт или конец файла
+        if (!cmp->eof && cmp->size - cmp->pos < SOURCE_LOOKAHEAD) ReadChunk(cmp);
+        if (cmp->error) break;
+
+        if (cmp->pos >= cmp->size)
+            {
+            Data_t data = {.id = NULL_TERMINATOR};
+            AddToken(cmp, PUNCTUATION, data, 0);
+            }
+        else if (CharClassOf(&CHAR_CLASSES, cmp->str[cmp->pos]) == CHAR_SPACE)
+            {
+            cmp->pos = ScanSpaces(cmp->str, cmp->pos, cmp->size);
+            }
         else if (IsNumber(cmp->str, cmp->pos))
             {
-            ReadNumber(cmp, node);
+            ReadNumber(cmp);
             }
         else if (IsLetter(cmp->str, cmp->pos))
             {
-            ReadKeyWord(cmp, node);
+            ReadKeyWord(cmp);
             }
         else
             {
-            ReadOperation(cmp, node);
+            ReadOperation(cmp);
+            }
+
+        if (!cmp->error && !cmp->eof && cmp->pos >= cmp->size)
+            {
+            printf("Syntax error in pos %ld: token is longer than %d bytes\n", cmp->base + cmp->pos, SOURCE_LOOKAHEAD);
+            cmp->error = SyntaxError;
             }
-        if (node->right) node = node->right;
-        if (cmp->error)  return cmp->error;
         }
 
-    Data_t data = {.id = NULL_TERMINATOR};
-    ListInsert(node, PUNCTUATION, data);
+    if (cmp->error) StopTokens(cmp);
 
-    return Ok;
+    return cmp->error;
     }
 
-static void ReadNumber(Compiler* cmp, Node* node)
+static void NextToken(Compiler* cmp)
     {
     assert(cmp);
-    assert(node);
 
-    Data_t data = {.val = atof(cmp->str + cmp->pos)};
-    ListInsert(node, VALUE, data);
+    cmp->tokens.pos++;
+    TokenParsing(cmp);
+    }
 
-    bool dot = false;
+// После ошибки текущей лексемой становится конец программы, разбор на нём
+// останавливается, а ошибка остаётся в cmp->error
+static void StopTokens(Compiler* cmp)
+    {
+    assert(cmp);
 
-    if (cmp->str[cmp->pos] == '-' || cmp->str[cmp->pos] == '+')
-        {
-        ++cmp->pos;
-        }
+    Tokens* tokens = &cmp->tokens;
+    Token*  last   = tokens->array + tokens->size - 1;
 
-    while ('0' <= cmp->str[cmp->pos] && cmp->str[cmp->pos] <= '9' || cmp->str[cmp->pos] == '.')
-        {
-        if (cmp->str[cmp->pos] == '.')
-            {
-            if (dot)
-                {
-                printf("Syntax error in pos %d: %s\n", cmp->pos, cmp->str + cmp->pos);
-                cmp->error = SyntaxError;
-                return;
-                }
-            else dot = true;
-            }
+    last->type      = PUNCTUATION;
+    last->data.id   = NULL_TERMINATOR;
+    last->length    = 0;
+    tokens->pos     = tokens->first + tokens->size - 1;
+    }
 
-        ++cmp->pos;
+static void AddToken(Compiler* cmp, int type, Data_t data, int length)
+    {
+    assert(cmp);
+
+    if (TokensPush(&cmp->tokens, type, data, cmp->base + cmp->pos, length) != Ok)
+        {
+        cmp->error = AllocationError;
         }
     }
 
-static void ReadKeyWord(Compiler* cmp, Node* node)
+// Число читается за один проход: знак, затем десятичная запись с дробной частью
+// и порядком либо 0x и шестнадцатеричная (0x1.8p3). Округление точное.
+static void ReadNumber(Compiler* cmp)
     {
     assert(cmp);
-    assert(node);
 
-    if (cmp->pos > 0 && ('0' <= cmp->str[cmp->pos - 1] && cmp->str[cmp->pos - 1] <= '9' || cmp->str[cmp->pos - 1] == '.'))
+    const char* str  = cmp->str + cmp->pos;
+    const char* last = cmp->str + cmp->size;
+    const char* pos  = str;
+
+    bool negative = false;
+    if (*pos == '-' || *pos == '+')
         {
-        printf("Syntax error in pos %d: %s\n", cmp->pos, cmp->str + cmp->pos);
-        cmp->error = SyntaxError;
-        return;
+        negative = *pos == '-';
+        ++pos;
         }
 
-    for (int i = 0; i < KEY_WORDS_COUNT; i++)
+    std::chars_format format = std::chars_format::general;
+    if (pos[0] == '0' && (pos[1] == 'x' || pos[1] == 'X'))
         {
-        if (!strncmp(cmp->str + cmp->pos, KEY_WORDS[i].name, strlen(KEY_WORDS[i].name)))
-            {
-            cmp->pos += strlen(KEY_WORDS[i].name);
-            if (IsLetter(cmp->str, cmp->pos) ||
-                '0' <= cmp->str[cmp->pos] && cmp->str[cmp->pos] <= '9')
-                {
-                cmp->pos -= strlen(KEY_WORDS[i].name);
-                continue;
-                }
-            Data_t data = {.id = KEY_WORDS[i].code};
-            ListInsert(node, KEY_WORDS[i].type, data);
-            return;
-            }
+        format = std::chars_format::hex;
+        pos += 2;
         }
 
-    int index = 0;
+    Data_t data = {.val = 0};
+    std::from_chars_result result = std::from_chars(pos, last, data.val, format);
 
-    for (; index < cmp->name_count && cmp->name_table[index].name; index++)
+    if (result.ec != std::errc() || *result.ptr == '.')
         {
-        if (!strncmp(cmp->str + cmp->pos, cmp->name_table[index].name, strlen(cmp->name_table[index].name)))
-            {
-            cmp->pos += strlen(cmp->name_table[index].name);
-            if (IsLetter(cmp->str, cmp->pos) ||
-                '0' <= cmp->str[cmp->pos] && cmp->str[cmp->pos] <= '9')
-                {
-                cmp->pos -= strlen(cmp->name_table[index].name);
-                continue;
-                }
-            Data_t data = {.id = cmp->name_table[index].index};
-            ListInsert(node, cmp->name_table[index].type, data);
-            return;
-            }
+        int length = (int) (result.ptr - str) + (*result.ptr == '.');
+        printf("Syntax error in pos %ld: wrong number %.*s\n", cmp->base + cmp->pos, length, str);
+        cmp->error = SyntaxError;
+        return;
         }
 
-    NewKeyWord(cmp, node, index);
+    if (negative) data.val = -data.val;
+
+    int length = (int) (result.ptr - str);
+    AddToken(cmp, VALUE, data, length);
+    cmp->pos += length;
     }
 
-static void NewKeyWord(Compiler* cmp, Node* node, int index)
+static void ReadKeyWord(Compiler* cmp)
     {
     assert(cmp);
-    assert(node);
 
-    if (index == cmp->name_count)
+    if (cmp->pos > 0 && (CharClassOf(&CHAR_CLASSES, cmp->str[cmp->pos - 1]) == CHAR_DIGIT || cmp->str[cmp->pos - 1] == '.'))
         {
-        Object* new_table = (Object*) realloc(cmp->name_table, cmp->name_count * REALLOC_COEFFICENT * sizeof(Object));
-        if (new_table == nullptr)
-            {
-            printf("Error: cannot allocate memory for name_table\n");
-            cmp->error = AllocationError;
-            return;
-            }
-        cmp->name_table = new_table;
+        printf("Syntax error in pos %ld: %s\n", cmp->base + cmp->pos, cmp->str + cmp->pos);
+        cmp->error = SyntaxError;
+        return;
         }
 
-    int word_length = 0;
+    int length  = 0;
+    int keyword = FindKeyWord(cmp, true, &length);
+    if (keyword != TRIE_NO_WORD)
+        {
+        Data_t data = {.id = KEY_WORDS[keyword].code};
+        AddToken(cmp, KEY_WORDS[keyword].type, data, length);
+        cmp->pos += length;
+        return;
+        }
+
+    int word_length   = 0;
     int letter_length = 0;
 
     while (true)
         {
+        word_length = ScanAsciiWord(cmp->str, cmp->pos + word_length, cmp->size) - cmp->pos;
+
         if (letter_length = IsLetter(cmp->str, cmp->pos + word_length)) word_length += letter_length;
-        else if ('0' <= cmp->str[cmp->pos + word_length] && cmp->str[cmp->pos + word_length] <= '9') word_length += 1;
         else break;
         }
 
-    char* name = (char*) calloc(word_length + 1, sizeof(char));
-    if (name == nullptr)
+    const Token* last = cmp->tokens.array + cmp->tokens.size - 1;
+
+    bool define = last->type == OPERATION &&
+                 (last->data.id == OP_DEFINE_VARIABLE ||
+                  last->data.id == OP_DEFINE_ARRAY    ||
+                  last->data.id == OP_DEFINE_FUNCTION);
+
+    int id = define ? NameTableFindLocal(&cmp->names, cmp->str + cmp->pos, word_length)
+                    : NameTableFind     (&cmp->names, cmp->str + cmp->pos, word_length);
+    if (id != NO_NAME)
         {
-        printf("Error: cannot allocate memory for parametr\n");
-        cmp->error = AllocationError;
+        Data_t data = {.id = cmp->names.names[id].index};
+        AddToken(cmp, cmp->names.names[id].type, data, word_length);
+        cmp->pos += word_length;
         return;
         }
-    strncpy(name, cmp->str + cmp->pos, word_length);
-    name[word_length] = '\0';
 
-    cmp->name_table[index].name = name;
-    if (cmp->str[cmp->pos + word_length] == '(')
+    NewKeyWord(cmp, last, word_length);
+    }
+
+static void NewKeyWord(Compiler* cmp, const Token* last, int length)
+    {
+    assert(cmp);
+    assert(last);
+
+    const char* name  = cmp->str + cmp->pos;
+    int         type  = VARIABLE;
+    int         index = 0;
+
+    if (cmp->str[cmp->pos + length] == '(')
         {
-        if (node->type == OPERATION && node->data.id == OP_DEFINE_FUNCTION)
+        if (last->type == OPERATION && last->data.id == OP_DEFINE_FUNCTION)
             {
-            cmp->name_table[index].index = cmp->func_count++;
-            cmp->name_table[index].type  = FUNCTION;
+            index = cmp->func_count++;
+            type  = FUNCTION;
             }
         else
             {
-            printf("Syntax error: function %s not defined\n", name);
+            printf("Syntax error: function %.*s not defined\n", length, name);
             cmp->error = SyntaxError;
             return;
             }
         }
-    else if (cmp->str[cmp->pos + word_length] == '[')
+    else if (cmp->str[cmp->pos + length] == '[')
         {
-        if (node->type == OPERATION && node->data.id == OP_DEFINE_ARRAY)
+        if (last->type == OPERATION && last->data.id == OP_DEFINE_ARRAY)
             {
-            cmp->name_table[index].index = cmp->arr_count++;
-            cmp->name_table[index].type = ARRAY;
+            index = cmp->arr_count++;
+            type  = ARRAY;
             }
         else
             {
-            printf("Syntax error: array %s not defined\n", name);
+            printf("Syntax error: array %.*s not defined\n", length, name);
             cmp->error = SyntaxError;
             return;
             }
         }
     else
         {
-        if (node->type == OPERATION && node->data.id == OP_DEFINE_VARIABLE)
+        if (last->type == OPERATION && last->data.id == OP_DEFINE_VARIABLE)
             {
-            cmp->name_table[index].index = cmp->var_count++;
-            cmp->name_table[index].type = VARIABLE;
+            index = cmp->var_count++;
+            type  = VARIABLE;
             }
         else
             {
-            printf("Syntax error: variable %s not defined\n", name);
+            printf("Syntax error: variable %.*s not defined\n", length, name);
             cmp->error = SyntaxError;
             return;
             }
         }
 
-    Data_t data = {.id = cmp->name_table[index].index};
-    ListInsert(node, cmp->name_table[index].type, data);
+    if (NameTableInsert(&cmp->names, name, length, type, index) == NO_NAME)
+        {
+        cmp->error = AllocationError;
+        return;
+        }
 
-    cmp->pos += word_length;
+    // Параметры и тело функции живут в своей области видимости,
+    // она закрывается скобкой, возвращающей глубину к текущей.
+    if (type == FUNCTION && NameTablePushScope(&cmp->names, cmp->brace_depth) != Ok)
+        {
+        cmp->error = AllocationError;
+        return;
+        }
+
+    Data_t data = {.id = index};
+    AddToken(cmp, type, data, length);
+
+    cmp->pos += length;
     }
 
-static void ReadOperation(Compiler* cmp, Node* node)
+static void UpdateScope(Compiler* cmp, int punctuation)
     {
     assert(cmp);
-    assert(node);
 
-    for (int i = 0; i < KEY_WORDS_COUNT; i++)
+    if (punctuation == OPEN_BRACE)
         {
-        if (!strncmp(cmp->str + cmp->pos, KEY_WORDS[i].name, strlen(KEY_WORDS[i].name)))
-            {
-            cmp->pos += strlen(KEY_WORDS[i].name);
-            Data_t data = {.id = KEY_WORDS[i].code};
-            ListInsert(node, KEY_WORDS[i].type, data);
-            return;
-            }
+        cmp->brace_depth++;
+        }
+    else if (punctuation == CLOSE_BRACE)
+        {
+        cmp->brace_depth--;
+        if (cmp->brace_depth == NameTableScopeDepth(&cmp->names)) NameTablePopScope(&cmp->names);
+        }
+    }
+
+static void ReadOperation(Compiler* cmp)
+    {
+    assert(cmp);
+
+    int length  = 0;
+    int keyword = FindKeyWord(cmp, false, &length);
+    if (keyword != TRIE_NO_WORD)
+        {
+        Data_t data = {.id = KEY_WORDS[keyword].code};
+        AddToken(cmp, KEY_WORDS[keyword].type, data, length);
+        cmp->pos += length;
+        if (KEY_WORDS[keyword].type == PUNCTUATION) UpdateScope(cmp, KEY_WORDS[keyword].code);
+        return;
         }
 
     //printf("Syntax error in pos %d: %s\n", cmp->pos, cmp->str + cmp->pos);
-    printf("Syntax error in pos %d %d\n", cmp->pos, cmp->size);
+    printf("Syntax error in pos %ld\n", cmp->base + cmp->pos);
     cmp->error = SyntaxError;
     return;
     }
 
-static const int ENG_LETTER_SIZE  = 1;
-static const int BASH_LETTER_SIZE = 2;
-static const int BASHKIR_LETTERS_COUNT = 84;
-static const char * const BASHKIR_LETTERS[BASHKIR_LETTERS_COUNT] = {    "А", "а", "Б", "б", "В", "в", "Г", "г", "Ғ", "ғ",
-                                                                        "Д", "д", "Ҙ", "ҙ", "Е", "е", "Ё", "ё", "Ж", "ж",
-                                                                        "З", "з", "И", "и", "Й", "й", "К", "к", "Ҡ", "ҡ",
-                                                                        "Л", "л", "М", "м", "Н", "н", "Ң", "ң", "О", "о",
-                                                                        "Ө", "ө", "П", "п", "Р", "р", "С", "с", "Ҫ", "ҫ",
-                                                                        "Т", "т", "У", "у", "Ү", "ү", "Ф", "ф", "Х", "х",
-                                                                        "Һ", "һ", "Ц", "ц", "Ч", "ч", "Ш", "ш", "Щ", "щ",
-                                                                        "Ъ", "ъ", "Ы", "ы", "Ь", "ь", "Э", "э", "Ә", "ә",
-                                                                        "Ю", "ю", "Я", "Я"};
-
-
-static int IsLetter(char* str, int pos)
+// Самое длинное ключевое слово, начинающееся с cmp->pos. Для слов (whole_word)
+// совпадение засчитывается, только если за ним не продолжается имя.
+static int FindKeyWord(Compiler* cmp, bool whole_word, int* length)
     {
-    assert(str);
+    assert(cmp);
+    assert(length);
 
-    if ('A' <= str[pos] && str[pos] <= 'Z') return ENG_LETTER_SIZE;
-    if ('a' <= str[pos] && str[pos] <= 'z') return ENG_LETTER_SIZE;
-    if (str[pos] == '_' || str[pos] == '$') return ENG_LETTER_SIZE;
+    int keyword = TRIE_NO_WORD;
+    int node    = TRIE_ROOT;
 
-    for (int i = 0; i < BASHKIR_LETTERS_COUNT; i++)
+    for (int pos = cmp->pos; pos < cmp->size; pos++)
         {
-        if (!strncmp(str + pos, BASHKIR_LETTERS[i], BASH_LETTER_SIZE))
+        node = TrieNext(&KEY_WORDS_TRIE, node, cmp->str[pos]);
+        if (node == TRIE_NO_NODE) break;
+
+        int word = KEY_WORDS_TRIE.nodes[node].word;
+        if (word != TRIE_NO_WORD && !(whole_word && IsWordContinue(cmp, pos + 1)))
             {
-            return BASH_LETTER_SIZE;
+            keyword = word;
+            *length = pos + 1 - cmp->pos;
             }
         }
 
-    return 0;
+    return keyword;
     }
 
-static int IsNumber(char* str, int pos)
+static int IsLetter(const char* str, int pos)
     {
     assert(str);
 
-    return '0' <= str[pos] && str[pos] <= '9' ||
+    return CharLetterLength(&CHAR_CLASSES, str + pos);
+    }
+
+static int IsNumber(const char* str, int pos)
+    {
+    assert(str);
+
+    return CharClassOf(&CHAR_CLASSES, str[pos]) == CHAR_DIGIT ||
             (str[pos] == '-' || str[pos] == '+')
-            && '0' <= str[pos + 1] && str[pos + 1] <= '9';
+            && CharClassOf(&CHAR_CLASSES, str[pos + 1]) == CHAR_DIGIT;
+    }
+
+static bool IsWordContinue(Compiler* cmp, int pos)
+    {
+    assert(cmp);
+
+    if (pos >= cmp->size) return false;
+
+    return IsLetter(cmp->str, pos) || CharClassOf(&CHAR_CLASSES, cmp->str[pos]) == CHAR_DIGIT;
     }
 
 Error_t GetGrammar(Compiler* cmp)
     {
     assert(cmp);
 
-    if (cmp->tokens.head->type == PUNCTUATION && cmp->tokens.head->data.id == PROGRAM_START)
+    if (TOKEN.type == PUNCTUATION && TOKEN.data.id == PROGRAM_START)
         {
-        cmp->tokens.head = cmp->tokens.head->right;
-        if (GetOperation(&cmp->tree.root, &cmp->tokens) == Ok)
+        SKIP_TOKEN();
+        if (GetOperation(&cmp->tree.root, cmp) == Ok)
             {
-            if (cmp->tokens.head->type == PUNCTUATION && cmp->tokens.head->data.id == NULL_TERMINATOR)
+            if (TOKEN.type == PUNCTUATION && TOKEN.data.id == NULL_TERMINATOR)
                 {
                 return Ok;
                 }
@@ -489,106 +807,105 @@ Error_t GetGrammar(Compiler* cmp)
     return SyntaxError;
     }
 
-Error_t GetOperation(Node** node, List* tokens)
+// Команды одного блока разбираются в цикле: каждая следующая подвешивается
+// справа к узлу ';' предыдущей, рекурсия остаётся только для вложенных блоков.
+Error_t GetOperation(Node** node, Compiler* cmp)
     {
     assert(node);
-    assert(tokens);
-
-    if  (tokens->head->type == PUNCTUATION &&
-        (tokens->head->data.id == NULL_TERMINATOR || tokens->head->data.id == CLOSE_BRACE))
-        {
-        return Ok;
-        }
+    assert(cmp);
 
-    Error_t response = Ok;
-    if (tokens->head->type == OPERATION && tokens->head->data.id == OP_IF)
-        {
-        response = GetIf(node, tokens);
-        }
-    else if (tokens->head->type == OPERATION && tokens->head->data.id == OP_WHILE)
-        {
-        response = GetWhile(node, tokens);
-        }
-    else if (tokens->head->type == PUNCTUATION && tokens->head->data.id == OPEN_BRACE)
-        {
-        response = GetBody(node, tokens);
-        }
-    else if (tokens->head->type == OPERATION && tokens->head->data.id == OP_DEFINE_VARIABLE)
-        {
-        response = GetDefineVariable(node, tokens);
-        }
-    else if (tokens->head->type == OPERATION && tokens->head->data.id == OP_DEFINE_ARRAY)
-        {
-        response = GetDefineArray(node, tokens);
-        }
-    else if (tokens->head->type == OPERATION && tokens->head->data.id == OP_DEFINE_FUNCTION)
+    while (!(TOKEN.type == PUNCTUATION &&
+            (TOKEN.data.id == NULL_TERMINATOR || TOKEN.data.id == CLOSE_BRACE)))
         {
-        response = GetDefineFunction(node, tokens);
-        }
-    else if (tokens->head->type == OPERATION      &&
-            (tokens->head->data.id == OP_BREAK    ||
-             tokens->head->data.id == OP_CONTINUE ||
-             tokens->head->data.id == OP_RETURN))
-        {
-        response = NewNode(node, OPERATION, tokens->head->data);
-        tokens->head = tokens->head->right;
-        if (response == Ok && tokens->head->data.id != OP_NEXT_COMMAND)
+        Error_t response = Ok;
+        if (TOKEN.type == OPERATION && TOKEN.data.id == OP_IF)
             {
-            response = GetExpression2(&(*node)->right, tokens);
+            response = GetIf(node, cmp);
             }
-        }
-    else
-        {
-        response = GetAssigment(node, tokens);
-        if (response == NotAssigment)
+        else if (TOKEN.type == OPERATION && TOKEN.data.id == OP_WHILE)
             {
-            response = GetExpression2(node, tokens);
+            response = GetWhile(node, cmp);
+            }
+        else if (TOKEN.type == PUNCTUATION && TOKEN.data.id == OPEN_BRACE)
+            {
+            response = GetBody(node, cmp);
+            }
+        else if (TOKEN.type == OPERATION && TOKEN.data.id == OP_DEFINE_VARIABLE)
+            {
+            response = GetDefineVariable(node, cmp);
+            }
+        else if (TOKEN.type == OPERATION && TOKEN.data.id == OP_DEFINE_ARRAY)
+            {
+            response = GetDefineArray(node, cmp);
+            }
+        else if (TOKEN.type == OPERATION && TOKEN.data.id == OP_DEFINE_FUNCTION)
+            {
+            response = GetDefineFunction(node, cmp);
+            }
+        else if (TOKEN.type == OPERATION      &&
+                (TOKEN.data.id == OP_BREAK    ||
+                 TOKEN.data.id == OP_CONTINUE ||
+                 TOKEN.data.id == OP_RETURN))
+            {
+            response = NewNode(node, OPERATION, TOKEN.data, &cmp->tree.arena);
+            SKIP_TOKEN();
+            if (response == Ok && !(TOKEN.type == OPERATION && TOKEN.data.id == OP_NEXT_COMMAND))
+                {
+                response = GetExpression(&(*node)->right, cmp, LEVEL_LOGIC);
+                }
+            }
+        else
+            {
+            response = GetAssigment(node, cmp);
+            if (response == NotAssigment)
+                {
+                response = GetExpression(node, cmp, LEVEL_LOGIC);
+                }
             }
-        }
 
-    if (response != Ok) return SyntaxError;
+        if (response != Ok) return SyntaxError;
+
+        if (!(TOKEN.type == OPERATION && TOKEN.data.id == OP_NEXT_COMMAND))
+            {
+            printf("Operation error (Missed ';')\n");
+            return SyntaxError;
+            }
 
-    if (tokens->head->type == OPERATION && tokens->head->data.id == OP_NEXT_COMMAND)
-        {
         Node* operation = *node;
         *node = nullptr;
-        if (NewNode(node, OPERATION, tokens->head->data) == Ok)
-            {
-            (*node)->left = operation;
+        if (NewNode(node, OPERATION, TOKEN.data, &cmp->tree.arena) != Ok) return SyntaxError;
+        (*node)->left = operation;
 
-            tokens->head = tokens->head->right;
-            return GetOperation(&(*node)->right, tokens);
-            }
-        return SyntaxError;
+        SKIP_TOKEN();
+        node = &(*node)->right;
         }
 
-    printf("Operation error (Missed ';')\n");
-    return SyntaxError;
+    return Ok;
     }
 
-Error_t GetDefineVariable(Node** node, List* tokens)
+Error_t GetDefineVariable(Node** node, Compiler* cmp)
     {
     assert(node);
-    assert(tokens);
+    assert(cmp);
 
-    if (tokens->head->type == OPERATION && tokens->head->data.id == OP_DEFINE_VARIABLE)
+    if (TOKEN.type == OPERATION && TOKEN.data.id == OP_DEFINE_VARIABLE)
         {
-        if (NewNode(node, OPERATION, tokens->head->data) == Ok)
+        if (NewNode(node, OPERATION, TOKEN.data, &cmp->tree.arena) == Ok)
             {
-            tokens->head = tokens->head->right;
-            if (tokens->head->type == VARIABLE)
+            SKIP_TOKEN();
+            if (TOKEN.type == VARIABLE)
                 {
-                if (GetVariable(&(*node)->left, tokens) == Ok)
+                if (GetVariable(&(*node)->left, cmp) == Ok)
                     {
-                    if (tokens->head->type == OPERATION && tokens->head->data.id == OP_ASSIGMENT)
+                    if (TOKEN.type == OPERATION && TOKEN.data.id == OP_ASSIGMENT)
                         {
-                        tokens->head = tokens->head->right;
-                        return GetExpression2(&(*node)->right, tokens);
+                        SKIP_TOKEN();
+                        return GetExpression(&(*node)->right, cmp, LEVEL_LOGIC);
                         }
                     else
                         {
                         Data_t zero = {.val = 0};
-                        return NewNode(&(*node)->right, VALUE, zero);
+                        return NewNode(&(*node)->right, VALUE, zero, &cmp->tree.arena);
                         }
                     }
                 }
@@ -599,33 +916,33 @@ Error_t GetDefineVariable(Node** node, List* tokens)
     return SyntaxError;
     }
 
-Error_t GetDefineArray(Node** node, List* tokens)
+Error_t GetDefineArray(Node** node, Compiler* cmp)
     {
     assert(node);
-    assert(tokens);
+    assert(cmp);
 
-    if (tokens->head->type == OPERATION && tokens->head->data.id == OP_DEFINE_ARRAY)
+    if (TOKEN.type == OPERATION && TOKEN.data.id == OP_DEFINE_ARRAY)
         {
-        if (NewNode(node, OPERATION, tokens->head->data) == Ok)
+        if (NewNode(node, OPERATION, TOKEN.data, &cmp->tree.arena) == Ok)
             {
-            tokens->head = tokens->head->right;
-            if (tokens->head->type == ARRAY)
+            SKIP_TOKEN();
+            if (TOKEN.type == ARRAY)
                 {
-                if (GetArray(&(*node)->left, tokens) == Ok)
+                if (GetArray(&(*node)->left, cmp) == Ok)
                     {
-                    if (tokens->head->type == OPERATION && tokens->head->data.id == OP_ASSIGMENT)
+                    if (TOKEN.type == OPERATION && TOKEN.data.id == OP_ASSIGMENT)
                         {
-                        tokens->head = tokens->head->right;
+                        SKIP_TOKEN();
 
-                        if (tokens->head->type == PUNCTUATION && tokens->head->data.id == OPEN_SQUARE)
+                        if (TOKEN.type == PUNCTUATION && TOKEN.data.id == OPEN_SQUARE)
                             {
-                            tokens->head = tokens->head->right;
+                            SKIP_TOKEN();
 
-                            if (GetParametr(&(*node)->right, tokens) == Ok)
+                            if (GetParametr(&(*node)->right, cmp) == Ok)
                                 {
-                                if (tokens->head->type == PUNCTUATION && tokens->head->data.id == CLOSE_SQUARE)
+                                if (TOKEN.type == PUNCTUATION && TOKEN.data.id == CLOSE_SQUARE)
                                     {
-                                    tokens->head = tokens->head->right;
+                                    SKIP_TOKEN();
                                     return Ok;
                                     }
                                 }
@@ -635,8 +952,8 @@ Error_t GetDefineArray(Node** node, List* tokens)
                         {
                         Data_t next = {.id = OP_NEXT_PARAMETR};
                         Data_t zero = {.val = 0};
-                        if (NewNode(&(*node)->right, OPERATION, next) == Ok &&
-                            NewNode(&(*node)->right->left, VALUE, zero) == Ok)
+                        if (NewNode(&(*node)->right, OPERATION, next, &cmp->tree.arena) == Ok &&
+                            NewNode(&(*node)->right->left, VALUE, zero, &cmp->tree.arena) == Ok)
                             {
                             return Ok;
                             }
@@ -650,37 +967,37 @@ Error_t GetDefineArray(Node** node, List* tokens)
     return SyntaxError;
     }
 
-Error_t GetDefineFunction(Node** node, List* tokens)
+Error_t GetDefineFunction(Node** node, Compiler* cmp)
     {
     assert(node);
-    assert(tokens);
+    assert(cmp);
 
-    if (tokens->head->type == OPERATION && tokens->head->data.id == OP_DEFINE_FUNCTION)
+    if (TOKEN.type == OPERATION && TOKEN.data.id == OP_DEFINE_FUNCTION)
         {
-        if (NewNode(node, OPERATION, tokens->head->data) == Ok)
+        if (NewNode(node, OPERATION, TOKEN.data, &cmp->tree.arena) == Ok)
             {
-            tokens->head = tokens->head->right;
-            if (tokens->head->type == FUNCTION)
+            SKIP_TOKEN();
+            if (TOKEN.type == FUNCTION)
                 {
-                if (NewNode(&(*node)->left, FUNCTION, tokens->head->data) == Ok)
+                if (NewNode(&(*node)->left, FUNCTION, TOKEN.data, &cmp->tree.arena) == Ok)
                     {
-                    tokens->head = tokens->head->right;
-                    if (tokens->head->type == PUNCTUATION && tokens->head->data.id == OPEN_BRACKET)
+                    SKIP_TOKEN();
+                    if (TOKEN.type == PUNCTUATION && TOKEN.data.id == OPEN_BRACKET)
                         {
-                        tokens->head = tokens->head->right;
+                        SKIP_TOKEN();
 
-                        if (tokens->head->type == PUNCTUATION && tokens->head->data.id == CLOSE_BRACKET)
+                        if (TOKEN.type == PUNCTUATION && TOKEN.data.id == CLOSE_BRACKET)
                             {
-                            tokens->head = tokens->head->right;
-                            return GetBody(&(*node)->right, tokens);
+                            SKIP_TOKEN();
+                            return GetBody(&(*node)->right, cmp);
                             }
 
-                        if (GetFunctionParametr(&(*node)->left->right, tokens) == Ok)
+                        if (GetFunctionParametr(&(*node)->left->right, cmp) == Ok)
                             {
-                            if (tokens->head->type == PUNCTUATION && tokens->head->data.id == CLOSE_BRACKET)
+                            if (TOKEN.type == PUNCTUATION && TOKEN.data.id == CLOSE_BRACKET)
                                 {
-                                tokens->head = tokens->head->right;
-                                return GetBody(&(*node)->right, tokens);
+                                SKIP_TOKEN();
+                                return GetBody(&(*node)->right, cmp);
                                 }
                             }
                         }
@@ -693,22 +1010,22 @@ Error_t GetDefineFunction(Node** node, List* tokens)
     return SyntaxError;
     }
 
-Error_t GetFunctionParametr(Node** node, List* tokens)
+Error_t GetFunctionParametr(Node** node, Compiler* cmp)
     {
     assert(node);
-    assert(tokens);
+    assert(cmp);
 
     Data_t parametr = {.id = OP_NEXT_PARAMETR};
-    if (NewNode(node, OPERATION, parametr) == Ok)
+    if (NewNode(node, OPERATION, parametr, &cmp->tree.arena) == Ok)
         {
         Error_t response = Ok;
-        if (tokens->head->type == OPERATION && tokens->head->data.id == OP_DEFINE_VARIABLE)
+        if (TOKEN.type == OPERATION && TOKEN.data.id == OP_DEFINE_VARIABLE)
             {
-            response = GetDefineVariable(&(*node)->left, tokens);
+            response = GetDefineVariable(&(*node)->left, cmp);
             }
-        else if (tokens->head->type == OPERATION && tokens->head->data.id == OP_DEFINE_ARRAY)
+        else if (TOKEN.type == OPERATION && TOKEN.data.id == OP_DEFINE_ARRAY)
             {
-            response = GetDefineArray(&(*node)->left, tokens);
+            response = GetDefineArray(&(*node)->left, cmp);
             }
         else
             {
@@ -718,10 +1035,10 @@ Error_t GetFunctionParametr(Node** node, List* tokens)
 
         if (response) return response;
 
-        if (tokens->head->type == OPERATION && tokens->head->data.id == OP_NEXT_PARAMETR)
+        if (TOKEN.type == OPERATION && TOKEN.data.id == OP_NEXT_PARAMETR)
             {
-            tokens->head = tokens->head->right;
-            return GetFunctionParametr(&(*node)->right, tokens);
+            SKIP_TOKEN();
+            return GetFunctionParametr(&(*node)->right, cmp);
             }
         return Ok;
         }
@@ -730,28 +1047,28 @@ Error_t GetFunctionParametr(Node** node, List* tokens)
     return SyntaxError;
     }
 
-Error_t GetIf(Node** node, List* tokens)
+Error_t GetIf(Node** node, Compiler* cmp)
     {
     assert(node);
-    assert(tokens);
+    assert(cmp);
 
-    if (tokens->head->type == OPERATION && tokens->head->data.id == OP_IF)
+    if (TOKEN.type == OPERATION && TOKEN.data.id == OP_IF)
         {
-        if (NewNode(node, OPERATION, tokens->head->data) == Ok)
+        if (NewNode(node, OPERATION, TOKEN.data, &cmp->tree.arena) == Ok)
             {
-            tokens->head = tokens->head->right;
-            if (GetExpression2(&(*node)->left, tokens) == Ok)
+            SKIP_TOKEN();
+            if (GetExpression(&(*node)->left, cmp, LEVEL_LOGIC) == Ok)
                 {
-                if (tokens->head->type == PUNCTUATION && tokens->head->data.id == COLON)
+                if (TOKEN.type == PUNCTUATION && TOKEN.data.id == COLON)
                     {
-                    tokens->head = tokens->head->right;
-                    if (GetBody(&(*node)->right, tokens) == Ok)
+                    SKIP_TOKEN();
+                    if (GetBody(&(*node)->right, cmp) == Ok)
                         {
-                        if (tokens->head->type == OPERATION && tokens->head->data.id == OP_ELSE)
+                        if (TOKEN.type == OPERATION && TOKEN.data.id == OP_ELSE)
                             {
                             Node* op_if = *node;
                             *node = nullptr;
-                            if (GetElse(node, tokens) == Ok)
+                            if (GetElse(node, cmp) == Ok)
                                 {
                                 (*node)->left = op_if;
                                 return Ok;
@@ -769,27 +1086,27 @@ Error_t GetIf(Node** node, List* tokens)
     return SyntaxError;
     }
 
-Error_t GetElse(Node** node, List* tokens)
+Error_t GetElse(Node** node, Compiler* cmp)
     {
     assert(node);
-    assert(tokens);
+    assert(cmp);
 
-    if (tokens->head->type == OPERATION && tokens->head->data.id == OP_ELSE)
+    if (TOKEN.type == OPERATION && TOKEN.data.id == OP_ELSE)
         {
-        if (NewNode(node, OPERATION, tokens->head->data) == Ok)
+        if (NewNode(node, OPERATION, TOKEN.data, &cmp->tree.arena) == Ok)
             {
-            tokens->head = tokens->head->right;
+            SKIP_TOKEN();
 
-            if (tokens->head->type == OPERATION && tokens->head->data.id == OP_IF)
+            if (TOKEN.type == OPERATION && TOKEN.data.id == OP_IF)
                 {
-                return GetIf(&(*node)->right, tokens);
+                return GetIf(&(*node)->right, cmp);
                 }
 
-            if (tokens->head->type == PUNCTUATION && tokens->head->data.id == COLON)
+            if (TOKEN.type == PUNCTUATION && TOKEN.data.id == COLON)
                 {
-                tokens->head = tokens->head->right;
+                SKIP_TOKEN();
                 }
-            return GetBody(&(*node)->right, tokens);
+            return GetBody(&(*node)->right, cmp);
             }
         }
 
@@ -797,22 +1114,22 @@ Error_t GetElse(Node** node, List* tokens)
     return SyntaxError;
     }
 
-Error_t GetWhile(Node** node, List* tokens)
+Error_t GetWhile(Node** node, Compiler* cmp)
     {
     assert(node);
-    assert(tokens);
+    assert(cmp);
 
-    if (tokens->head->type == OPERATION && tokens->head->data.id == OP_WHILE)
+    if (TOKEN.type == OPERATION && TOKEN.data.id == OP_WHILE)
         {
-        if (NewNode(node, OPERATION, tokens->head->data) == Ok)
+        if (NewNode(node, OPERATION, TOKEN.data, &cmp->tree.arena) == Ok)
             {
-            tokens->head = tokens->head->right;
-            if (GetExpression2(&(*node)->left, tokens) == Ok)
+            SKIP_TOKEN();
+            if (GetExpression(&(*node)->left, cmp, LEVEL_LOGIC) == Ok)
                 {
-                if (tokens->head->type == PUNCTUATION && tokens->head->data.id == COLON)
+                if (TOKEN.type == PUNCTUATION && TOKEN.data.id == COLON)
                     {
-                    tokens->head = tokens->head->right;
-                    return GetBody(&(*node)->right, tokens);
+                    SKIP_TOKEN();
+                    return GetBody(&(*node)->right, cmp);
                     }
                 }
             }
@@ -822,19 +1139,27 @@ Error_t GetWhile(Node** node, List* tokens)
     return SyntaxError;
     }
 
-Error_t GetAssigment(Node** node, List* tokens)
+Error_t GetAssigment(Node** node, Compiler* cmp)
     {
     assert(node);
-    assert(tokens);
+    assert(cmp);
 
-    if (tokens->head->type == VARIABLE || tokens->head->type == ARRAY)
+    if (TOKEN.type == VARIABLE || TOKEN.type == ARRAY)
         {
-        Node* var = nullptr;
-        if (GetObject(&var, tokens) == Ok)
+        // Пока неясно, присваивание ли это, лексемы с start должны остаться в окне
+        long  start = cmp->tokens.pos;
+        long  mark  = cmp->tokens.mark;
+        Node* var   = nullptr;
+
+        cmp->tokens.mark = start;
+        Error_t state    = GetObject(&var, cmp);
+        cmp->tokens.mark = mark;
+
+        if (state == Ok)
             {
-            if (tokens->head->type == OPERATION)
+            if (TOKEN.type == OPERATION)
                 {
-                switch (tokens->head->data.id)
+                switch (TOKEN.data.id)
                     {
                     case OP_ASSIGMENT:
                     case OP_ADD_ASSIGMENT:
@@ -843,11 +1168,11 @@ Error_t GetAssigment(Node** node, List* tokens)
                     case OP_DIV_ASSIGMENT:
                     case OP_POW_ASSIGMENT:
                         {
-                        if (NewNode(node, OPERATION, tokens->head->data) == Ok)
+                        if (NewNode(node, OPERATION, TOKEN.data, &cmp->tree.arena) == Ok)
                             {
-                            tokens->head = tokens->head->right;
+                            SKIP_TOKEN();
                             (*node)->left = var;
-                            return GetExpression2(&(*node)->right, tokens);
+                            return GetExpression(&(*node)->right, cmp, LEVEL_LOGIC);
                             }
                         printf("Assigment error\n");
                         return SyntaxError;
@@ -855,28 +1180,25 @@ Error_t GetAssigment(Node** node, List* tokens)
                     }
                 }
             }
-        free(var);
-        while (tokens->head->left->data.id != OP_NEXT_COMMAND && tokens->head->left->data.id != NULL_TERMINATOR)
-            {
-            tokens->head = tokens->head->left;
-            }
+        if (var) DeleteNode(var, &cmp->tree.arena);
+        cmp->tokens.pos = start;
         }
     return NotAssigment;
     }
 
-Error_t GetBody(Node** node, List* tokens)
+Error_t GetBody(Node** node, Compiler* cmp)
     {
     assert(node);
-    assert(tokens);
+    assert(cmp);
 
-    if (tokens->head->type == PUNCTUATION && tokens->head->data.id == OPEN_BRACE)
+    if (TOKEN.type == PUNCTUATION && TOKEN.data.id == OPEN_BRACE)
         {
-        tokens->head = tokens->head->right;
-        if (GetOperation(node, tokens) == Ok)
+        SKIP_TOKEN();
+        if (GetOperation(node, cmp) == Ok)
             {
-            if (tokens->head->type == PUNCTUATION && tokens->head->data.id == CLOSE_BRACE)
+            if (TOKEN.type == PUNCTUATION && TOKEN.data.id == CLOSE_BRACE)
                 {
-                tokens->head = tokens->head->right;
+                SKIP_TOKEN();
                 return Ok;
                 }
             }
@@ -886,247 +1208,121 @@ Error_t GetBody(Node** node, List* tokens)
     return SyntaxError;
     }
 
-Error_t GetExpression2(Node** node, List* tokens)
+// Разбор бинарных операций по уровням связывания. Правый операнд разбирается
+// с уровня самой операции (правая ассоциативность) или со следующего (ASSOC_NONE),
+// после операции уровня level цикл берёт только операции слабее неё.
+Error_t GetExpression(Node** node, Compiler* cmp, const int min_level)
     {
     assert(node);
-    assert(tokens);
+    assert(cmp);
 
-    if (GetExpression1(node, tokens) == Ok)
+    if (GetOperand(node, cmp) != Ok)
         {
-        if (tokens->head->type == OPERATION)
-            {
-            switch (tokens->head->data.id)
-                {
-                case OP_AND: case OP_OR:
-                    {
-                    Node* expression = *node;
-                    *node = nullptr;
-                    if (NewNode(node, OPERATION, tokens->head->data) == Ok)
-                        {
-                        (*node)->left = expression;
-
-                        tokens->head = tokens->head->right;
-                        return GetExpression2(&(*node)->right, tokens);
-                        }
-                    return SyntaxError;
-                    }
-                }
-            }
-        return Ok;
+        printf("Expression error\n");
+        return SyntaxError;
         }
 
-    printf("Expression2 error\n");
-    return SyntaxError;
-    }
-
-Error_t GetExpression1(Node** node, List* tokens)
-    {
-    assert(node);
-    assert(tokens);
-
-    if (GetExpression0(node, tokens) == Ok)
+    int max_level = LEVEL_COUNT;
+    while (TOKEN.type == OPERATION)
         {
-        if (tokens->head->type == OPERATION)
-            {
-            switch (tokens->head->data.id)
-                {
-                case OP_EQUAL: case OP_NOT_EQUAL:
-                case OP_GREATER: case OP_LESS:
-                case OP_GREATER_EQUAL: case OP_LESS_EQUAL:
-                    {
-                    Node* expression = *node;
-                    *node = nullptr;
-                    if (NewNode(node, OPERATION, tokens->head->data) == Ok)
-                        {
-                        (*node)->left = expression;
-
-                        tokens->head = tokens->head->right;
-                        return GetExpression0(&(*node)->right, tokens);
-                        }
-                    return SyntaxError;
-                    }
-                }
-            }
-        return Ok;
-        }
+        const OperatorInfo* info = OPERATORS.info + TOKEN.data.id;
+        if (info->level == LEVEL_NONE || info->level < min_level || info->level >= max_level) break;
 
-    printf("Expression1 error\n");
-    return SyntaxError;
-    }
+        Node* left = *node;
+        *node = nullptr;
+        if (NewNode(node, OPERATION, TOKEN.data, &cmp->tree.arena) != Ok) return SyntaxError;
+        (*node)->left = left;
 
-Error_t GetExpression0(Node** node, List* tokens)
-    {
-    assert(node);
-    assert(tokens);
+        SKIP_TOKEN();
+        if (GetExpression(&(*node)->right, cmp, info->level + info->assoc) != Ok) return SyntaxError;
 
-    if (GetTerm(node, tokens) == Ok)
-        {
-        if (tokens->head->type == OPERATION)
-            {
-            switch (tokens->head->data.id)
-                {
-                case OP_ADD: case OP_SUB:
-                    {
-                    Node* term = *node;
-                    *node = nullptr;
-                    if (NewNode(node, OPERATION, tokens->head->data) == Ok)
-                        {
-                        (*node)->left = term;
-
-                        tokens->head = tokens->head->right;
-                        return GetExpression0(&(*node)->right, tokens);
-                        }
-                    return SyntaxError;
-                    }
-                }
-            }
-        return Ok;
+        max_level = info->level;
         }
 
-    printf("Expression0 error\n");
-    return SyntaxError;
+    return Ok;
     }
 
-Error_t GetTerm(Node** node, List* tokens)
+// Операнд: [префиксная операция] (выражение в скобках | объект) [не]
+Error_t GetOperand(Node** node, Compiler* cmp)
     {
     assert(node);
-    assert(tokens);
+    assert(cmp);
 
-    if (GetUnary(node, tokens) == Ok)
+    Node** primary = node;
+    if (TOKEN.type == OPERATION)
         {
-        if (tokens->head->type == OPERATION)
+        if (!OPERATORS.info[TOKEN.data.id].prefix ||
+            NewNode(node, OPERATION, TOKEN.data, &cmp->tree.arena) != Ok)
             {
-            switch (tokens->head->data.id)
-                {
-                case OP_MUL: case OP_DIV: case OP_POW:
-                    {
-                    Node* unary = *node;
-                    *node = nullptr;
-                    if (NewNode(node, OPERATION, tokens->head->data) == Ok)
-                        {
-                        (*node)->left = unary;
-
-                        tokens->head = tokens->head->right;
-                        return GetTerm(&(*node)->right, tokens);
-                        }
-                    return SyntaxError;
-                    }
-                }
+            printf("Unary error\n");
+            return SyntaxError;
             }
-        return Ok;
-        }
 
-    printf("Term error\n");
-    return SyntaxError;
-    }
-
-Error_t GetUnary(Node** node, List* tokens)
-    {
-    assert(node);
-    assert(tokens);
+        SKIP_TOKEN();
+        primary = &(*node)->right;
+        }
 
-    if (tokens->head->type == OPERATION)
+    if (TOKEN.type == PUNCTUATION && TOKEN.data.id == OPEN_BRACKET)
         {
-        switch (tokens->head->data.id)
+        SKIP_TOKEN();
+        if (GetExpression(primary, cmp, LEVEL_LOGIC) != Ok ||
+            !(TOKEN.type == PUNCTUATION && TOKEN.data.id == CLOSE_BRACKET))
             {
-            case OP_INPUT: case OP_OUTPUT:
-            case OP_SIN: case OP_COS: case OP_SQRT:
-            case OP_LOG: case OP_EXP: case OP_NOT:
-            case OP_INCREMENT: case OP_DECREMENT:
-                {
-                if (NewNode(node, OPERATION, tokens->head->data) == Ok)
-                    {
-                    tokens->head = tokens->head->right;
-                    if (GetPriority(&(*node)->right, tokens) != Ok)
-                        {
-                        printf("Unary error\n");
-                        return SyntaxError;
-                        }
-                    }
-                break;
-                }
-            default:
-                printf("Unary error\n");
-                return SyntaxError;
+            printf("Priority error\n");
+            return SyntaxError;
             }
+        SKIP_TOKEN();
         }
-    else if (GetPriority(node, tokens) != Ok)
+    else if (GetObject(primary, cmp) != Ok)
         {
         printf("Unary error\n");
         return SyntaxError;
         }
 
-    if  (tokens->head->type == OPERATION && tokens->head->data.id == OP_NOT)
+    if  (TOKEN.type == OPERATION && TOKEN.data.id == OP_NOT)
         {
-        Node* priority = *node;
+        Node* operand = *node;
         *node = nullptr;
-        if (NewNode(node, OPERATION, tokens->head->data) == Ok)
-            {
-            (*node)->right = priority;
+        if (NewNode(node, OPERATION, TOKEN.data, &cmp->tree.arena) != Ok) return SyntaxError;
+        (*node)->right = operand;
 
-            tokens->head = tokens->head->right;
-            return Ok;
-            }
-        return SyntaxError;
+        SKIP_TOKEN();
         }
 
     return Ok;
     }
 
-Error_t GetPriority(Node** node, List* tokens)
-    {
-    assert(node);
-    assert(tokens);
-
-    if (tokens->head->type == PUNCTUATION && tokens->head->data.id == OPEN_BRACKET)
-        {
-        tokens->head = tokens->head->right;
-        if (GetExpression2(node, tokens) == Ok)
-            {
-            if (tokens->head->type == PUNCTUATION && tokens->head->data.id == CLOSE_BRACKET)
-                {
-                tokens->head = tokens->head->right;
-                return Ok;
-                }
-            }
-        printf("Priority error\n");
-        return SyntaxError;
-        }
-
-    return GetObject(node, tokens);
-    }
-
-Error_t GetObject(Node** node, List* tokens)
+Error_t GetObject(Node** node, Compiler* cmp)
     {
     assert(node);
-    assert(tokens);
+    assert(cmp);
 
-    switch (tokens->head->type)
+    switch (TOKEN.type)
         {
-        case VALUE:    return GetNumber(node, tokens);
-        case VARIABLE: return GetVariable(node, tokens);
-        case FUNCTION: return GetFunction(node, tokens);
-        case ARRAY:    return GetArray(node, tokens);
+        case VALUE:    return GetNumber(node, cmp);
+        case VARIABLE: return GetVariable(node, cmp);
+        case FUNCTION: return GetFunction(node, cmp);
+        case ARRAY:    return GetArray(node, cmp);
         }
 
-    printf("Object error (get not object) get %d, %d\n", tokens->head->type, tokens->head->data.id);
+    printf("Object error (get not object) get %d, %d\n", TOKEN.type, TOKEN.data.id);
     return SyntaxError;
     }
 
-Error_t GetParametr(Node** node, List* tokens)
+Error_t GetParametr(Node** node, Compiler* cmp)
     {
     assert(node);
-    assert(tokens);
+    assert(cmp);
 
     Data_t parametr = {.id = OP_NEXT_PARAMETR};
-    if (NewNode(node, OPERATION, parametr) == Ok)
+    if (NewNode(node, OPERATION, parametr, &cmp->tree.arena) == Ok)
         {
-        if (GetExpression2(&(*node)->left, tokens) == Ok)
+        if (GetExpression(&(*node)->left, cmp, LEVEL_LOGIC) == Ok)
             {
-            if (tokens->head->type == OPERATION && tokens->head->data.id == OP_NEXT_PARAMETR)
+            if (TOKEN.type == OPERATION && TOKEN.data.id == OP_NEXT_PARAMETR)
                 {
-                tokens->head = tokens->head->right;
-                return GetParametr(&(*node)->right, tokens);
+                SKIP_TOKEN();
+                return GetParametr(&(*node)->right, cmp);
                 }
 
             return Ok;
@@ -1137,30 +1333,30 @@ Error_t GetParametr(Node** node, List* tokens)
     return SyntaxError;
     }
 
-Error_t GetFunction(Node** node, List* tokens)
+Error_t GetFunction(Node** node, Compiler* cmp)
     {
     assert(node);
-    assert(tokens);
+    assert(cmp);
 
-    if (NewNode(node, FUNCTION, tokens->head->data) == Ok)
+    if (NewNode(node, FUNCTION, TOKEN.data, &cmp->tree.arena) == Ok)
         {
-        tokens->head = tokens->head->right;
+        SKIP_TOKEN();
 
-        if (tokens->head->type == PUNCTUATION && tokens->head->data.id == OPEN_BRACKET)
+        if (TOKEN.type == PUNCTUATION && TOKEN.data.id == OPEN_BRACKET)
             {
-            tokens->head = tokens->head->right;
+            SKIP_TOKEN();
 
-            if (tokens->head->type == PUNCTUATION && tokens->head->data.id == CLOSE_BRACKET)
+            if (TOKEN.type == PUNCTUATION && TOKEN.data.id == CLOSE_BRACKET)
                 {
-                tokens->head = tokens->head->right;
+                SKIP_TOKEN();
                 return Ok;
                 }
 
-            if (GetParametr(&(*node)->right, tokens) == Ok)
+            if (GetParametr(&(*node)->right, cmp) == Ok)
                 {
-                if (tokens->head->type == PUNCTUATION && tokens->head->data.id == CLOSE_BRACKET)
+                if (TOKEN.type == PUNCTUATION && TOKEN.data.id == CLOSE_BRACKET)
                     {
-                    tokens->head = tokens->head->right;
+                    SKIP_TOKEN();
                     return Ok;
                     }
                 }
@@ -1171,24 +1367,24 @@ Error_t GetFunction(Node** node, List* tokens)
     return SyntaxError;
     }
 
-Error_t GetArray(Node** node, List* tokens)
+Error_t GetArray(Node** node, Compiler* cmp)
     {
     assert(node);
-    assert(tokens);
+    assert(cmp);
 
-    if (NewNode(node, ARRAY, tokens->head->data) == Ok)
+    if (NewNode(node, ARRAY, TOKEN.data, &cmp->tree.arena) == Ok)
         {
-        tokens->head = tokens->head->right;
+        SKIP_TOKEN();
 
-        if (tokens->head->type == PUNCTUATION && tokens->head->data.id == OPEN_SQUARE)
+        if (TOKEN.type == PUNCTUATION && TOKEN.data.id == OPEN_SQUARE)
             {
-            tokens->head = tokens->head->right;
+            SKIP_TOKEN();
 
-            if (GetExpression0(&(*node)->right, tokens) == Ok)
+            if (GetExpression(&(*node)->right, cmp, LEVEL_SUM) == Ok)
                 {
-                if (tokens->head->type == PUNCTUATION && tokens->head->data.id == CLOSE_SQUARE)
+                if (TOKEN.type == PUNCTUATION && TOKEN.data.id == CLOSE_SQUARE)
                     {
-                    tokens->head = tokens->head->right;
+                    SKIP_TOKEN();
                     return Ok;
                     }
                 }
@@ -1199,14 +1395,14 @@ Error_t GetArray(Node** node, List* tokens)
     return SyntaxError;
     }
 
-Error_t GetVariable(Node** node, List* tokens)
+Error_t GetVariable(Node** node, Compiler* cmp)
     {
     assert(node);
-    assert(tokens);
+    assert(cmp);
 
-    if (NewNode(node, VARIABLE, tokens->head->data) == Ok)
+    if (NewNode(node, VARIABLE, TOKEN.data, &cmp->tree.arena) == Ok)
         {
-        tokens->head = tokens->head->right;
+        SKIP_TOKEN();
         return Ok;
         }
 
@@ -1214,14 +1410,14 @@ Error_t GetVariable(Node** node, List* tokens)
     return SyntaxError;
     }
 
-Error_t GetNumber(Node** node, List* tokens)
+Error_t GetNumber(Node** node, Compiler* cmp)
     {
     assert(node);
-    assert(tokens);
+    assert(cmp);
 
-    if (NewNode(node, VALUE, tokens->head->data) == Ok)
+    if (NewNode(node, VALUE, TOKEN.data, &cmp->tree.arena) == Ok)
         {
-        tokens->head = tokens->head->right;
+        SKIP_TOKEN();
         return Ok;
         }
 
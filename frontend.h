@@ -1,26 +1,25 @@
 #ifndef FRONTEND_H
 #define FRONTEND_H
 
-const int DEFAULT_NAME_COUNT = 16;
-const int REALLOC_COEFFICENT = 2;
 const int KEY_WORDS_COUNT    = 52;
-
-struct Object
-    {
-    int             type;
-    char*           name;
-    int             index;
-    };
+const int BASHKIR_LETTERS_COUNT = 84;
+const int OPERATION_CODES_COUNT = 512;
 
 struct Compiler
     {
-    char*       str;
+    const char* str;
+    char*       window;
     int         size;
+    void*       map;
+    size_t      map_size;
+    FILE*       source;
+    long        base;
+    bool        eof;
     int         pos;
-    List        tokens;
+    Tokens      tokens;
     Tree        tree;
-    Object*     name_table;
-    int         name_count;
+    NameTable   names;
+    int         brace_depth;
     int         var_count;
     int         func_count;
     int         arr_count;
@@ -34,7 +33,69 @@ struct KeyWord
     const char*     name;
     };
 
-static const KeyWord KEY_WORDS[KEY_WORDS_COUNT] =
+// Уровни связывания бинарных операций, больший уровень связывает сильнее
+enum BindingLevel
+    {
+    LEVEL_NONE      = 0,
+    LEVEL_LOGIC     = 1,
+    LEVEL_COMPARE   = 2,
+    LEVEL_SUM       = 3,
+    LEVEL_PRODUCT   = 4,
+    LEVEL_COUNT     = 5,
+    };
+
+enum Associativity
+    {
+    ASSOC_RIGHT     = 0,
+    ASSOC_NONE      = 1,
+    };
+
+struct BinaryOperator
+    {
+    int             code;
+    int             level;
+    int             assoc;
+    };
+
+struct OperatorInfo
+    {
+    unsigned char   level;
+    unsigned char   assoc;
+    bool            prefix;
+    };
+
+// Свойства операций по их коду, строится из BINARY_OPERATORS и PREFIX_OPERATORS
+struct OperatorTable
+    {
+    OperatorInfo    info[OPERATION_CODES_COUNT];
+    };
+
+// Цепочки a - b - c собираются вправо, как и раньше: a - (b - c).
+// Сравнения не цепляются: после a < b следующее сравнение не разбирается.
+static constexpr BinaryOperator BINARY_OPERATORS[] =
+    {
+    {OP_AND,            LEVEL_LOGIC,    ASSOC_RIGHT},
+    {OP_OR,             LEVEL_LOGIC,    ASSOC_RIGHT},
+    {OP_EQUAL,          LEVEL_COMPARE,  ASSOC_NONE},
+    {OP_NOT_EQUAL,      LEVEL_COMPARE,  ASSOC_NONE},
+    {OP_GREATER,        LEVEL_COMPARE,  ASSOC_NONE},
+    {OP_LESS,           LEVEL_COMPARE,  ASSOC_NONE},
+    {OP_GREATER_EQUAL,  LEVEL_COMPARE,  ASSOC_NONE},
+    {OP_LESS_EQUAL,     LEVEL_COMPARE,  ASSOC_NONE},
+    {OP_ADD,            LEVEL_SUM,      ASSOC_RIGHT},
+    {OP_SUB,            LEVEL_SUM,      ASSOC_RIGHT},
+    {OP_MUL,            LEVEL_PRODUCT,  ASSOC_RIGHT},
+    {OP_DIV,            LEVEL_PRODUCT,  ASSOC_RIGHT},
+    {OP_POW,            LEVEL_PRODUCT,  ASSOC_RIGHT},
+    };
+
+static constexpr int PREFIX_OPERATORS[] =
+    {
+    OP_INPUT, OP_OUTPUT, OP_SIN, OP_COS, OP_SQRT,
+    OP_LOG, OP_EXP, OP_NOT, OP_INCREMENT, OP_DECREMENT,
+    };
+
+static constexpr KeyWord KEY_WORDS[KEY_WORDS_COUNT] =
     {
     {OPERATION, OP_NEXT_COMMAND, ";"},
     {OPERATION, OP_NEXT_COMMAND, "ине"},
@@ -90,37 +151,63 @@ static const KeyWord KEY_WORDS[KEY_WORDS_COUNT] =
     {PUNCTUATION, COLON, ":"},
     };
 
-Error_t Frontend(const char* file_from, const char* file_to);
+static constexpr const char* BASHKIR_LETTERS[BASHKIR_LETTERS_COUNT] =
+    {
+    "А", "а", "Б", "б", "В", "в", "Г", "г", "Ғ", "ғ",
+    "Д", "д", "Ҙ", "ҙ", "Е", "е", "Ё", "ё", "Ж", "ж",
+    "З", "з", "И", "и", "Й", "й", "К", "к", "Ҡ", "ҡ",
+    "Л", "л", "М", "м", "Н", "н", "Ң", "ң", "О", "о",
+    "Ө", "ө", "П", "п", "Р", "р", "С", "с", "Ҫ", "ҫ",
+    "Т", "т", "У", "у", "Ү", "ү", "Ф", "ф", "Х", "х",
+    "Һ", "һ", "Ц", "ц", "Ч", "ч", "Ш", "ш", "Щ", "щ",
+    "Ъ", "ъ", "Ы", "ы", "Ь", "ь", "Э", "э", "Ә", "ә",
+    "Ю", "ю", "Я", "я"
+    };
+
+// text - писать текстовое дерево, optimize - упрощать выражения, report - печатать сколько,
+// run - сразу исполнять дерево вместо записи в файл, lex - только прочитать лексемы и
+// напечатать скорость лексера
+struct FrontendFlags
+    {
+    bool        text;
+    bool        optimize;
+    bool        report;
+    bool        run;
+    bool        lex;
+    };
+
+Error_t Frontend(const char* file_from, const char* file_to, const FrontendFlags* flags);
+Error_t ParseProgram(Compiler* cmp);
+Error_t LexProgram(Compiler* cmp);
+Error_t OptimizeProgram(Compiler* cmp, bool report);
+Error_t RunProgram(Compiler* cmp, bool report);
 
 Error_t CompilerCtor(Compiler* cmp, const char* filename);
 Error_t CompilerDtor(Compiler* cmp);
 
 Error_t WriteTree(Compiler* cmp, const char* filename);
+Error_t WriteFlatTree(Compiler* cmp, const char* filename);
 
 Error_t TokenParsing(Compiler* cmp);
 
 Error_t GetGrammar(Compiler* cmp);
-Error_t GetOperation(Node** node, List* tokens);
-Error_t GetDefineArray(Node** node, List* tokens);
-Error_t GetDefineFunction(Node** node, List* tokens);
-Error_t GetFunctionParametr(Node** node, List* tokens);
-Error_t GetDefineVariable(Node** node, List* tokens);
-Error_t GetIf(Node** node, List* tokens);
-Error_t GetElse(Node** node, List* tokens);
-Error_t GetWhile(Node** node, List* tokens);
-Error_t GetAssigment(Node** node, List* tokens);
-Error_t GetBody(Node** node, List* tokens);
-Error_t GetExpression2(Node** node, List* tokens);
-Error_t GetExpression1(Node** node, List* tokens);
-Error_t GetExpression0(Node** node, List* tokens);
-Error_t GetTerm(Node** node, List* tokens);
-Error_t GetUnary(Node** node, List* tokens);
-Error_t GetPriority(Node** node, List* tokens);
-Error_t GetObject(Node** node, List* tokens);
-Error_t GetParametr(Node** node, List* tokens);
-Error_t GetFunction(Node** node, List* tokens);
-Error_t GetArray(Node** node, List* tokens);
-Error_t GetVariable(Node** node, List* tokens);
-Error_t GetNumber(Node** node, List* tokens);
+Error_t GetOperation(Node** node, Compiler* cmp);
+Error_t GetDefineArray(Node** node, Compiler* cmp);
+Error_t GetDefineFunction(Node** node, Compiler* cmp);
+Error_t GetFunctionParametr(Node** node, Compiler* cmp);
+Error_t GetDefineVariable(Node** node, Compiler* cmp);
+Error_t GetIf(Node** node, Compiler* cmp);
+Error_t GetElse(Node** node, Compiler* cmp);
+Error_t GetWhile(Node** node, Compiler* cmp);
+Error_t GetAssigment(Node** node, Compiler* cmp);
+Error_t GetBody(Node** node, Compiler* cmp);
+Error_t GetExpression(Node** node, Compiler* cmp, const int min_level);
+Error_t GetOperand(Node** node, Compiler* cmp);
+Error_t GetObject(Node** node, Compiler* cmp);
+Error_t GetParametr(Node** node, Compiler* cmp);
+Error_t GetFunction(Node** node, Compiler* cmp);
+Error_t GetArray(Node** node, Compiler* cmp);
+Error_t GetVariable(Node** node, Compiler* cmp);
+Error_t GetNumber(Node** node, Compiler* cmp);
 
 #endif //FRONTEND_H
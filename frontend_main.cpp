@@ -0,0 +1,44 @@
+#include <stdio.h>
+#include <string.h>
+#include "errors.h"
+#include "node.h"
+#include "tree.h"
+#include "tokens.h"
+#include "nametable.h"
+#include "frontend.h"
+
+static const char DEFAULT_TREE_FILENAME[]      = "tree.bin";
+static const char DEFAULT_TEXT_TREE_FILENAME[] = "tree.txt";
+static const char TEXT_TREE_FLAG[]             = "--text";
+static const char OPTIMIZE_FLAG[]              = "-O";
+static const char STATS_FLAG[]                 = "--stats";
+static const char RUN_FLAG[]                   = "--run";
+static const char LEX_FLAG[]                   = "--lex";
+
+int main(int argc, char *argv[])
+    {
+    const char*   file_from = nullptr;
+    const char*   file_to   = nullptr;
+    FrontendFlags flags     = {};
+
+    for (int i = 1; i < argc; i++)
+        {
+        if      (!strcmp(argv[i], TEXT_TREE_FLAG)) flags.text     = true;
+        else if (!strcmp(argv[i], OPTIMIZE_FLAG))  flags.optimize = true;
+        else if (!strcmp(argv[i], STATS_FLAG))     flags.report   = true;
+        else if (!strcmp(argv[i], RUN_FLAG))       flags.run      = true;
+        else if (!strcmp(argv[i], LEX_FLAG))       flags.lex      = true;
+        else if (!file_from)                       file_from      = argv[i];
+        else if (!file_to)                         file_to        = argv[i];
+        }
+
+    if (!file_from)
+        {
+        printf("Incorrect args number\n");
+        return FileError;
+        }
+    if (!file_to) file_to = flags.text ? DEFAULT_TEXT_TREE_FILENAME : DEFAULT_TREE_FILENAME;
+
+    Frontend(file_from, file_to, &flags);
+    return 0;
+    }
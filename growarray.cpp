@@ -0,0 +1,23 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include "errors.h"
+#include "growarray.h"
+
+void* GrowArray(void* array, int* capacity, size_t elem_size, Error_t* error)
+    {
+    assert(capacity);
+    assert(error);
+
+    int   new_capacity = *capacity ? *capacity * GROW_COEFF : GROW_DEFAULT_SIZE;
+    void* new_array    = realloc(array, (size_t) new_capacity * elem_size);
+    if (!new_array)
+        {
+        printf("Error: cannot allocate memory for code\n");
+        *error = AllocationError;
+        return nullptr;
+        }
+
+    *capacity = new_capacity;
+    return new_array;
+    }
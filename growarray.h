@@ -0,0 +1,11 @@
+#ifndef GROWARRAY_H
+#define GROWARRAY_H
+
+const int GROW_DEFAULT_SIZE = 256;
+const int GROW_COEFF        = 2;
+
+// Новый буфер вдвое больше (или GROW_DEFAULT_SIZE элементов для пустого) и новая ёмкость.
+// При нехватке памяти старый буфер остаётся, в error пишется AllocationError.
+void* GrowArray(void* array, int* capacity, size_t elem_size, Error_t* error);
+
+#endif //GROWARRAY_H
@@ -0,0 +1,827 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "errors.h"
+#include "timer.h"
+#include "node.h"
+#include "flattree.h"
+#include "treeio.h"
+#include "asmcode.h"
+#include "backend.h"
+#include "interp.h"
+
+typedef double (*RunEval)(Interp* interp, const RunNode* node);
+
+// Узел исполнения: обработчик и разобранный аргумент. Ячейка с left - элемент
+// массива с вычисляемым индексом, cell тогда указывает на начало массива.
+struct RunNode
+    {
+    RunEval             eval;
+    const RunNode*      left;
+    const RunNode*      right;
+    union
+        {
+        double              value;
+        double*             cell;
+        const RunFunction*  function;
+        const RunNode*      other;
+        };
+    };
+
+struct RunChunk
+    {
+    RunChunk*   prev;
+    int         size;
+    RunNode     nodes[INTERP_CHUNK_SIZE];
+    };
+
+struct RunFunction
+    {
+    const RunNode*  body;
+    double*         params[INTERP_MAX_PARAMETRS];
+    int             param_count;
+    bool            defined;
+    };
+
+struct RunOperation
+    {
+    int         code;
+    RunEval     eval;
+    };
+
+struct NameCounts
+    {
+    int         variables;
+    int         arrays;
+    int         functions;
+    };
+
+static void     CountNames(const Node* node, NameCounts* counts);
+static RunNode* NewRunNode(Interp* interp, RunEval eval, const RunNode* left = nullptr, const RunNode* right = nullptr);
+static RunEval  FindHandler(const RunOperation* table, size_t size, int code);
+
+static Error_t CompileBody(Interp* interp, const Node* node, const RunNode** result);
+static Error_t CompileCommand(Interp* interp, const Node* node, const RunNode** result);
+static Error_t CompileExpression(Interp* interp, const Node* node, const RunNode** result);
+static Error_t CompileOperation(Interp* interp, const Node* node, const RunNode** result);
+static Error_t CompilePlace(Interp* interp, const Node* node, const RunNode** result);
+static Error_t CompileAssigment(Interp* interp, const Node* node, const RunNode** result);
+static Error_t CompileIf(Interp* interp, const Node* node, const RunNode** result);
+static Error_t CompileCall(Interp* interp, const Node* node, const RunNode** result);
+static Error_t CompileDefineFunction(Interp* interp, const Node* node);
+static Error_t CompileDefineArray(Interp* interp, const Node* node, const RunNode** result);
+
+static double* Place(Interp* interp, const RunNode* place);
+static void    RunError(Interp* interp, const char* message, Error_t error);
+
+static inline bool IsTrue(double value)
+    {
+    return value < 0 || value > 0;
+    }
+
+// Обработчики. Операнды вычисляются слева направо, как в коде бэкенда.
+#define RUN_BINARY(name, expr)                                          \
+    static double name(Interp* interp, const RunNode* node)             \
+        {                                                               \
+        double a = node->left->eval(interp, node->left);                \
+        double b = node->right->eval(interp, node->right);              \
+        return (expr);                                                  \
+        }
+
+#define RUN_UNARY(name, expr)                                           \
+    static double name(Interp* interp, const RunNode* node)             \
+        {                                                               \
+        double a = node->right->eval(interp, node->right);              \
+        return (expr);                                                  \
+        }
+
+// Составное присваивание читает старое значение до вычисления правой части
+#define RUN_ASSIGN(name, expr)                                          \
+    static double name(Interp* interp, const RunNode* node)             \
+        {                                                               \
+        double* cell = Place(interp, node->left);                       \
+        if (!cell) return 0;                                            \
+        double a = *cell;                                               \
+        double b = node->right->eval(interp, node->right);              \
+        return *cell = (expr);                                          \
+        }
+
+RUN_BINARY(RunAdd,          a + b)
+RUN_BINARY(RunSub,          a - b)
+RUN_BINARY(RunMul,          a * b)
+RUN_BINARY(RunDiv,          a / b)
+RUN_BINARY(RunPow,          pow(a, b))
+RUN_BINARY(RunGreater,      a >  b)
+RUN_BINARY(RunLess,         a <  b)
+RUN_BINARY(RunGreaterEqual, a >= b)
+RUN_BINARY(RunLessEqual,    a <= b)
+RUN_BINARY(RunEqual,        !(a < b || a > b))
+RUN_BINARY(RunNotEqual,     a < b || a > b)
+RUN_BINARY(RunAnd,          IsTrue(a) && IsTrue(b))
+RUN_BINARY(RunOr,           IsTrue(a) || IsTrue(b))
+
+RUN_UNARY(RunNot,           !IsTrue(a))
+RUN_UNARY(RunSin,           sin(a))
+RUN_UNARY(RunCos,           cos(a))
+RUN_UNARY(RunSqrt,          sqrt(a))
+
+RUN_ASSIGN(RunAddAssign,    a + b)
+RUN_ASSIGN(RunSubAssign,    a - b)
+RUN_ASSIGN(RunMulAssign,    a * b)
+RUN_ASSIGN(RunDivAssign,    a / b)
+RUN_ASSIGN(RunPowAssign,    pow(a, b))
+
+#undef RUN_BINARY
+#undef RUN_UNARY
+#undef RUN_ASSIGN
+
+static double RunNumber(Interp*, const RunNode* node)
+    {
+    return node->value;
+    }
+
+static double RunLoad(Interp*, const RunNode* node)
+    {
+    return *node->cell;
+    }
+
+static double RunLoadElement(Interp* interp, const RunNode* node)
+    {
+    double* cell = Place(interp, node);
+    return cell ? *cell : 0;
+    }
+
+static double RunAssign(Interp* interp, const RunNode* node)
+    {
+    double value = node->right->eval(interp, node->right);
+    return *node->left->cell = value;
+    }
+
+static double RunAssignElement(Interp* interp, const RunNode* node)
+    {
+    double  value = node->right->eval(interp, node->right);
+    double* cell  = Place(interp, node->left);
+    return cell ? *cell = value : 0;
+    }
+
+static double RunIncrement(Interp* interp, const RunNode* node)
+    {
+    double* cell = Place(interp, node->right);
+    return cell ? *cell += 1 : 0;
+    }
+
+static double RunDecrement(Interp* interp, const RunNode* node)
+    {
+    double* cell = Place(interp, node->right);
+    return cell ? *cell -= 1 : 0;
+    }
+
+static double RunInput(Interp* interp, const RunNode* node)
+    {
+    double* cell = Place(interp, node->right);
+    if (!cell) return 0;
+
+    if (fscanf(interp->in, "%lf", cell) != 1)
+        {
+        RunError(interp, "cannot read a number", FileError);
+        return 0;
+        }
+
+    return *cell;
+    }
+
+// Вывод - тоже выражение, его значение остаётся
+static double RunOutput(Interp* interp, const RunNode* node)
+    {
+    double value = node->right->eval(interp, node->right);
+    if (!interp->unwinding) fprintf(interp->out, "%lg\n", value);
+
+    return value;
+    }
+
+// Возврат только поднимает флаг, его снимает вызов функции или конец программы
+static double RunReturn(Interp* interp, const RunNode* node)
+    {
+    double value = node->right ? node->right->eval(interp, node->right) : 0;
+    if (interp->unwinding) return 0;
+
+    interp->result    = value;
+    interp->unwinding = true;
+
+    return 0;
+    }
+
+// Аргументы кладутся в параметры только после вычисления всех, как через регистры
+static double RunCall(Interp* interp, const RunNode* node)
+    {
+    const RunFunction* function = node->function;
+
+    double args[INTERP_MAX_PARAMETRS] = {};
+    int    count = 0;
+    for (const RunNode* arg = node->right; arg; arg = arg->right) args[count++] = arg->left->eval(interp, arg->left);
+    if (interp->unwinding) return 0;
+
+    if (interp->depth == INTERP_CALL_DEPTH)
+        {
+        RunError(interp, "interpreter call stack overflow", CalculationError);
+        return 0;
+        }
+
+    for (int param = 0; param < function->param_count; param++) *function->params[param] = args[param];
+
+    interp->depth++;
+    function->body->eval(interp, function->body);
+    interp->depth--;
+
+    if (!interp->unwinding || interp->error != Ok) return 0;
+
+    interp->unwinding = false;
+    return interp->result;
+    }
+
+static double RunBlock(Interp* interp, const RunNode* node)
+    {
+    for (; node; node = node->right)
+        {
+        node->left->eval(interp, node->left);
+        if (interp->unwinding) break;
+        }
+
+    return 0;
+    }
+
+static double RunWhile(Interp* interp, const RunNode* node)
+    {
+    while (true)
+        {
+        double condition = node->left->eval(interp, node->left);
+        if (interp->unwinding || !IsTrue(condition)) break;
+
+        node->right->eval(interp, node->right);
+        if (interp->unwinding) break;
+        }
+
+    return 0;
+    }
+
+static double RunIf(Interp* interp, const RunNode* node)
+    {
+    const RunNode* branch = IsTrue(node->left->eval(interp, node->left)) ? node->right : node->other;
+    if (branch && !interp->unwinding) branch->eval(interp, branch);
+
+    return 0;
+    }
+
+static double RunNop(Interp*, const RunNode*)
+    {
+    return 0;
+    }
+
+static const RunOperation BINARY_HANDLERS[] =
+    {
+    {OP_ADD,            RunAdd},
+    {OP_SUB,            RunSub},
+    {OP_MUL,            RunMul},
+    {OP_DIV,            RunDiv},
+    {OP_POW,            RunPow},
+    {OP_GREATER,        RunGreater},
+    {OP_LESS,           RunLess},
+    {OP_GREATER_EQUAL,  RunGreaterEqual},
+    {OP_LESS_EQUAL,     RunLessEqual},
+    {OP_EQUAL,          RunEqual},
+    {OP_NOT_EQUAL,      RunNotEqual},
+    {OP_AND,            RunAnd},
+    {OP_OR,             RunOr},
+    };
+
+static const RunOperation UNARY_HANDLERS[] =
+    {
+    {OP_NOT,            RunNot},
+    {OP_SIN,            RunSin},
+    {OP_COS,            RunCos},
+    {OP_SQRT,           RunSqrt},
+    {OP_OUTPUT,         RunOutput},
+    };
+
+static const RunOperation PLACE_HANDLERS[] =
+    {
+    {OP_INPUT,          RunInput},
+    {OP_INCREMENT,      RunIncrement},
+    {OP_DECREMENT,      RunDecrement},
+    };
+
+static const RunOperation ASSIGMENT_HANDLERS[] =
+    {
+    {OP_ADD_ASSIGMENT,  RunAddAssign},
+    {OP_SUB_ASSIGMENT,  RunSubAssign},
+    {OP_MUL_ASSIGMENT,  RunMulAssign},
+    {OP_DIV_ASSIGMENT,  RunDivAssign},
+    {OP_POW_ASSIGMENT,  RunPowAssign},
+    };
+
+Error_t InterpCtor(Interp* interp, const Node* root, FILE* in, FILE* out)
+    {
+    assert(interp);
+    assert(in);
+    assert(out);
+
+    *interp = {};
+    interp->in  = in;
+    interp->out = out;
+
+    NameCounts counts = {};
+    CountNames(root, &counts);
+
+    interp->memory_size = counts.variables;
+    if (counts.arrays && counts.arrays * ARRAY_MAX_SIZE + ARRAY_SEGMENT > interp->memory_size)
+        interp->memory_size = counts.arrays * ARRAY_MAX_SIZE + ARRAY_SEGMENT;
+
+    interp->function_count = counts.functions;
+    interp->memory         = (double*)      calloc((size_t) interp->memory_size + 1, sizeof(double));
+    interp->functions      = (RunFunction*) calloc((size_t) interp->function_count + 1, sizeof(RunFunction));
+    if (!interp->memory || !interp->functions)
+        {
+        printf("Error: cannot allocate memory for interpreter\n");
+        InterpDtor(interp);
+        return AllocationError;
+        }
+
+    Error_t state = CompileBody(interp, root, &interp->program);
+    if (state == Ok) state = interp->error;
+    if (state != Ok) InterpDtor(interp);
+
+    return state;
+    }
+
+Error_t InterpDtor(Interp* interp)
+    {
+    assert(interp);
+
+    while (interp->chunks)
+        {
+        RunChunk* prev = interp->chunks->prev;
+        free(interp->chunks);
+        interp->chunks = prev;
+        }
+
+    free(interp->memory);
+    free(interp->functions);
+
+    interp->program        = nullptr;
+    interp->memory         = nullptr;
+    interp->functions      = nullptr;
+    interp->memory_size    = 0;
+    interp->function_count = 0;
+
+    return Ok;
+    }
+
+// ҡайтар в самой программе останавливает её, как ret на пустом стеке вызовов
+Error_t InterpRun(Interp* interp)
+    {
+    assert(interp);
+    assert(interp->program);
+
+    interp->depth     = 0;
+    interp->unwinding = false;
+    interp->error     = Ok;
+
+    double start = Now();
+    interp->program->eval(interp, interp->program);
+    interp->seconds = Now() - start;
+
+    interp->unwinding = false;
+
+    return interp->error;
+    }
+
+void InterpReport(const Interp* interp, FILE* fp)
+    {
+    assert(interp);
+    assert(fp);
+
+    fprintf(fp, "Interpreter: %ld nodes, %d memory cells, run in %.3f s\n", interp->nodes, interp->memory_size, interp->seconds);
+    }
+
+// Рекурсия только по левым детям: цепочки команд и параметров идут вправо
+static void CountNames(const Node* node, NameCounts* counts)
+    {
+    for (; node; node = node->right)
+        {
+        int* count = nullptr;
+        switch (node->type)
+            {
+            case VARIABLE: count = &counts->variables; break;
+            case ARRAY:    count = &counts->arrays;    break;
+            case FUNCTION: count = &counts->functions; break;
+            default:       break;
+            }
+        if (count && node->data.id >= *count) *count = node->data.id + 1;
+
+        CountNames(node->left, counts);
+        }
+    }
+
+static RunNode* NewRunNode(Interp* interp, RunEval eval, const RunNode* left, const RunNode* right)
+    {
+    if (!interp->chunks || interp->chunks->size == INTERP_CHUNK_SIZE)
+        {
+        RunChunk* chunk = (RunChunk*) calloc(1, sizeof(RunChunk));
+        if (!chunk)
+            {
+            printf("Error: cannot allocate memory for interpreter\n");
+            interp->error = AllocationError;
+            return nullptr;
+            }
+        chunk->prev    = interp->chunks;
+        interp->chunks = chunk;
+        }
+
+    RunNode* node = interp->chunks->nodes + interp->chunks->size++;
+    node->eval  = eval;
+    node->left  = left;
+    node->right = right;
+    interp->nodes++;
+
+    return node;
+    }
+
+static RunEval FindHandler(const RunOperation* table, size_t size, int code)
+    {
+    for (size_t i = 0; i < size; i++)
+        {
+        if (table[i].code == code) return table[i].eval;
+        }
+
+    return nullptr;
+    }
+
+// Цепочка ';' превращается в цепочку блока, определения функций из неё выпадают
+static Error_t CompileBody(Interp* interp, const Node* node, const RunNode** result)
+    {
+    RunNode* first = nullptr;
+    RunNode* last  = nullptr;
+
+    for (; node; node = node->right)
+        {
+        const RunNode* command = nullptr;
+        if (CompileCommand(interp, node->left, &command) != Ok) return SyntaxError;
+        if (!command) continue;
+
+        RunNode* block = NewRunNode(interp, RunBlock, command);
+        if (!block) return AllocationError;
+
+        if (last) last->right = block;
+        else      first       = block;
+        last = block;
+        }
+
+    *result = first ? first : NewRunNode(interp, RunNop);
+
+    return *result ? Ok : AllocationError;
+    }
+
+static Error_t CompileCommand(Interp* interp, const Node* node, const RunNode** result)
+    {
+    assert(node);
+
+    *result = nullptr;
+    if (node->type != OPERATION) return CompileExpression(interp, node, result);
+
+    switch (node->data.id)
+        {
+        case OP_ASSIGMENT:
+        case OP_ADD_ASSIGMENT:
+        case OP_SUB_ASSIGMENT:
+        case OP_MUL_ASSIGMENT:
+        case OP_DIV_ASSIGMENT:
+        case OP_POW_ASSIGMENT:
+            {
+            return CompileAssigment(interp, node, result);
+            }
+        case OP_WHILE:
+            {
+            const RunNode* condition = nullptr;
+            const RunNode* body      = nullptr;
+            if (CompileExpression(interp, node->left, &condition) != Ok ||
+                CompileBody(interp, node->right, &body) != Ok) return SyntaxError;
+
+            *result = NewRunNode(interp, RunWhile, condition, body);
+            return *result ? Ok : AllocationError;
+            }
+        case OP_IF: case OP_ELSE:
+            {
+            return CompileIf(interp, node, result);
+            }
+        case OP_NEXT_COMMAND:
+            {
+            return CompileBody(interp, node, result);
+            }
+        case OP_DEFINE_VARIABLE:
+            {
+            return CompileAssigment(interp, node, result);
+            }
+        case OP_DEFINE_FUNCTION:
+            {
+            return CompileDefineFunction(interp, node);
+            }
+        case OP_DEFINE_ARRAY:
+            {
+            return CompileDefineArray(interp, node, result);
+            }
+        default:
+            {
+            return CompileExpression(interp, node, result);
+            }
+        }
+    }
+
+static Error_t CompileExpression(Interp* interp, const Node* node, const RunNode** result)
+    {
+    if (!node)
+        {
+        printf("Syntax error: missing expression\n");
+        return SyntaxError;
+        }
+
+    switch (node->type)
+        {
+        case VALUE:
+            {
+            RunNode* number = NewRunNode(interp, RunNumber);
+            if (number) number->value = node->data.val;
+            *result = number;
+            return number ? Ok : AllocationError;
+            }
+        case VARIABLE:
+        case ARRAY:
+            {
+            return CompilePlace(interp, node, result);
+            }
+        case FUNCTION:
+            {
+            return CompileCall(interp, node, result);
+            }
+        case OPERATION:
+            {
+            return CompileOperation(interp, node, result);
+            }
+        default:
+            {
+            printf("Syntax error: wrong argument type\n");
+            return SyntaxError;
+            }
+        }
+    }
+
+static Error_t CompileOperation(Interp* interp, const Node* node, const RunNode** result)
+    {
+    const RunNode* left  = nullptr;
+    const RunNode* right = nullptr;
+    RunEval        eval  = nullptr;
+
+    if ((eval = FindHandler(BINARY_HANDLERS, sizeof(BINARY_HANDLERS) / sizeof(RunOperation), node->data.id)))
+        {
+        if (CompileExpression(interp, node->left,  &left)  != Ok ||
+            CompileExpression(interp, node->right, &right) != Ok) return SyntaxError;
+        }
+    else if ((eval = FindHandler(UNARY_HANDLERS, sizeof(UNARY_HANDLERS) / sizeof(RunOperation), node->data.id)))
+        {
+        if (CompileExpression(interp, node->right, &right) != Ok) return SyntaxError;
+        }
+    else if ((eval = FindHandler(PLACE_HANDLERS, sizeof(PLACE_HANDLERS) / sizeof(RunOperation), node->data.id)))
+        {
+        if (!node->right || (node->right->type != VARIABLE && node->right->type != ARRAY))
+            {
+            printf("Syntax error: operand of operation %d is not variable\n", node->data.id);
+            return SyntaxError;
+            }
+        if (CompilePlace(interp, node->right, &right) != Ok) return SyntaxError;
+        }
+    else if (node->data.id == OP_RETURN)
+        {
+        eval = RunReturn;
+        if (node->right && CompileExpression(interp, node->right, &right) != Ok) return SyntaxError;
+        }
+    else
+        {
+        printf("Syntax error: wrong operation %d %d\n", node->type, node->data.id);
+        return SyntaxError;
+        }
+
+    *result = NewRunNode(interp, eval, left, right);
+    return *result ? Ok : AllocationError;
+    }
+
+// Переменная и элемент массива с числовым индексом - готовая ячейка,
+// остальные индексы вычисляются при исполнении
+static Error_t CompilePlace(Interp* interp, const Node* node, const RunNode** result)
+    {
+    assert(node);
+
+    if (node->type == VARIABLE)
+        {
+        RunNode* place = NewRunNode(interp, RunLoad);
+        if (place) place->cell = interp->memory + node->data.id;
+        *result = place;
+        return place ? Ok : AllocationError;
+        }
+    if (node->type != ARRAY)
+        {
+        printf("Syntax error: assigment to not variable\n");
+        return SyntaxError;
+        }
+
+    double*        base  = interp->memory + node->data.id * ARRAY_MAX_SIZE + ARRAY_SEGMENT;
+    const RunNode* index = nullptr;
+    RunNode*       place = nullptr;
+
+    if (!node->right || node->right->type == VALUE)
+        {
+        double shift = node->right ? node->right->data.val : 0;
+        if (!(0 <= shift && shift < ARRAY_MAX_SIZE))
+            {
+            printf("Syntax error: array index %lg out of range\n", shift);
+            return SyntaxError;
+            }
+
+        place = NewRunNode(interp, RunLoad);
+        if (place) place->cell = base + (int) shift;
+        }
+    else
+        {
+        if (CompileExpression(interp, node->right, &index) != Ok) return SyntaxError;
+
+        place = NewRunNode(interp, RunLoadElement, index);
+        if (place) place->cell = base;
+        }
+
+    *result = place;
+    return place ? Ok : AllocationError;
+    }
+
+static Error_t CompileAssigment(Interp* interp, const Node* node, const RunNode** result)
+    {
+    const RunNode* place = nullptr;
+    const RunNode* value = nullptr;
+    if (!node->left ||
+        CompilePlace(interp, node->left, &place) != Ok ||
+        CompileExpression(interp, node->right, &value) != Ok) return SyntaxError;
+
+    RunEval eval = FindHandler(ASSIGMENT_HANDLERS, sizeof(ASSIGMENT_HANDLERS) / sizeof(RunOperation), node->data.id);
+    if (!eval) eval = place->left ? RunAssignElement : RunAssign;
+
+    *result = NewRunNode(interp, eval, place, value);
+    return *result ? Ok : AllocationError;
+    }
+
+// әгәр - условие и тело, тимәк - условие и тело своего әгәр, а в other следующая ветка
+static Error_t CompileIf(Interp* interp, const Node* node, const RunNode** result)
+    {
+    const Node*    if_node   = (node->data.id == OP_ELSE) ? node->left : node;
+    const RunNode* condition = nullptr;
+    const RunNode* body      = nullptr;
+    const RunNode* other     = nullptr;
+
+    if (!if_node ||
+        CompileExpression(interp, if_node->left, &condition) != Ok ||
+        CompileBody(interp, if_node->right, &body) != Ok) return SyntaxError;
+
+    if (node->data.id == OP_ELSE)
+        {
+        const Node* next = node->right;
+        bool branch = next && next->type == OPERATION && (next->data.id == OP_IF || next->data.id == OP_ELSE);
+
+        if ((branch ? CompileIf(interp, next, &other) : CompileBody(interp, next, &other)) != Ok) return SyntaxError;
+        }
+
+    RunNode* run_if = NewRunNode(interp, RunIf, condition, body);
+    if (run_if) run_if->other = other;
+    *result = run_if;
+
+    return run_if ? Ok : AllocationError;
+    }
+
+static Error_t CompileCall(Interp* interp, const Node* node, const RunNode** result)
+    {
+    RunFunction* function = interp->functions + node->data.id;
+    if (!function->defined)
+        {
+        printf("Syntax error: function %d is not defined\n", node->data.id);
+        return SyntaxError;
+        }
+
+    RunNode* first = nullptr;
+    RunNode* last  = nullptr;
+    int      count = 0;
+    for (const Node* parametr = node->right; parametr; parametr = parametr->right, count++)
+        {
+        const RunNode* arg = nullptr;
+        if (count == INTERP_MAX_PARAMETRS)
+            {
+            printf("Syntax error: too many arguments of function %d\n", node->data.id);
+            return SyntaxError;
+            }
+        if (CompileExpression(interp, parametr->left, &arg) != Ok) return SyntaxError;
+
+        RunNode* link = NewRunNode(interp, RunNop, arg);
+        if (!link) return AllocationError;
+
+        if (last) last->right = link;
+        else      first       = link;
+        last = link;
+        }
+
+    RunNode* call = NewRunNode(interp, RunCall, nullptr, first);
+    if (call) call->function = function;
+    *result = call;
+
+    return call ? Ok : AllocationError;
+    }
+
+// Функция отмечается определённой до перевода тела, чтобы работала рекурсия
+static Error_t CompileDefineFunction(Interp* interp, const Node* node)
+    {
+    const Node* head = node->left;
+    if (!head || head->type != FUNCTION)
+        {
+        printf("Syntax error: wrong function definition\n");
+        return SyntaxError;
+        }
+
+    RunFunction* function = interp->functions + head->data.id;
+    function->param_count = 0;
+    for (const Node* parametr = head->right; parametr; parametr = parametr->right)
+        {
+        const Node* variable = parametr->left ? parametr->left->left : nullptr;
+        if (!variable || variable->type != VARIABLE || function->param_count == INTERP_MAX_PARAMETRS)
+            {
+            printf("Syntax error: wrong parametrs of function %d\n", head->data.id);
+            return SyntaxError;
+            }
+        function->params[function->param_count++] = interp->memory + variable->data.id;
+        }
+
+    function->defined = true;
+
+    return CompileBody(interp, node->right, &function->body);
+    }
+
+// Инициализация массива - обычные присваивания в его ячейки
+static Error_t CompileDefineArray(Interp* interp, const Node* node, const RunNode** result)
+    {
+    const Node* array = node->left;
+    if (!array || array->type != ARRAY || !array->right || array->right->type != VALUE)
+        {
+        printf("Syntax error: wrong array definition\n");
+        return SyntaxError;
+        }
+
+    double   size  = array->right->data.val;
+    double*  base  = interp->memory + array->data.id * ARRAY_MAX_SIZE + ARRAY_SEGMENT;
+    RunNode* first = nullptr;
+    RunNode* last  = nullptr;
+    int      count = 0;
+    for (const Node* parametr = node->right; parametr && count < size && count < ARRAY_MAX_SIZE; parametr = parametr->right, count++)
+        {
+        const RunNode* value = nullptr;
+        if (CompileExpression(interp, parametr->left, &value) != Ok) return SyntaxError;
+
+        RunNode* place  = NewRunNode(interp, RunLoad);
+        RunNode* assign = place ? NewRunNode(interp, RunAssign, place, value) : nullptr;
+        RunNode* block  = assign ? NewRunNode(interp, RunBlock, assign) : nullptr;
+        if (!block) return AllocationError;
+        place->cell = base + count;
+
+        if (last) last->right = block;
+        else      first       = block;
+        last = block;
+        }
+
+    *result = first;
+
+    return Ok;
+    }
+
+static double* Place(Interp* interp, const RunNode* place)
+    {
+    if (!place->left) return place->cell;
+
+    double index = place->left->eval(interp, place->left);
+    if (!(0 <= index && index < ARRAY_MAX_SIZE))
+        {
+        if (!interp->unwinding) RunError(interp, "array index out of range", CalculationError);
+        return nullptr;
+        }
+
+    return place->cell + (int) index;
+    }
+
+static void RunError(Interp* interp, const char* message, Error_t error)
+    {
+    printf("Error: %s\n", message);
+    interp->error     = error;
+    interp->unwinding = true;
+    }
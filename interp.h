@@ -0,0 +1,42 @@
+#ifndef INTERP_H
+#define INTERP_H
+
+const int INTERP_CHUNK_SIZE     = 256;
+const int INTERP_CALL_DEPTH     = 1 << 12;
+const int INTERP_MAX_PARAMETRS  = 8;
+
+struct RunNode;
+struct RunChunk;
+struct RunFunction;
+
+// Исполнитель дерева программы. InterpCtor один раз переводит Node в RunNode с уже
+// выбранными обработчиками и адресами ячеек, InterpRun только вызывает обработчики.
+// Память устроена как у бэкенда: [id] для переменных, массивы с ARRAY_SEGMENT.
+struct Interp
+    {
+    RunChunk*       chunks;
+    const RunNode*  program;
+    RunFunction*    functions;
+    int             function_count;
+    double*         memory;
+    int             memory_size;
+
+    FILE*           in;
+    FILE*           out;
+
+    int             depth;
+    bool            unwinding;
+    double          result;
+    Error_t         error;
+
+    long            nodes;
+    double          seconds;
+    };
+
+Error_t InterpCtor(Interp* interp, const Node* root, FILE* in, FILE* out);
+Error_t InterpDtor(Interp* interp);
+
+Error_t InterpRun(Interp* interp);
+void    InterpReport(const Interp* interp, FILE* fp);
+
+#endif //INTERP_H
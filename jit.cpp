@@ -0,0 +1,854 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include <sys/mman.h>
+#include "errors.h"
+#include "timer.h"
+#include "node.h"
+#include "flattree.h"
+#include "treeio.h"
+#include "asmcode.h"
+#include "bytecode.h"
+#include "vm.h"
+#include "jit.h"
+
+// Регистры x86-64: rbx - вершина стека в памяти, r12 - память, r13 - регистры
+// виртуальной машины, r14 - JitContext, r15 - оставшаяся глубина вызовов,
+// rbp - кадр входа, по нему уходим из любой глубины при ошибке
+enum JitRegister
+    {
+    RAX = 0,
+    RBX = 3,
+    RSP = 4,
+    RBP = 5,
+    RSI = 6,
+    RDI = 7,
+    R12 = 12,
+    R13 = 13,
+    R14 = 14,
+    R15 = 15,
+    };
+
+// xmm0 и xmm1 - рабочие, с xmm2 лежат закэшированные числа стека (нижнее - в xmm2)
+const int JIT_SCRATCH    = 0;
+const int JIT_SCRATCH2   = 1;
+const int JIT_FIRST_SLOT = 2;
+
+// Что возвращает машинный код
+enum JitStatus
+    {
+    JIT_OK              = 0,
+    JIT_STACK_OVERFLOW  = 1,
+    JIT_STACK_UNDERFLOW = 2,
+    JIT_INPUT_ERROR     = 3,
+    JIT_INDEX_ERROR     = 4,
+    };
+
+enum JitStub
+    {
+    STUB_EXIT       = 0,
+    STUB_OVERFLOW   = 1,
+    STUB_UNDERFLOW  = 2,
+    STUB_INPUT      = 3,
+    STUB_INDEX      = 4,
+    STUB_COUNT      = 5,
+    };
+
+enum JitCondition
+    {
+    CC_BELOW        = 0x2,
+    CC_ABOVE_EQUAL  = 0x3,
+    CC_EQUAL        = 0x4,
+    CC_NOT_EQUAL    = 0x5,
+    CC_ABOVE        = 0x7,
+    };
+
+enum JitPredicate
+    {
+    PRED_LESS       = 1,
+    PRED_LESS_EQUAL = 2,
+    };
+
+struct JitContext
+    {
+    double*     stack;
+    double*     stack_end;
+    double*     memory;
+    double*     registers;
+    Vm*         vm;
+    long        depth;
+    double      one;
+    double      zero;
+    double      input;
+    };
+
+// target >= 0 - номер команды байткода, иначе -1 - номер заглушки
+struct JitFixup
+    {
+    size_t      at;
+    int         target;
+    };
+
+struct JitWriter
+    {
+    unsigned char*  code;
+    size_t          size;
+    size_t          capacity;
+
+    size_t*         offsets;
+    JitFixup*       fixups;
+    int             fixup_count;
+    int             fixup_capacity;
+    size_t          stubs[STUB_COUNT];
+
+    int             cached;
+    Error_t         error;
+    };
+
+typedef int (*JitEntry)(JitContext* context);
+
+static void    Prologue(JitWriter* writer);
+static void    Stubs(JitWriter* writer);
+static Error_t Translate(JitWriter* writer, const ByteCode* code, int pos);
+static void    Patch(JitWriter* writer);
+
+static void    Flush(JitWriter* writer, int keep);
+static void    Need(JitWriter* writer, int count);
+static void    Room(JitWriter* writer);
+static void    Compare(JitWriter* writer, int predicate, bool swap);
+static void    Truth(JitWriter* writer, int slot);
+static void    LoadOne(JitWriter* writer);
+static void    CallMath(JitWriter* writer, unsigned long long function, int args);
+static void    CallHelper(JitWriter* writer, unsigned long long function);
+
+static void    Byte(JitWriter* writer, unsigned value);
+static void    Dword(JitWriter* writer, unsigned value);
+static void    Rex(JitWriter* writer, bool wide, int reg, int rm);
+static void    ModRegister(JitWriter* writer, int reg, int rm);
+static void    ModMemory(JitWriter* writer, int reg, int base, int disp);
+static void    Sse(JitWriter* writer, unsigned prefix, unsigned opcode, int reg, int rm);
+static void    SseMemory(JitWriter* writer, unsigned prefix, unsigned opcode, int reg, int base, int disp);
+static void    GpMemory(JitWriter* writer, unsigned opcode, int reg, int base, int disp);
+static void    GpImmediate(JitWriter* writer, int ext, int rm, int value);
+static void    GpUnary(JitWriter* writer, int ext, int rm);
+static void    ElementIndex(JitWriter* writer, int slot);
+static void    SseElement(JitWriter* writer, unsigned opcode, int reg, int base);
+static void    MoveImmediate(JitWriter* writer, unsigned long long value);
+static void    Push(JitWriter* writer, int reg);
+static void    Pop(JitWriter* writer, int reg);
+static void    Jump(JitWriter* writer, unsigned opcode, int target);
+static void    JumpIf(JitWriter* writer, int condition, int target);
+static int     Stub(int stub);
+static int     Slot(int index);
+
+static int     JitIn(Vm* vm, double* value);
+static double  JitOut(Vm* vm, double value);
+static double  JitPow(double a, double b);
+static double  JitSin(double a);
+static double  JitCos(double a);
+
+Error_t JitCtor(JitCode* jit)
+    {
+    assert(jit);
+
+    jit->code     = nullptr;
+    jit->size     = 0;
+    jit->commands = 0;
+    jit->seconds  = 0;
+
+    return Ok;
+    }
+
+Error_t JitDtor(JitCode* jit)
+    {
+    assert(jit);
+
+    if (jit->code) munmap(jit->code, jit->size);
+    jit->code     = nullptr;
+    jit->size     = 0;
+    jit->commands = 0;
+
+    return Ok;
+    }
+
+// Шаблонный перевод: каждая команда байткода - свой кусок машинного кода.
+// Верх стека держится в xmm, в память он сбрасывается только перед метками,
+// переходами, вызовами и при переполнении кэша, поэтому на входе в любую
+// метку кэш пуст. Вне x86-64 возвращается BadCode, и остаётся VmRun.
+Error_t JitCompile(JitCode* jit, const ByteCode* code)
+    {
+    assert(jit);
+    assert(code);
+
+#if !defined(__x86_64__)
+    return BadCode;
+#endif
+
+    JitWriter writer = {};
+    writer.offsets   = (size_t*) calloc((size_t) code->size + 1, sizeof(size_t));
+    bool*     target = (bool*)   calloc((size_t) code->size + 1, sizeof(bool));
+    if (!writer.offsets || !target)
+        {
+        printf("Error: cannot allocate memory for JIT\n");
+        free(writer.offsets);
+        free(target);
+        return AllocationError;
+        }
+
+    for (int pos = 0; pos < code->size; pos++)
+        {
+        const ByteInstr* instr = code->code + pos;
+        if (instr->opcode == BC_JMP || instr->opcode == BC_JE || instr->opcode == BC_JNE || instr->opcode == BC_CALL)
+            {
+            if (instr->arg < 0 || instr->arg > code->size) writer.error = BadCode;
+            else target[instr->arg] = true;
+            }
+        }
+
+    Prologue(&writer);
+
+    Error_t state = writer.error;
+    for (int pos = 0; pos <= code->size && state == Ok; pos++)
+        {
+        if (target[pos]) Flush(&writer, 0);
+        writer.offsets[pos] = writer.size;
+
+        state = Translate(&writer, code, pos);
+        if (state == Ok) state = writer.error;
+        }
+
+    if (state == Ok) Stubs(&writer);
+    if (state == Ok) Patch(&writer);
+    if (state == Ok) state = writer.error;
+
+    if (state == Ok)
+        {
+        void* map = mmap(nullptr, writer.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED)
+            {
+            state = AllocationError;
+            }
+        else
+            {
+            memcpy(map, writer.code, writer.size);
+            if (mprotect(map, writer.size, PROT_READ | PROT_EXEC) != 0)
+                {
+                munmap(map, writer.size);
+                state = AllocationError;
+                }
+            else
+                {
+                JitDtor(jit);
+                jit->code     = (unsigned char*) map;
+                jit->size     = writer.size;
+                jit->commands = code->size;
+                }
+            }
+        }
+
+    free(writer.code);
+    free(writer.offsets);
+    free(writer.fixups);
+    free(target);
+
+    return state;
+    }
+
+Error_t JitRun(JitCode* jit, Vm* vm)
+    {
+    assert(jit);
+    assert(jit->code);
+    assert(vm);
+
+    JitContext context = {};
+    context.stack      = vm->stack;
+    context.stack_end  = vm->stack + VM_STACK_SIZE;
+    context.memory     = vm->memory;
+    context.registers  = vm->registers;
+    context.vm         = vm;
+    context.depth      = VM_CALL_DEPTH;
+    context.one        = 1;
+    context.zero       = 0;
+
+    JitEntry entry = nullptr;
+    memcpy(&entry, &jit->code, sizeof(entry));
+
+    double start = Now();
+    int    status = entry(&context);
+    jit->seconds = Now() - start;
+
+    switch (status)
+        {
+        case JIT_OK:
+            return Ok;
+        case JIT_STACK_OVERFLOW:
+            printf("Error: virtual machine stack overflow\n");
+            return CalculationError;
+        case JIT_STACK_UNDERFLOW:
+            printf("Error: virtual machine stack is empty\n");
+            return CalculationError;
+        case JIT_INPUT_ERROR:
+            printf("Error: cannot read a number\n");
+            return FileError;
+        case JIT_INDEX_ERROR:
+            printf("Error: array index out of range\n");
+            return CalculationError;
+        default:
+            return BadCode;
+        }
+    }
+
+void JitReport(const JitCode* jit, FILE* fp)
+    {
+    assert(jit);
+    assert(fp);
+
+    fprintf(fp, "JIT: %d commands in %zu bytes of machine code, run in %.3f s\n", jit->commands, jit->size, jit->seconds);
+    }
+
+// Вход сохраняет регистры вызывающего и вызывает программу как функцию,
+// поэтому ret в самой программе - это остановка, как и в VmRun
+static void Prologue(JitWriter* writer)
+    {
+    Push(writer, RBP);
+    Rex(writer, true, RSP, RBP);
+    Byte(writer, 0x89);
+    ModRegister(writer, RSP, RBP);
+    Push(writer, RBX);
+    Push(writer, R12);
+    Push(writer, R13);
+    Push(writer, R14);
+    Push(writer, R15);
+    GpImmediate(writer, 5, RSP, 8);
+
+    Rex(writer, true, RDI, R14);
+    Byte(writer, 0x89);
+    ModRegister(writer, RDI, R14);
+    GpMemory(writer, 0x8B, RBX, R14, offsetof(JitContext, stack));
+    GpMemory(writer, 0x8B, R12, R14, offsetof(JitContext, memory));
+    GpMemory(writer, 0x8B, R13, R14, offsetof(JitContext, registers));
+    GpMemory(writer, 0x8B, R15, R14, offsetof(JitContext, depth));
+
+    GpImmediate(writer, 5, RSP, 8);
+    Jump(writer, 0xE8, 0);
+    GpImmediate(writer, 0, RSP, 8);
+    Byte(writer, 0x31);
+    ModRegister(writer, RAX, RAX);
+    Jump(writer, 0xE9, Stub(STUB_EXIT));
+    }
+
+static void Stubs(JitWriter* writer)
+    {
+    static const int STATUS[STUB_COUNT] = {JIT_OK, JIT_STACK_OVERFLOW, JIT_STACK_UNDERFLOW, JIT_INPUT_ERROR, JIT_INDEX_ERROR};
+
+    for (int stub = STUB_OVERFLOW; stub < STUB_COUNT; stub++)
+        {
+        writer->stubs[stub] = writer->size;
+        Byte(writer, 0xB8);
+        Dword(writer, (unsigned) STATUS[stub]);
+        Jump(writer, 0xE9, Stub(STUB_EXIT));
+        }
+
+    writer->stubs[STUB_EXIT] = writer->size;
+    GpMemory(writer, 0x8D, RSP, RBP, -40);
+    Pop(writer, R15);
+    Pop(writer, R14);
+    Pop(writer, R13);
+    Pop(writer, R12);
+    Pop(writer, RBX);
+    Pop(writer, RBP);
+    Byte(writer, 0xC3);
+    }
+
+static Error_t Translate(JitWriter* writer, const ByteCode* code, int pos)
+    {
+    if (pos == code->size)
+        {
+        Byte(writer, 0x31);
+        ModRegister(writer, RAX, RAX);
+        Jump(writer, 0xE9, Stub(STUB_EXIT));
+        return Ok;
+        }
+
+    const ByteInstr* instr = code->code + pos;
+    int              a     = Slot(writer->cached - 2);
+    int              b     = Slot(writer->cached - 1);
+
+    switch (instr->opcode)
+        {
+        case BC_HALT:
+            Byte(writer, 0x31);
+            ModRegister(writer, RAX, RAX);
+            Jump(writer, 0xE9, Stub(STUB_EXIT));
+            writer->cached = 0;
+            break;
+
+        case BC_PUSH_NUMBER:
+            {
+            Room(writer);
+            unsigned long long bits = 0;
+            memcpy(&bits, code->constants + instr->arg, sizeof(bits));
+            int slot = Slot(writer->cached++);
+            if (!bits)
+                {
+                Sse(writer, 0x66, 0x57, slot, slot);
+                }
+            else
+                {
+                MoveImmediate(writer, bits);
+                Byte(writer, 0x66);
+                Rex(writer, true, slot, RAX);
+                Byte(writer, 0x0F);
+                Byte(writer, 0x6E);
+                ModRegister(writer, slot, RAX);
+                }
+            break;
+            }
+        case BC_PUSH_MEMORY:
+        case BC_PUSH_REG:
+            Room(writer);
+            SseMemory(writer, 0xF2, 0x10, Slot(writer->cached++), instr->opcode == BC_PUSH_MEMORY ? R12 : R13, instr->arg * 8);
+            break;
+        case BC_POP_MEMORY:
+        case BC_POP_REG:
+            Need(writer, 1);
+            SseMemory(writer, 0xF2, 0x11, Slot(--writer->cached), instr->opcode == BC_POP_MEMORY ? R12 : R13, instr->arg * 8);
+            break;
+        case BC_POP_TRASH:
+            Need(writer, 1);
+            writer->cached--;
+            break;
+        case BC_PUSH_ELEMENT:
+            Need(writer, 1);
+            a = Slot(writer->cached - 1);
+            ElementIndex(writer, a);
+            SseElement(writer, 0x10, a, instr->arg * 8);
+            break;
+        case BC_POP_ELEMENT:
+            Need(writer, 2);
+            ElementIndex(writer, Slot(writer->cached - 1));
+            SseElement(writer, 0x11, Slot(writer->cached - 2), instr->arg * 8);
+            writer->cached -= 2;
+            break;
+
+        case BC_ADD: case BC_SUB: case BC_MUL: case BC_DIV:
+            {
+            static const unsigned ARITHMETIC[] = {0x58, 0x5C, 0x59, 0x5E};
+            Need(writer, 2);
+            a = Slot(writer->cached - 2);
+            b = Slot(writer->cached - 1);
+            Sse(writer, 0xF2, ARITHMETIC[instr->opcode - BC_ADD], a, b);
+            writer->cached--;
+            break;
+            }
+        case BC_SQRT:
+            Need(writer, 1);
+            b = Slot(writer->cached - 1);
+            Sse(writer, 0xF2, 0x51, b, b);
+            break;
+        case BC_POW:
+            CallMath(writer, (unsigned long long) JitPow, 2);
+            break;
+        case BC_SIN:
+            CallMath(writer, (unsigned long long) JitSin, 1);
+            break;
+        case BC_COS:
+            CallMath(writer, (unsigned long long) JitCos, 1);
+            break;
+
+        case BC_LT: Compare(writer, PRED_LESS,       false); break;
+        case BC_LE: Compare(writer, PRED_LESS_EQUAL, false); break;
+        case BC_GT: Compare(writer, PRED_LESS,       true);  break;
+        case BC_GE: Compare(writer, PRED_LESS_EQUAL, true);  break;
+        // a == b - это !(a < b || a > b), как в VmRun
+        case BC_EQ: case BC_NE:
+            Need(writer, 2);
+            a = Slot(writer->cached - 2);
+            b = Slot(writer->cached - 1);
+            Sse(writer, 0x66, 0x28, JIT_SCRATCH, a);
+            Sse(writer, 0xF2, 0xC2, JIT_SCRATCH, b);
+            Byte(writer, PRED_LESS);
+            Sse(writer, 0xF2, 0xC2, b, a);
+            Byte(writer, PRED_LESS);
+            Sse(writer, 0x66, 0x56, b, JIT_SCRATCH);
+            LoadOne(writer);
+            Sse(writer, 0x66, instr->opcode == BC_EQ ? 0x55 : 0x54, b, JIT_SCRATCH2);
+            Sse(writer, 0x66, 0x28, a, b);
+            writer->cached--;
+            break;
+        case BC_AND: case BC_OR:
+            Need(writer, 2);
+            a = Slot(writer->cached - 2);
+            b = Slot(writer->cached - 1);
+            Truth(writer, a);
+            Truth(writer, b);
+            Sse(writer, 0x66, instr->opcode == BC_AND ? 0x54 : 0x56, a, b);
+            LoadOne(writer);
+            Sse(writer, 0x66, 0x54, a, JIT_SCRATCH2);
+            writer->cached--;
+            break;
+        case BC_NOT:
+            Need(writer, 1);
+            b = Slot(writer->cached - 1);
+            Truth(writer, b);
+            LoadOne(writer);
+            Sse(writer, 0x66, 0x55, b, JIT_SCRATCH2);
+            break;
+
+        // Ввод и вывод - вызовы C, они портят все xmm, поэтому кэш сбрасывается
+        case BC_IN:
+            Flush(writer, 0);
+            GpMemory(writer, 0x8B, RDI, R14, offsetof(JitContext, vm));
+            GpMemory(writer, 0x8D, RSI, R14, offsetof(JitContext, input));
+            CallHelper(writer, (unsigned long long) JitIn);
+            Byte(writer, 0x85);
+            ModRegister(writer, RAX, RAX);
+            JumpIf(writer, CC_EQUAL, Stub(STUB_INPUT));
+            SseMemory(writer, 0xF2, 0x10, Slot(0), R14, offsetof(JitContext, input));
+            writer->cached = 1;
+            break;
+        case BC_OUT:
+            Need(writer, 1);
+            Flush(writer, 1);
+            GpMemory(writer, 0x8B, RDI, R14, offsetof(JitContext, vm));
+            Sse(writer, 0x66, 0x28, JIT_SCRATCH, Slot(0));
+            CallHelper(writer, (unsigned long long) JitOut);
+            Sse(writer, 0x66, 0x28, Slot(0), JIT_SCRATCH);
+            break;
+
+        case BC_JMP:
+            Flush(writer, 0);
+            Jump(writer, 0xE9, instr->arg);
+            break;
+        case BC_JE: case BC_JNE:
+            Need(writer, 2);
+            Flush(writer, 2);
+            Sse(writer, 0x66, 0x2E, Slot(0), Slot(1));
+            JumpIf(writer, instr->opcode == BC_JE ? CC_EQUAL : CC_NOT_EQUAL, instr->arg);
+            writer->cached = 0;
+            break;
+        // Стек выровнен на 16 во всём коде, поэтому вызов сдвигает rsp на 8
+        case BC_CALL:
+            Flush(writer, 0);
+            GpUnary(writer, 1, R15);
+            JumpIf(writer, CC_EQUAL, Stub(STUB_OVERFLOW));
+            GpImmediate(writer, 5, RSP, 8);
+            Jump(writer, 0xE8, instr->arg);
+            GpImmediate(writer, 0, RSP, 8);
+            GpUnary(writer, 0, R15);
+            break;
+        case BC_RET:
+            Flush(writer, 0);
+            Byte(writer, 0xC3);
+            break;
+
+        default:
+            return BadCode;
+        }
+
+    return Ok;
+    }
+
+static void Patch(JitWriter* writer)
+    {
+    for (int fixup = 0; fixup < writer->fixup_count; fixup++)
+        {
+        const JitFixup* patch  = writer->fixups + fixup;
+        size_t          target = patch->target >= 0 ? writer->offsets[patch->target] : writer->stubs[-1 - patch->target];
+        int             rel    = (int) ((long) target - (long) (patch->at + 4));
+        memcpy(writer->code + patch->at, &rel, sizeof(rel));
+        }
+    }
+
+// В памяти остаются все закэшированные числа, кроме keep верхних, они переезжают в xmm2...
+static void Flush(JitWriter* writer, int keep)
+    {
+    int count = writer->cached - keep;
+    if (count <= 0) return;
+
+    GpMemory(writer, 0x8D, RAX, RBX, count * 8);
+    GpMemory(writer, 0x3B, RAX, R14, offsetof(JitContext, stack_end));
+    JumpIf(writer, CC_ABOVE, Stub(STUB_OVERFLOW));
+
+    for (int index = 0; index < count; index++) SseMemory(writer, 0xF2, 0x11, Slot(index), RBX, index * 8);
+    GpImmediate(writer, 0, RBX, count * 8);
+
+    for (int index = 0; index < keep; index++) Sse(writer, 0x66, 0x28, Slot(index), Slot(count + index));
+    writer->cached = keep;
+    }
+
+// Недостающие снизу числа читаются из памяти, закэшированные сдвигаются вверх
+static void Need(JitWriter* writer, int count)
+    {
+    int missing = count - writer->cached;
+    if (missing <= 0) return;
+
+    GpMemory(writer, 0x8D, RAX, RBX, -missing * 8);
+    GpMemory(writer, 0x3B, RAX, R14, offsetof(JitContext, stack));
+    JumpIf(writer, CC_BELOW, Stub(STUB_UNDERFLOW));
+
+    for (int index = writer->cached - 1; index >= 0; index--) Sse(writer, 0x66, 0x28, Slot(index + missing), Slot(index));
+    for (int index = 0; index < missing; index++) SseMemory(writer, 0xF2, 0x10, Slot(index), RBX, (index - missing) * 8);
+    GpImmediate(writer, 5, RBX, missing * 8);
+
+    writer->cached = count;
+    }
+
+static void Room(JitWriter* writer)
+    {
+    if (writer->cached == JIT_CACHE_SIZE) Flush(writer, 0);
+    }
+
+// cmpsd даёт маску из единиц, and с 1.0 превращает её в 1 или 0
+static void Compare(JitWriter* writer, int predicate, bool swap)
+    {
+    Need(writer, 2);
+    int a = Slot(writer->cached - 2);
+    int b = Slot(writer->cached - 1);
+
+    int result = swap ? b : a;
+    Sse(writer, 0xF2, 0xC2, result, swap ? a : b);
+    Byte(writer, (unsigned) predicate);
+    LoadOne(writer);
+    Sse(writer, 0x66, 0x54, result, JIT_SCRATCH2);
+    if (swap) Sse(writer, 0x66, 0x28, a, b);
+
+    writer->cached--;
+    }
+
+// Маска истинности x < 0 || 0 < x на месте числа
+static void Truth(JitWriter* writer, int slot)
+    {
+    Sse(writer, 0x66, 0x28, JIT_SCRATCH, slot);
+    SseMemory(writer, 0xF2, 0xC2, JIT_SCRATCH, R14, offsetof(JitContext, zero));
+    Byte(writer, PRED_LESS);
+    Sse(writer, 0x66, 0x57, JIT_SCRATCH2, JIT_SCRATCH2);
+    Sse(writer, 0xF2, 0xC2, JIT_SCRATCH2, slot);
+    Byte(writer, PRED_LESS);
+    Sse(writer, 0x66, 0x56, JIT_SCRATCH, JIT_SCRATCH2);
+    Sse(writer, 0x66, 0x28, slot, JIT_SCRATCH);
+    }
+
+static void LoadOne(JitWriter* writer)
+    {
+    SseMemory(writer, 0xF2, 0x10, JIT_SCRATCH2, R14, offsetof(JitContext, one));
+    }
+
+static void CallMath(JitWriter* writer, unsigned long long function, int args)
+    {
+    Need(writer, args);
+    Flush(writer, args);
+
+    Sse(writer, 0x66, 0x28, JIT_SCRATCH, Slot(0));
+    if (args > 1) Sse(writer, 0x66, 0x28, JIT_SCRATCH2, Slot(1));
+    CallHelper(writer, function);
+    Sse(writer, 0x66, 0x28, Slot(0), JIT_SCRATCH);
+
+    writer->cached = 1;
+    }
+
+static void CallHelper(JitWriter* writer, unsigned long long function)
+    {
+    MoveImmediate(writer, function);
+    Byte(writer, 0xFF);
+    ModRegister(writer, 2, RAX);
+    }
+
+static void Byte(JitWriter* writer, unsigned value)
+    {
+    if (writer->size == writer->capacity)
+        {
+        size_t         capacity = writer->capacity ? writer->capacity * 2 : JIT_DEFAULT_SIZE;
+        unsigned char* code     = (unsigned char*) realloc(writer->code, capacity);
+        if (!code)
+            {
+            writer->error = AllocationError;
+            return;
+            }
+        writer->code     = code;
+        writer->capacity = capacity;
+        }
+
+    writer->code[writer->size++] = (unsigned char) value;
+    }
+
+static void Dword(JitWriter* writer, unsigned value)
+    {
+    for (int shift = 0; shift < 32; shift += 8) Byte(writer, value >> shift & 0xFF);
+    }
+
+static void Rex(JitWriter* writer, bool wide, int reg, int rm)
+    {
+    unsigned rex = 0x40 | (wide ? 8 : 0) | (unsigned) (reg >> 3 & 1) << 2 | (unsigned) (rm >> 3 & 1);
+    if (rex != 0x40) Byte(writer, rex);
+    }
+
+static void ModRegister(JitWriter* writer, int reg, int rm)
+    {
+    Byte(writer, 0xC0 | (unsigned) (reg & 7) << 3 | (unsigned) (rm & 7));
+    }
+
+// Всегда [base + disp32], для rsp и r12 нужен байт SIB
+static void ModMemory(JitWriter* writer, int reg, int base, int disp)
+    {
+    Byte(writer, 0x80 | (unsigned) (reg & 7) << 3 | (unsigned) (base & 7));
+    if ((base & 7) == RSP) Byte(writer, 0x24);
+    Dword(writer, (unsigned) disp);
+    }
+
+static void Sse(JitWriter* writer, unsigned prefix, unsigned opcode, int reg, int rm)
+    {
+    if (prefix) Byte(writer, prefix);
+    Rex(writer, false, reg, rm);
+    Byte(writer, 0x0F);
+    Byte(writer, opcode);
+    ModRegister(writer, reg, rm);
+    }
+
+static void SseMemory(JitWriter* writer, unsigned prefix, unsigned opcode, int reg, int base, int disp)
+    {
+    if (prefix) Byte(writer, prefix);
+    Rex(writer, false, reg, base);
+    Byte(writer, 0x0F);
+    Byte(writer, opcode);
+    ModMemory(writer, reg, base, disp);
+    }
+
+static void GpMemory(JitWriter* writer, unsigned opcode, int reg, int base, int disp)
+    {
+    Rex(writer, true, reg, base);
+    Byte(writer, opcode);
+    ModMemory(writer, reg, base, disp);
+    }
+
+// ext 0 - add, 5 - sub, 7 - cmp
+static void GpImmediate(JitWriter* writer, int ext, int rm, int value)
+    {
+    Rex(writer, true, 0, rm);
+    Byte(writer, 0x81);
+    ModRegister(writer, ext, rm);
+    Dword(writer, (unsigned) value);
+    }
+
+// ext 0 - inc, 1 - dec
+static void GpUnary(JitWriter* writer, int ext, int rm)
+    {
+    Rex(writer, true, 0, rm);
+    Byte(writer, 0xFF);
+    ModRegister(writer, ext, rm);
+    }
+
+// Индекс из slot попадает в rax, иначе выход с ошибкой, как у стековой машины
+static void ElementIndex(JitWriter* writer, int slot)
+    {
+    SseMemory(writer, 0x66, 0x2E, slot, R14, offsetof(JitContext, zero));
+    JumpIf(writer, CC_BELOW, Stub(STUB_INDEX));
+
+    Byte(writer, 0xF2);
+    Rex(writer, true, RAX, slot);
+    Byte(writer, 0x0F);
+    Byte(writer, 0x2C);
+    ModRegister(writer, RAX, slot);
+
+    GpImmediate(writer, 7, RAX, ASM_ARRAY_SIZE);
+    JumpIf(writer, CC_ABOVE_EQUAL, Stub(STUB_INDEX));
+    }
+
+// [r12 + rax*8 + base]
+static void SseElement(JitWriter* writer, unsigned opcode, int reg, int base)
+    {
+    Byte(writer, 0xF2);
+    Rex(writer, false, reg, R12);
+    Byte(writer, 0x0F);
+    Byte(writer, opcode);
+    Byte(writer, 0x80 | (unsigned) (reg & 7) << 3 | RSP);
+    Byte(writer, 0xC0 | RAX << 3 | (R12 & 7));
+    Dword(writer, (unsigned) base);
+    }
+
+static void MoveImmediate(JitWriter* writer, unsigned long long value)
+    {
+    Rex(writer, true, 0, RAX);
+    Byte(writer, 0xB8);
+    Dword(writer, (unsigned) (value & 0xFFFFFFFF));
+    Dword(writer, (unsigned) (value >> 32));
+    }
+
+static void Push(JitWriter* writer, int reg)
+    {
+    if (reg >= 8) Byte(writer, 0x41);
+    Byte(writer, 0x50 + (unsigned) (reg & 7));
+    }
+
+static void Pop(JitWriter* writer, int reg)
+    {
+    if (reg >= 8) Byte(writer, 0x41);
+    Byte(writer, 0x58 + (unsigned) (reg & 7));
+    }
+
+// opcode E9 - jmp, E8 - call; смещение дописывает Patch
+static void Jump(JitWriter* writer, unsigned opcode, int target)
+    {
+    Byte(writer, opcode);
+
+    if (writer->fixup_count == writer->fixup_capacity)
+        {
+        int       capacity = writer->fixup_capacity ? writer->fixup_capacity * 2 : JIT_DEFAULT_SIZE;
+        JitFixup* fixups   = (JitFixup*) realloc(writer->fixups, (size_t) capacity * sizeof(JitFixup));
+        if (!fixups)
+            {
+            writer->error = AllocationError;
+            return;
+            }
+        writer->fixups         = fixups;
+        writer->fixup_capacity = capacity;
+        }
+
+    writer->fixups[writer->fixup_count++] = {writer->size, target};
+    Dword(writer, 0);
+    }
+
+static void JumpIf(JitWriter* writer, int condition, int target)
+    {
+    Byte(writer, 0x0F);
+    Jump(writer, 0x80 | (unsigned) condition, target);
+    }
+
+static int Stub(int stub)
+    {
+    return -1 - stub;
+    }
+
+static int Slot(int index)
+    {
+    return JIT_FIRST_SLOT + index;
+    }
+
+static int JitIn(Vm* vm, double* value)
+    {
+    return fscanf(vm->in, "%lf", value) == 1;
+    }
+
+static double JitOut(Vm* vm, double value)
+    {
+    fprintf(vm->out, "%lg\n", value);
+    return value;
+    }
+
+static double JitPow(double a, double b)
+    {
+    return pow(a, b);
+    }
+
+static double JitSin(double a)
+    {
+    return sin(a);
+    }
+
+static double JitCos(double a)
+    {
+    return cos(a);
+    }
@@ -0,0 +1,24 @@
+#ifndef JIT_H
+#define JIT_H
+
+const int JIT_DEFAULT_SIZE = 4096;
+const int JIT_CACHE_SIZE   = 8;
+
+// Машинный код x86-64 для байткода, лежит в отдельном отображении с правом исполнения.
+// seconds заполняет JitRun для отчёта о скорости.
+struct JitCode
+    {
+    unsigned char*  code;
+    size_t          size;
+    int             commands;
+    double          seconds;
+    };
+
+Error_t JitCtor(JitCode* jit);
+Error_t JitDtor(JitCode* jit);
+
+Error_t JitCompile(JitCode* jit, const ByteCode* code);
+Error_t JitRun(JitCode* jit, Vm* vm);
+void    JitReport(const JitCode* jit, FILE* fp);
+
+#endif //JIT_H
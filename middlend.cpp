@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include "errors.h"
+#include "node.h"
+#include "stack.h"
+#include "tree.h"
+#include "wolfram.h"
+#include "middlend.h"
+
+static bool IsExpression(const Node* node);
+
+// Команды обходятся без рекурсии, Simplifier получает только выражения,
+// поэтому глубина его рекурсии ограничена глубиной выражения, а не длиной программы
+Error_t Middlend(Node** root, NodeArena* arena, long* simplified)
+    {
+    assert(root);
+    assert(arena);
+    assert(simplified);
+
+    Stack stack = {};
+    if (StackCtor(&stack, sizeof(Node**)) != Ok) return AllocationError;
+
+    Error_t state = StackPush(&stack, &root);
+    while (state == Ok && stack.size)
+        {
+        Node** slot = nullptr;
+        StackPop(&stack, &slot);
+
+        Node* node = *slot;
+        if (!node) continue;
+
+        if (IsExpression(node))
+            {
+            while (Simplifier(slot, arena)) (*simplified)++;
+            continue;
+            }
+
+        Node** right = &node->right;
+        Node** left  = &node->left;
+        state = StackPush(&stack, &right);
+        if (state == Ok) state = StackPush(&stack, &left);
+        }
+
+    StackDtor(&stack);
+
+    return state;
+    }
+
+static bool IsExpression(const Node* node)
+    {
+    if (node->type != OPERATION) return false;
+
+    switch (node->data.id)
+        {
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_POW:
+        case OP_GREATER: case OP_LESS: case OP_GREATER_EQUAL:
+        case OP_LESS_EQUAL: case OP_EQUAL: case OP_NOT_EQUAL:
+        case OP_AND: case OP_OR: case OP_NOT:
+        case OP_SIN: case OP_COS: case OP_SQRT: case OP_LOG: case OP_EXP:
+            return true;
+        default:
+            return false;
+        }
+    }
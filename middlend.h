@@ -0,0 +1,8 @@
+#ifndef MIDDLEND_H
+#define MIDDLEND_H
+
+// Упрощает все выражения программы правилами Simplifier: сворачивает константы,
+// сравнения и логику, убирает x * 1, x + 0, ... В simplified - число упрощений.
+Error_t Middlend(Node** root, NodeArena* arena, long* simplified);
+
+#endif //MIDDLEND_H
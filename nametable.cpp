@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "errors.h"
+#include "nametable.h"
+
+static unsigned HashName(const char* name, int length);
+static int      FindSlot(const NameTable* table, const char* name, int length, unsigned hash);
+static Error_t  ResizeSlots(NameTable* table);
+static int      InternName(NameTable* table, const char* name, int length);
+
+Error_t NameTableCtor(NameTable* table, const char* text)
+    {
+    assert(table);
+
+    table->pool          = nullptr;
+    table->pool_size     = 0;
+    table->pool_capacity = 0;
+
+    if (!text)
+        {
+        table->pool_capacity = NAME_POOL_DEFAULT_SIZE;
+        table->pool          = (char*) calloc((size_t) table->pool_capacity, sizeof(char));
+        if (!table->pool)
+            {
+            printf("Error: cannot allocate memory for name pool\n");
+            return AllocationError;
+            }
+        text = table->pool;
+        }
+
+    table->text = text;
+
+    table->size     = 0;
+    table->capacity = NAME_TABLE_DEFAULT_SIZE;
+    table->names    = (Name*) calloc((size_t) table->capacity, sizeof(Name));
+
+    table->slots_used     = 0;
+    table->slots_capacity = NAME_TABLE_DEFAULT_SIZE * NAME_TABLE_GROW_COEFF;
+    table->slots          = (int*) calloc((size_t) table->slots_capacity, sizeof(int));
+
+    table->scope_count    = 0;
+    table->scope_capacity = NAME_TABLE_DEFAULT_SCOPES;
+    table->scopes         = (Scope*) calloc((size_t) table->scope_capacity, sizeof(Scope));
+
+    if (!table->names || !table->slots || !table->scopes)
+        {
+        printf("Error: cannot allocate memory for name table\n");
+        free(table->names);
+        free(table->slots);
+        free(table->scopes);
+        free(table->pool);
+        return AllocationError;
+        }
+
+    for (int i = 0; i < table->slots_capacity; i++) table->slots[i] = NO_NAME;
+
+    return Ok;
+    }
+
+Error_t NameTableDtor(NameTable* table)
+    {
+    assert(table);
+
+    free(table->names);
+    free(table->slots);
+    free(table->scopes);
+    free(table->pool);
+
+    table->pool        = nullptr;
+    table->text        = nullptr;
+    table->size        = 0;
+    table->slots_used  = 0;
+    table->scope_count = 0;
+
+    return Ok;
+    }
+
+int NameTableFind(const NameTable* table, const char* name, int length)
+    {
+    assert(table);
+    assert(name);
+
+    int id = table->slots[FindSlot(table, name, length, HashName(name, length))];
+    if (id == NO_NAME || !table->names[id].active) return NO_NAME;
+
+    return id;
+    }
+
+int NameTableFindLocal(const NameTable* table, const char* name, int length)
+    {
+    assert(table);
+    assert(name);
+
+    int id = NameTableFind(table, name, length);
+    if (id == NO_NAME) return NO_NAME;
+
+    if (table->scope_count && id < table->scopes[table->scope_count - 1].first_name) return NO_NAME;
+
+    return id;
+    }
+
+int NameTableInsert(NameTable* table, const char* name, int length, int type, int index)
+    {
+    assert(table);
+    assert(name);
+
+    if ((table->slots_used + 1) * NAME_TABLE_GROW_COEFF > table->slots_capacity &&
+        ResizeSlots(table) != Ok)
+        {
+        return NO_NAME;
+        }
+
+    if (table->size == table->capacity)
+        {
+        Name* new_names = (Name*) realloc(table->names, (size_t) (table->capacity * NAME_TABLE_GROW_COEFF) * sizeof(Name));
+        if (!new_names)
+            {
+            printf("Error: cannot allocate memory for name table\n");
+            return NO_NAME;
+            }
+        table->names     = new_names;
+        table->capacity *= NAME_TABLE_GROW_COEFF;
+        }
+
+    unsigned hash = HashName(name, length);
+    int      slot = FindSlot(table, name, length, hash);
+    int      prev = table->slots[slot];
+
+    // Ячейка помнит каждое написание, поэтому в пул оно попадает один раз
+    int offset = prev != NO_NAME ? table->names[prev].offset
+               : table->pool     ? InternName(table, name, length)
+               :                   (int) (name - table->text);
+    if (offset == NO_NAME) return NO_NAME;
+
+    int id = table->size++;
+
+    if (prev == NO_NAME) table->slots_used++;
+
+    table->names[id].offset   = offset;
+    table->names[id].length   = length;
+    table->names[id].hash     = hash;
+    table->names[id].type     = type;
+    table->names[id].index    = index;
+    table->names[id].shadowed = (prev != NO_NAME && table->names[prev].active) ? prev : NO_NAME;
+    table->names[id].active   = true;
+
+    table->slots[slot] = id;
+
+    return id;
+    }
+
+Error_t NameTablePushScope(NameTable* table, int depth)
+    {
+    assert(table);
+
+    if (table->scope_count == table->scope_capacity)
+        {
+        Scope* new_scopes = (Scope*) realloc(table->scopes, (size_t) (table->scope_capacity * NAME_TABLE_GROW_COEFF) * sizeof(Scope));
+        if (!new_scopes)
+            {
+            printf("Error: cannot allocate memory for scope\n");
+            return AllocationError;
+            }
+        table->scopes          = new_scopes;
+        table->scope_capacity *= NAME_TABLE_GROW_COEFF;
+        }
+
+    table->scopes[table->scope_count].first_name = table->size;
+    table->scopes[table->scope_count].depth      = depth;
+    table->scope_count++;
+
+    return Ok;
+    }
+
+Error_t NameTablePopScope(NameTable* table)
+    {
+    assert(table);
+    assert(table->scope_count > 0);
+
+    int first_name = table->scopes[--table->scope_count].first_name;
+
+    for (int id = table->size - 1; id >= first_name; id--)
+        {
+        Name* name = table->names + id;
+        if (!name->active) continue;
+
+        name->active = false;
+        if (name->shadowed != NO_NAME)
+            {
+            table->slots[FindSlot(table, table->text + name->offset, name->length, name->hash)] = name->shadowed;
+            }
+        }
+
+    return Ok;
+    }
+
+int NameTableScopeDepth(const NameTable* table)
+    {
+    assert(table);
+
+    if (!table->scope_count) return GLOBAL_SCOPE;
+
+    return table->scopes[table->scope_count - 1].depth;
+    }
+
+static unsigned HashName(const char* name, int length)
+    {
+    assert(name);
+
+    unsigned hash = 2166136261u;
+    for (int i = 0; i < length; i++)
+        {
+        hash ^= (unsigned char) name[i];
+        hash *= 16777619u;
+        }
+
+    return hash;
+    }
+
+static int FindSlot(const NameTable* table, const char* name, int length, unsigned hash)
+    {
+    assert(table);
+    assert(name);
+
+    unsigned mask = (unsigned) table->slots_capacity - 1;
+    unsigned slot = hash & mask;
+
+    while (table->slots[slot] != NO_NAME)
+        {
+        const Name* other = table->names + table->slots[slot];
+        if (other->hash == hash && other->length == length && !memcmp(table->text + other->offset, name, (size_t) length))
+            {
+            break;
+            }
+        slot = (slot + 1) & mask;
+        }
+
+    return (int) slot;
+    }
+
+static Error_t ResizeSlots(NameTable* table)
+    {
+    assert(table);
+
+    int  new_capacity = table->slots_capacity * NAME_TABLE_GROW_COEFF;
+    int* new_slots    = (int*) calloc((size_t) new_capacity, sizeof(int));
+    if (!new_slots)
+        {
+        printf("Error: cannot allocate memory for name table\n");
+        return AllocationError;
+        }
+
+    for (int i = 0; i < new_capacity; i++) new_slots[i] = NO_NAME;
+
+    unsigned mask = (unsigned) new_capacity - 1;
+    for (int i = 0; i < table->slots_capacity; i++)
+        {
+        int id = table->slots[i];
+        if (id == NO_NAME) continue;
+
+        unsigned slot = table->names[id].hash & mask;
+        while (new_slots[slot] != NO_NAME) slot = (slot + 1) & mask;
+        new_slots[slot] = id;
+        }
+
+    free(table->slots);
+    table->slots          = new_slots;
+    table->slots_capacity = new_capacity;
+
+    return Ok;
+    }
+
+static int InternName(NameTable* table, const char* name, int length)
+    {
+    assert(table);
+    assert(name);
+
+    if (table->pool_size + length > table->pool_capacity)
+        {
+        int capacity = table->pool_capacity;
+        while (table->pool_size + length > capacity) capacity *= NAME_TABLE_GROW_COEFF;
+
+        char* new_pool = (char*) realloc(table->pool, (size_t) capacity);
+        if (!new_pool)
+            {
+            printf("Error: cannot allocate memory for name pool\n");
+            return NO_NAME;
+            }
+        table->pool          = new_pool;
+        table->text          = new_pool;
+        table->pool_capacity = capacity;
+        }
+
+    int offset = table->pool_size;
+    memcpy(table->pool + offset, name, (size_t) length);
+    table->pool_size += length;
+
+    return offset;
+    }
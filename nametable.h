@@ -0,0 +1,64 @@
+#ifndef NAMETABLE_H
+#define NAMETABLE_H
+
+const int NAME_TABLE_DEFAULT_SIZE   = 64;
+const int NAME_TABLE_DEFAULT_SCOPES = 8;
+const int NAME_TABLE_GROW_COEFF     = 2;
+const int NAME_POOL_DEFAULT_SIZE    = 1024;
+const int NO_NAME                   = -1;
+const int GLOBAL_SCOPE              = -1;
+
+struct Name
+    {
+    int         offset;
+    int         length;
+    unsigned    hash;
+    int         type;
+    int         index;
+    int         shadowed;
+    bool        active;
+    };
+
+struct Scope
+    {
+    int         first_name;
+    int         depth;
+    };
+
+// Открытая адресация: ячейка хранит номер самого внутреннего объявления имени,
+// предыдущие объявления связаны через Name::shadowed. Номера имён не меняются.
+// Name::offset указывает в текст text. Если таблица создана без текста,
+// имена копируются в собственный пул, и text указывает на него. Каждое
+// написание копируется один раз, так что пул не растёт от повторных объявлений.
+struct NameTable
+    {
+    const char* text;
+    char*       pool;
+    int         pool_size;
+    int         pool_capacity;
+
+    Name*       names;
+    int         size;
+    int         capacity;
+
+    int*        slots;
+    int         slots_capacity;
+    int         slots_used;
+
+    Scope*      scopes;
+    int         scope_count;
+    int         scope_capacity;
+    };
+
+Error_t NameTableCtor(NameTable* table, const char* text);
+Error_t NameTableDtor(NameTable* table);
+
+int     NameTableFind(const NameTable* table, const char* name, int length);
+int     NameTableFindLocal(const NameTable* table, const char* name, int length);
+int     NameTableInsert(NameTable* table, const char* name, int length, int type, int index);
+
+Error_t NameTablePushScope(NameTable* table, int depth);
+Error_t NameTablePopScope(NameTable* table);
+int     NameTableScopeDepth(const NameTable* table);
+
+#endif //NAMETABLE_H
@@ -0,0 +1,814 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "errors.h"
+#include "node.h"
+#include "flattree.h"
+#include "treeio.h"
+#include "asmcode.h"
+#include "backend.h"
+#include "native.h"
+
+const int NATIVE_OPERAND_SIZE = 64;
+
+// depth - сколько чисел по 8 байт сейчас лежит на стеке кадра,
+// по нему выравнивается стек перед call
+struct NativeCompiler
+    {
+    const FlatTree* tree;
+    FILE*           fp;
+    int             depth;
+    int             label_count;
+    bool            in_function;
+    };
+
+// Условный переход по результату ucomisd: if_true - когда условие выполнено, if_false - когда нет.
+// swap - сравнивать b с a: так NaN для < и <= попадает в ветку "не выполнено".
+struct NativeCondition
+    {
+    int             code;
+    bool            swap;
+    const char*     if_true;
+    const char*     if_false;
+    };
+
+static const NativeCondition CONDITIONS[] =
+    {
+    {OP_LESS,          true,  "ja",  "jbe"},
+    {OP_LESS_EQUAL,    true,  "jae", "jb"},
+    {OP_GREATER,       false, "ja",  "jbe"},
+    {OP_GREATER_EQUAL, false, "jae", "jb"},
+    {OP_EQUAL,         false, "je",  "jne"},
+    {OP_NOT_EQUAL,     false, "jne", "je"},
+    };
+
+static void    Emit(NativeCompiler* nc, const char* format, ...) __attribute__((format(printf, 2, 3)));
+static void    EmitLabel(NativeCompiler* nc, int label);
+static int     NewLabel(NativeCompiler* nc);
+static void    PushDouble(NativeCompiler* nc, int reg);
+static void    PopDouble(NativeCompiler* nc, int reg);
+static void    Call(NativeCompiler* nc, const char* function);
+static void    Truth(NativeCompiler* nc, int reg);
+static void    AndOne(NativeCompiler* nc, int reg);
+static int     MemorySize(const FlatTree* tree);
+static bool    HasSideEffects(const FlatTree* tree, NodeIndex node);
+static bool    IsConstantPlace(const FlatTree* tree, NodeIndex node);
+static void    WriteRuntime(NativeCompiler* nc);
+static void    WriteData(NativeCompiler* nc);
+
+static Error_t NativeCommand(NativeCompiler* nc, NodeIndex node);
+static Error_t NativeBody(NativeCompiler* nc, NodeIndex node);
+static Error_t NativeEquation(NativeCompiler* nc, NodeIndex node);
+static Error_t NativeOperands(NativeCompiler* nc, NodeIndex node);
+static Error_t NativeOperation(NativeCompiler* nc, NodeIndex node);
+static Error_t NativePlace(NativeCompiler* nc, NodeIndex node, char* operand);
+static Error_t NativeStore(NativeCompiler* nc, NodeIndex place);
+static Error_t NativeAssigment(NativeCompiler* nc, NodeIndex node);
+static Error_t NativeCall(NativeCompiler* nc, NodeIndex node);
+static Error_t NativeJump(NativeCompiler* nc, NodeIndex condition, bool when, int label);
+static Error_t NativeWhile(NativeCompiler* nc, NodeIndex node);
+static Error_t NativeIf(NativeCompiler* nc, NodeIndex node, int end);
+static Error_t NativeDefineFunction(NativeCompiler* nc, NodeIndex node);
+static Error_t NativeDefineArray(NativeCompiler* nc, NodeIndex node);
+
+Error_t WriteNativeCode(const FlatTree* tree, FILE* fp)
+    {
+    assert(tree);
+    assert(fp);
+
+    NativeCompiler nc = {tree, fp, 0, 0, false};
+
+    fprintf(fp, "\t.text\n\t.globl main\n\t.type main, @function\nmain:\n");
+    Emit(&nc, "push %%rbp");
+    Emit(&nc, "mov %%rsp, %%rbp");
+
+    Error_t state = Ok;
+    for (NodeIndex command = tree->root; command != NIL_NODE && state == Ok; command = tree->right[command])
+        {
+        if (NativeCommand(&nc, tree->left[command]) != Ok)
+            {
+            printf("Syntax error in program\n");
+            state = SyntaxError;
+            }
+        }
+
+    fprintf(fp, ".Lmain_end:\n");
+    Emit(&nc, "xor %%eax, %%eax");
+    Emit(&nc, "leave");
+    Emit(&nc, "ret");
+
+    WriteRuntime(&nc);
+    WriteData(&nc);
+
+    if (state == Ok && ferror(fp)) state = FileError;
+
+    return state;
+    }
+
+static Error_t NativeCommand(NativeCompiler* nc, NodeIndex node)
+    {
+    const FlatTree* tree = nc->tree;
+
+    if (FlatType(tree, node) == OPERATION)
+        switch (FlatCode(tree, node))
+            {
+            case OP_ASSIGMENT:
+            case OP_ADD_ASSIGMENT:
+            case OP_SUB_ASSIGMENT:
+            case OP_MUL_ASSIGMENT:
+            case OP_DIV_ASSIGMENT:
+            case OP_POW_ASSIGMENT:
+            case OP_DEFINE_VARIABLE:
+                {
+                return NativeAssigment(nc, node);
+                }
+            case OP_WHILE:
+                {
+                return NativeWhile(nc, node);
+                }
+            case OP_IF: case OP_ELSE:
+                {
+                int     end   = NewLabel(nc);
+                Error_t state = NativeIf(nc, node, end);
+                EmitLabel(nc, end);
+                return state;
+                }
+            case OP_NEXT_COMMAND:
+                {
+                return NativeBody(nc, node);
+                }
+            case OP_DEFINE_FUNCTION:
+                {
+                return NativeDefineFunction(nc, node);
+                }
+            case OP_DEFINE_ARRAY:
+                {
+                return NativeDefineArray(nc, node);
+                }
+            default:
+                {
+                break;
+                }
+            }
+
+    return NativeEquation(nc, node);
+    }
+
+static Error_t NativeBody(NativeCompiler* nc, NodeIndex node)
+    {
+    for (; node != NIL_NODE; node = nc->tree->right[node])
+        {
+        if (NativeCommand(nc, nc->tree->left[node]) != Ok)
+            {
+            printf("Syntax error in program body\n");
+            return SyntaxError;
+            }
+        }
+
+    return Ok;
+    }
+
+// Значение выражения - в xmm0
+static Error_t NativeEquation(NativeCompiler* nc, NodeIndex node)
+    {
+    const FlatTree* tree = nc->tree;
+    if (node == NIL_NODE)
+        {
+        printf("Syntax error: missing expression\n");
+        return SyntaxError;
+        }
+
+    switch (FlatType(tree, node))
+        {
+        case VALUE:
+            {
+            Emit(nc, "movsd .LC%d(%%rip), %%xmm0", FlatId(tree, node));
+            return Ok;
+            }
+        case VARIABLE:
+        case ARRAY:
+            {
+            char operand[NATIVE_OPERAND_SIZE] = "";
+            if (NativePlace(nc, node, operand) != Ok) return SyntaxError;
+            Emit(nc, "movsd %s, %%xmm0", operand);
+            return Ok;
+            }
+        case FUNCTION:
+            {
+            return NativeCall(nc, node);
+            }
+        case OPERATION:
+            {
+            return NativeOperation(nc, node);
+            }
+        default:
+            {
+            printf("Syntax error: wrong argument type\n");
+            return SyntaxError;
+            }
+        }
+    }
+
+// Левый операнд в xmm0, правый в xmm1. Число или ячейку справа можно
+// прочитать сразу, остальное вычисляется с левым операндом на стеке.
+static Error_t NativeOperands(NativeCompiler* nc, NodeIndex node)
+    {
+    const FlatTree* tree  = nc->tree;
+    NodeIndex       right = tree->right[node];
+
+    if (NativeEquation(nc, tree->left[node]) != Ok) return SyntaxError;
+
+    if (right != NIL_NODE && FlatType(tree, right) == VALUE)
+        {
+        Emit(nc, "movsd .LC%d(%%rip), %%xmm1", FlatId(tree, right));
+        return Ok;
+        }
+    if (right != NIL_NODE && IsConstantPlace(tree, right))
+        {
+        char operand[NATIVE_OPERAND_SIZE] = "";
+        NativePlace(nc, right, operand);
+        Emit(nc, "movsd %s, %%xmm1", operand);
+        return Ok;
+        }
+
+    PushDouble(nc, 0);
+    if (NativeEquation(nc, right) != Ok) return SyntaxError;
+    Emit(nc, "movapd %%xmm0, %%xmm1");
+    PopDouble(nc, 0);
+
+    return Ok;
+    }
+
+static Error_t NativeOperation(NativeCompiler* nc, NodeIndex node)
+    {
+    const FlatTree* tree  = nc->tree;
+    NodeIndex       right = tree->right[node];
+    int             code  = FlatCode(tree, node);
+
+    switch (code)
+        {
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV:
+            {
+            static const char* const ARITHMETIC[] = {"addsd", "subsd", "mulsd", "divsd"};
+            if (NativeOperands(nc, node) != Ok) return SyntaxError;
+            Emit(nc, "%s %%xmm1, %%xmm0", ARITHMETIC[code - OP_ADD]);
+            return Ok;
+            }
+        case OP_POW:
+            {
+            if (NativeOperands(nc, node) != Ok) return SyntaxError;
+            Call(nc, "pow@PLT");
+            return Ok;
+            }
+        // Сравнение даёт маску из единиц, and с 1.0 превращает её в 1 или 0
+        case OP_LESS: case OP_LESS_EQUAL:
+            {
+            if (NativeOperands(nc, node) != Ok) return SyntaxError;
+            Emit(nc, "%s %%xmm1, %%xmm0", code == OP_LESS ? "cmpltsd" : "cmplesd");
+            AndOne(nc, 0);
+            return Ok;
+            }
+        case OP_GREATER: case OP_GREATER_EQUAL:
+            {
+            if (NativeOperands(nc, node) != Ok) return SyntaxError;
+            Emit(nc, "%s %%xmm0, %%xmm1", code == OP_GREATER ? "cmpltsd" : "cmplesd");
+            AndOne(nc, 1);
+            Emit(nc, "movapd %%xmm1, %%xmm0");
+            return Ok;
+            }
+        // a == b - это !(a < b || a > b), как у стековой машины
+        case OP_EQUAL: case OP_NOT_EQUAL:
+            {
+            if (NativeOperands(nc, node) != Ok) return SyntaxError;
+            Emit(nc, "movapd %%xmm0, %%xmm2");
+            Emit(nc, "cmpltsd %%xmm1, %%xmm2");
+            Emit(nc, "cmpltsd %%xmm0, %%xmm1");
+            Emit(nc, "orpd %%xmm2, %%xmm1");
+            Emit(nc, "movsd .Lone(%%rip), %%xmm0");
+            Emit(nc, "%s %%xmm0, %%xmm1", code == OP_EQUAL ? "andnpd" : "andpd");
+            Emit(nc, "movapd %%xmm1, %%xmm0");
+            return Ok;
+            }
+        case OP_AND: case OP_OR:
+            {
+            if (NativeOperands(nc, node) != Ok) return SyntaxError;
+            Truth(nc, 0);
+            Truth(nc, 1);
+            Emit(nc, "%s %%xmm1, %%xmm0", code == OP_AND ? "andpd" : "orpd");
+            AndOne(nc, 0);
+            return Ok;
+            }
+        case OP_NOT:
+            {
+            if (NativeEquation(nc, right) != Ok) return SyntaxError;
+            Truth(nc, 0);
+            Emit(nc, "movsd .Lone(%%rip), %%xmm2");
+            Emit(nc, "andnpd %%xmm2, %%xmm0");
+            return Ok;
+            }
+        case OP_SQRT:
+            {
+            if (NativeEquation(nc, right) != Ok) return SyntaxError;
+            Emit(nc, "sqrtsd %%xmm0, %%xmm0");
+            return Ok;
+            }
+        case OP_SIN: case OP_COS:
+            {
+            if (NativeEquation(nc, right) != Ok) return SyntaxError;
+            Call(nc, code == OP_SIN ? "sin@PLT" : "cos@PLT");
+            return Ok;
+            }
+        case OP_OUTPUT:
+            {
+            if (NativeEquation(nc, right) != Ok) return SyntaxError;
+            Call(nc, "rami_out");
+            return Ok;
+            }
+        case OP_INPUT:
+            {
+            if (right == NIL_NODE || (FlatType(tree, right) != VARIABLE && FlatType(tree, right) != ARRAY))
+                {
+                printf("Syntax error: input type is not variable\n");
+                return SyntaxError;
+                }
+            Call(nc, "rami_in");
+            return NativeStore(nc, right);
+            }
+        case OP_INCREMENT: case OP_DECREMENT:
+            {
+            char operand[NATIVE_OPERAND_SIZE] = "";
+            if (right == NIL_NODE || NativePlace(nc, right, operand) != Ok) return SyntaxError;
+            Emit(nc, "movsd %s, %%xmm0", operand);
+            Emit(nc, "%s .Lone(%%rip), %%xmm0", code == OP_INCREMENT ? "addsd" : "subsd");
+            Emit(nc, "movsd %%xmm0, %s", operand);
+            return Ok;
+            }
+        // ҡайтар в самой программе завершает её, как ret на пустом стеке вызовов
+        case OP_RETURN:
+            {
+            if (right != NIL_NODE) { if (NativeEquation(nc, right) != Ok) return SyntaxError; }
+            else                   Emit(nc, "xorpd %%xmm0, %%xmm0");
+
+            if (nc->in_function)
+                {
+                Emit(nc, "leave");
+                Emit(nc, "ret");
+                }
+            else
+                {
+                Emit(nc, "jmp .Lmain_end");
+                }
+            return Ok;
+            }
+        default:
+            {
+            printf("Syntax error: wrong operation %d %d\n", FlatType(tree, node), code);
+            return SyntaxError;
+            }
+        }
+    }
+
+// Операнд ячейки для movsd. Элемент массива с вычисляемым индексом адресуется
+// через rcx и rax, операнд годен только до следующего вычисления.
+static Error_t NativePlace(NativeCompiler* nc, NodeIndex node, char* operand)
+    {
+    const FlatTree* tree = nc->tree;
+
+    if (FlatType(tree, node) == VARIABLE)
+        {
+        snprintf(operand, NATIVE_OPERAND_SIZE, "rami_memory+%d(%%rip)", FlatId(tree, node) * 8);
+        return Ok;
+        }
+    if (FlatType(tree, node) != ARRAY)
+        {
+        printf("Syntax error: assigment to not variable\n");
+        return SyntaxError;
+        }
+
+    int       base  = FlatId(tree, node) * ARRAY_MAX_SIZE + ARRAY_SEGMENT;
+    NodeIndex index = tree->right[node];
+    if (IsConstantPlace(tree, node))
+        {
+        int shift = index != NIL_NODE ? (int) FlatValue(tree, index) : 0;
+        snprintf(operand, NATIVE_OPERAND_SIZE, "rami_memory+%d(%%rip)", (base + shift) * 8);
+        return Ok;
+        }
+
+    // Отрицательный индекс (и NaN) отсекается до усечения: -0.5 превратился бы в 0
+    if (NativeEquation(nc, index) != Ok) return SyntaxError;
+    Emit(nc, "xorpd %%xmm1, %%xmm1");
+    Emit(nc, "ucomisd %%xmm1, %%xmm0");
+    Emit(nc, "jb rami_index_error");
+    Emit(nc, "cvttsd2si %%xmm0, %%rax");
+    Emit(nc, "cmp $%d, %%rax", ARRAY_MAX_SIZE);
+    Emit(nc, "jae rami_index_error");
+    Emit(nc, "lea rami_memory+%d(%%rip), %%rcx", base * 8);
+    snprintf(operand, NATIVE_OPERAND_SIZE, "(%%rcx,%%rax,8)");
+
+    return Ok;
+    }
+
+// Запись xmm0 в ячейку, значение остаётся в xmm0
+static Error_t NativeStore(NativeCompiler* nc, NodeIndex place)
+    {
+    char operand[NATIVE_OPERAND_SIZE] = "";
+
+    if (IsConstantPlace(nc->tree, place))
+        {
+        if (NativePlace(nc, place, operand) != Ok) return SyntaxError;
+        Emit(nc, "movsd %%xmm0, %s", operand);
+        return Ok;
+        }
+
+    PushDouble(nc, 0);
+    if (NativePlace(nc, place, operand) != Ok) return SyntaxError;
+    PopDouble(nc, 0);
+    Emit(nc, "movsd %%xmm0, %s", operand);
+
+    return Ok;
+    }
+
+// Составное присваивание читает старое значение до правой части, если та
+// может его поменять; иначе проще прочитать его после
+static Error_t NativeAssigment(NativeCompiler* nc, NodeIndex node)
+    {
+    static const char* const OPERATIONS[] = {"addsd", "subsd", "mulsd", "divsd"};
+
+    const FlatTree* tree = nc->tree;
+    NodeIndex       dest = tree->left[node];
+    int             code = FlatCode(tree, node);
+
+    if (dest == NIL_NODE)
+        {
+        printf("Syntax error: assigment to not variable\n");
+        return SyntaxError;
+        }
+    if (code == OP_ASSIGMENT || code == OP_DEFINE_VARIABLE)
+        {
+        if (NativeEquation(nc, tree->right[node]) != Ok) return SyntaxError;
+        return NativeStore(nc, dest);
+        }
+
+    char operand[NATIVE_OPERAND_SIZE] = "";
+    bool direct = IsConstantPlace(tree, dest) && !HasSideEffects(tree, tree->right[node]);
+
+    if (direct)
+        {
+        if (NativeEquation(nc, tree->right[node]) != Ok) return SyntaxError;
+        Emit(nc, "movapd %%xmm0, %%xmm1");
+        NativePlace(nc, dest, operand);
+        Emit(nc, "movsd %s, %%xmm0", operand);
+        }
+    else
+        {
+        if (NativePlace(nc, dest, operand) != Ok) return SyntaxError;
+        Emit(nc, "lea %s, %%rax", operand);
+        Emit(nc, "push %%rax");
+        nc->depth++;
+        Emit(nc, "movsd (%%rax), %%xmm0");
+        PushDouble(nc, 0);
+        if (NativeEquation(nc, tree->right[node]) != Ok) return SyntaxError;
+        Emit(nc, "movapd %%xmm0, %%xmm1");
+        PopDouble(nc, 0);
+        Emit(nc, "pop %%rax");
+        nc->depth--;
+        snprintf(operand, NATIVE_OPERAND_SIZE, "(%%rax)");
+        }
+
+    if (code == OP_POW_ASSIGMENT)
+        {
+        if (!direct)
+            {
+            Emit(nc, "push %%rax");
+            nc->depth++;
+            }
+        Call(nc, "pow@PLT");
+        if (!direct)
+            {
+            Emit(nc, "pop %%rax");
+            nc->depth--;
+            }
+        }
+    else
+        {
+        Emit(nc, "%s %%xmm1, %%xmm0", OPERATIONS[code - OP_ADD_ASSIGMENT]);
+        }
+    Emit(nc, "movsd %%xmm0, %s", operand);
+
+    return Ok;
+    }
+
+// Аргументы считаются по очереди на стек и только потом раскладываются по xmm
+static Error_t NativeCall(NativeCompiler* nc, NodeIndex node)
+    {
+    const FlatTree* tree  = nc->tree;
+    int             count = 0;
+
+    for (NodeIndex parametr = tree->right[node]; parametr != NIL_NODE; parametr = tree->right[parametr], count++)
+        {
+        if (count == NATIVE_MAX_PARAMETRS)
+            {
+            printf("Syntax error: too many arguments of function %d\n", FlatId(tree, node));
+            return SyntaxError;
+            }
+        if (NativeEquation(nc, tree->left[parametr]) != Ok) return SyntaxError;
+        PushDouble(nc, 0);
+        }
+
+    for (int reg = count - 1; reg >= 0; reg--) PopDouble(nc, reg);
+
+    char function[NATIVE_OPERAND_SIZE] = "";
+    snprintf(function, NATIVE_OPERAND_SIZE, "rami_function_%d", FlatId(tree, node));
+    Call(nc, function);
+
+    return Ok;
+    }
+
+// Переход на label, если истинность условия равна when. Сравнения сразу
+// дают флаги, остальное сравнивается с нулём как у стековой машины.
+static Error_t NativeJump(NativeCompiler* nc, NodeIndex condition, bool when, int label)
+    {
+    const FlatTree* tree = nc->tree;
+
+    if (condition != NIL_NODE && FlatType(tree, condition) == OPERATION)
+        {
+        for (size_t i = 0; i < sizeof(CONDITIONS) / sizeof(NativeCondition); i++)
+            {
+            if (CONDITIONS[i].code != FlatCode(tree, condition)) continue;
+
+            if (NativeOperands(nc, condition) != Ok) return SyntaxError;
+            if (CONDITIONS[i].swap) Emit(nc, "ucomisd %%xmm0, %%xmm1");
+            else                    Emit(nc, "ucomisd %%xmm1, %%xmm0");
+            Emit(nc, "%s .L%d", when ? CONDITIONS[i].if_true : CONDITIONS[i].if_false, label);
+            return Ok;
+            }
+        }
+
+    if (NativeEquation(nc, condition) != Ok) return SyntaxError;
+    Emit(nc, "xorpd %%xmm1, %%xmm1");
+    Emit(nc, "ucomisd %%xmm1, %%xmm0");
+    Emit(nc, "%s .L%d", when ? "jne" : "je", label);
+
+    return Ok;
+    }
+
+static Error_t NativeWhile(NativeCompiler* nc, NodeIndex node)
+    {
+    int start = NewLabel(nc);
+    int end   = NewLabel(nc);
+
+    EmitLabel(nc, start);
+    if (NativeJump(nc, nc->tree->left[node], false, end) != Ok) return SyntaxError;
+    Error_t state = NativeBody(nc, nc->tree->right[node]);
+    Emit(nc, "jmp .L%d", start);
+    EmitLabel(nc, end);
+
+    return state;
+    }
+
+// Разбор цепочки тимәк такой же, как в WriteIf
+static Error_t NativeIf(NativeCompiler* nc, NodeIndex node, int end)
+    {
+    const FlatTree* tree = nc->tree;
+
+    if (IsFlatOperation(tree, node, OP_IF))
+        {
+        if (NativeJump(nc, tree->left[node], false, end) != Ok) return SyntaxError;
+        return NativeBody(nc, tree->right[node]);
+        }
+    if (IsFlatOperation(tree, node, OP_ELSE))
+        {
+        NodeIndex if_node = tree->left[node];
+        int       branch  = NewLabel(nc);
+
+        if (NativeJump(nc, tree->left[if_node], true, branch) != Ok) return SyntaxError;
+        if (NativeIf(nc, tree->right[node], end) != Ok) return SyntaxError;
+        Emit(nc, "jmp .L%d", end);
+        EmitLabel(nc, branch);
+        return NativeBody(nc, tree->right[if_node]);
+        }
+
+    return NativeBody(nc, node);
+    }
+
+// Тело функции пишется на месте определения, программа его перепрыгивает
+static Error_t NativeDefineFunction(NativeCompiler* nc, NodeIndex node)
+    {
+    const FlatTree* tree     = nc->tree;
+    NodeIndex       function = tree->left[node];
+    int             guard    = NewLabel(nc);
+
+    Emit(nc, "jmp .L%d", guard);
+    fprintf(nc->fp, "rami_function_%d:\n", FlatId(tree, function));
+    Emit(nc, "push %%rbp");
+    Emit(nc, "mov %%rsp, %%rbp");
+
+    int reg = 0;
+    for (NodeIndex parametr = tree->right[function]; parametr != NIL_NODE; parametr = tree->right[parametr], reg++)
+        {
+        if (reg == NATIVE_MAX_PARAMETRS)
+            {
+            printf("Syntax error: too many parametrs of function %d\n", FlatId(tree, function));
+            return SyntaxError;
+            }
+        Emit(nc, "movsd %%xmm%d, rami_memory+%d(%%rip)", reg, FlatId(tree, tree->left[tree->left[parametr]]) * 8);
+        }
+
+    int  depth       = nc->depth;
+    bool in_function = nc->in_function;
+    nc->depth       = 0;
+    nc->in_function = true;
+
+    Error_t state = NativeBody(nc, tree->right[node]);
+    Emit(nc, "xorpd %%xmm0, %%xmm0");
+    Emit(nc, "leave");
+    Emit(nc, "ret");
+
+    nc->depth       = depth;
+    nc->in_function = in_function;
+
+    EmitLabel(nc, guard);
+
+    return state;
+    }
+
+static Error_t NativeDefineArray(NativeCompiler* nc, NodeIndex node)
+    {
+    const FlatTree* tree     = nc->tree;
+    NodeIndex       array    = tree->left[node];
+    NodeIndex       size     = tree->right[array];
+    NodeIndex       parametr = tree->right[node];
+    int             base     = FlatId(tree, array) * ARRAY_MAX_SIZE + ARRAY_SEGMENT;
+
+    for (int number = 0; parametr != NIL_NODE && number < FlatValue(tree, size) && number < ARRAY_MAX_SIZE; number++)
+        {
+        if (NativeEquation(nc, tree->left[parametr]) != Ok) return SyntaxError;
+        Emit(nc, "movsd %%xmm0, rami_memory+%d(%%rip)", (base + number) * 8);
+
+        parametr = tree->right[parametr];
+        }
+
+    return Ok;
+    }
+
+// rami_out печатает xmm0 и оставляет его, rami_in читает число в xmm0.
+// При ошибке программа завершается с кодом 1.
+static void WriteRuntime(NativeCompiler* nc)
+    {
+    fprintf(nc->fp, "rami_out:\n");
+    Emit(nc, "sub $24, %%rsp");
+    Emit(nc, "movsd %%xmm0, (%%rsp)");
+    Emit(nc, "lea .Lformat_out(%%rip), %%rdi");
+    Emit(nc, "mov $1, %%eax");
+    Emit(nc, "call printf@PLT");
+    Emit(nc, "movsd (%%rsp), %%xmm0");
+    Emit(nc, "add $24, %%rsp");
+    Emit(nc, "ret");
+
+    fprintf(nc->fp, "rami_in:\n");
+    Emit(nc, "sub $24, %%rsp");
+    Emit(nc, "lea .Lformat_in(%%rip), %%rdi");
+    Emit(nc, "mov %%rsp, %%rsi");
+    Emit(nc, "xor %%eax, %%eax");
+    Emit(nc, "call scanf@PLT");
+    Emit(nc, "cmp $1, %%eax");
+    Emit(nc, "jne rami_input_error");
+    Emit(nc, "movsd (%%rsp), %%xmm0");
+    Emit(nc, "add $24, %%rsp");
+    Emit(nc, "ret");
+
+    fprintf(nc->fp, "rami_input_error:\n");
+    Emit(nc, "lea .Lmessage_input(%%rip), %%rdi");
+    Emit(nc, "jmp rami_error");
+    fprintf(nc->fp, "rami_index_error:\n");
+    Emit(nc, "lea .Lmessage_index(%%rip), %%rdi");
+    fprintf(nc->fp, "rami_error:\n");
+    Emit(nc, "and $-16, %%rsp");
+    Emit(nc, "call puts@PLT");
+    Emit(nc, "mov $1, %%edi");
+    Emit(nc, "call exit@PLT");
+    }
+
+// Константы дерева идут как есть по номерам .LCn, память - одним блоком в .bss
+static void WriteData(NativeCompiler* nc)
+    {
+    const FlatTree* tree = nc->tree;
+    FILE*           fp   = nc->fp;
+
+    fprintf(fp, "\t.section .rodata\n\t.align 8\n");
+    fprintf(fp, ".Lone:\n\t.double 1\n");
+    for (int value = 0; value < tree->value_count; value++)
+        {
+        unsigned long long bits = 0;
+        memcpy(&bits, tree->values + value, sizeof(bits));
+        fprintf(fp, ".LC%d:\n\t.quad %#llx\n", value, bits);
+        }
+    fprintf(fp, ".Lformat_out:\n\t.string \"%%lg\\n\"\n");
+    fprintf(fp, ".Lformat_in:\n\t.string \"%%lf\"\n");
+    fprintf(fp, ".Lmessage_input:\n\t.string \"Error: cannot read a number\"\n");
+    fprintf(fp, ".Lmessage_index:\n\t.string \"Error: array index out of range\"\n");
+
+    fprintf(fp, "\t.bss\n\t.align 16\nrami_memory:\n\t.zero %d\n", MemorySize(tree) * 8);
+    fprintf(fp, "\t.section .note.GNU-stack,\"\",@progbits\n");
+    }
+
+static void Emit(NativeCompiler* nc, const char* format, ...)
+    {
+    va_list args;
+    va_start(args, format);
+
+    fputc('\t', nc->fp);
+    vfprintf(nc->fp, format, args);
+    fputc('\n', nc->fp);
+
+    va_end(args);
+    }
+
+static void EmitLabel(NativeCompiler* nc, int label)
+    {
+    fprintf(nc->fp, ".L%d:\n", label);
+    }
+
+static int NewLabel(NativeCompiler* nc)
+    {
+    return nc->label_count++;
+    }
+
+static void PushDouble(NativeCompiler* nc, int reg)
+    {
+    Emit(nc, "sub $8, %%rsp");
+    Emit(nc, "movsd %%xmm%d, (%%rsp)", reg);
+    nc->depth++;
+    }
+
+static void PopDouble(NativeCompiler* nc, int reg)
+    {
+    Emit(nc, "movsd (%%rsp), %%xmm%d", reg);
+    Emit(nc, "add $8, %%rsp");
+    nc->depth--;
+    }
+
+// После push %rbp стек выровнен на 16, пока на нём чётное число временных чисел
+static void Call(NativeCompiler* nc, const char* function)
+    {
+    if (nc->depth % 2) Emit(nc, "sub $8, %%rsp");
+    Emit(nc, "call %s", function);
+    if (nc->depth % 2) Emit(nc, "add $8, %%rsp");
+    }
+
+// Маска истинности x < 0 || 0 < x на месте числа, портит xmm2 и xmm3
+static void Truth(NativeCompiler* nc, int reg)
+    {
+    Emit(nc, "movapd %%xmm%d, %%xmm2", reg);
+    Emit(nc, "xorpd %%xmm3, %%xmm3");
+    Emit(nc, "cmpltsd %%xmm3, %%xmm2");
+    Emit(nc, "cmpltsd %%xmm%d, %%xmm3", reg);
+    Emit(nc, "orpd %%xmm3, %%xmm2");
+    Emit(nc, "movapd %%xmm2, %%xmm%d", reg);
+    }
+
+static void AndOne(NativeCompiler* nc, int reg)
+    {
+    Emit(nc, "movsd .Lone(%%rip), %%xmm2");
+    Emit(nc, "andpd %%xmm2, %%xmm%d", reg);
+    }
+
+static int MemorySize(const FlatTree* tree)
+    {
+    int size = 1;
+    for (int node = 1; node < tree->size; node++)
+        {
+        int end = 0;
+        if (FlatType(tree, (NodeIndex) node) == VARIABLE) end = FlatId(tree, (NodeIndex) node) + 1;
+        if (FlatType(tree, (NodeIndex) node) == ARRAY)    end = (FlatId(tree, (NodeIndex) node) + 1) * ARRAY_MAX_SIZE + ARRAY_SEGMENT;
+        if (end > size) size = end;
+        }
+
+    return size;
+    }
+
+static bool HasSideEffects(const FlatTree* tree, NodeIndex node)
+    {
+    if (node == NIL_NODE) return false;
+    if (FlatType(tree, node) == FUNCTION) return true;
+    if (IsFlatOperation(tree, node, OP_INPUT) ||
+        IsFlatOperation(tree, node, OP_INCREMENT) ||
+        IsFlatOperation(tree, node, OP_DECREMENT)) return true;
+
+    return HasSideEffects(tree, tree->left[node]) || HasSideEffects(tree, tree->right[node]);
+    }
+
+static bool IsConstantPlace(const FlatTree* tree, NodeIndex node)
+    {
+    if (FlatType(tree, node) == VARIABLE) return true;
+    if (FlatType(tree, node) != ARRAY)    return false;
+
+    NodeIndex index = tree->right[node];
+    if (index == NIL_NODE) return true;
+    if (FlatType(tree, index) != VALUE) return false;
+
+    double shift = FlatValue(tree, index);
+    return 0 <= shift && shift < ARRAY_MAX_SIZE;
+    }
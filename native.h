@@ -0,0 +1,12 @@
+#ifndef NATIVE_H
+#define NATIVE_H
+
+const int NATIVE_MAX_PARAMETRS = 8;
+
+// Ассемблер GNU as (AT&T) для x86-64. Переменные и массивы лежат в .bss с той же
+// раскладкой ячеек, что у стековой машины, числа - double в SSE2, функции вызываются
+// по SysV ABI: параметры в xmm0..xmm7, результат в xmm0. Ввод и вывод - маленький
+// рантайм поверх printf/scanf в том же файле, сборка: gcc output.s -o program -lm
+Error_t WriteNativeCode(const FlatTree* tree, FILE* fp);
+
+#endif //NATIVE_H
@@ -4,9 +4,39 @@
 #include "errors.h"
 #include "node.h"
 
-Error_t NewNode(Node** node, const int type, const Data_t data)
+static Node* ChunkNodes(NodeChunk* chunk);
+static Node* AllocNode(NodeArena* arena);
+
+Error_t NodeArenaCtor(NodeArena* arena)
     {
-    assert(node != NULL);
+    assert(arena != NULL);
+
+    arena->chunks    = nullptr;
+    arena->free_list = nullptr;
+
+    return Ok;
+    }
+
+Error_t NodeArenaDtor(NodeArena* arena)
+    {
+    assert(arena != NULL);
+
+    while (arena->chunks)
+        {
+        NodeChunk* prev = arena->chunks->prev;
+        free(arena->chunks);
+        arena->chunks = prev;
+        }
+
+    arena->free_list = nullptr;
+
+    return Ok;
+    }
+
+Error_t NewNode(Node** node, const int type, const Data_t data, NodeArena* arena)
+    {
+    assert(node  != NULL);
+    assert(arena != NULL);
 
     if (*node)
         {
@@ -14,14 +44,15 @@ Error_t NewNode(Node** node, const int type, const Data_t data)
         return NodeExist;
         }
 
-    Node* new_node = (Node*) calloc(1, sizeof(Node));
+    Node* new_node = AllocNode(arena);
     if (!new_node)
         {
         printf("Error: cannot allocate memory for new node\n");
         return AllocationError;
         }
 
-    new_node->type   = type;
+    new_node->type      = type;
+    new_node->data.val  = 0;
 
     switch (type)
         {
@@ -41,18 +72,68 @@ Error_t NewNode(Node** node, const int type, const Data_t data)
     return Ok;
     }
 
+// Поворотами вправо разворачивает поддерево в цепочку и отдаёт узлы
+// в список свободных: без рекурсии и без дополнительной памяти.
+Error_t DeleteNode(Node* node, NodeArena* arena)
+    {
+    assert(node  != NULL);
+    assert(arena != NULL);
 
-Error_t DeleteNode(Node* node)
+    while (node)
+        {
+        if (node->left)
+            {
+            Node* left  = node->left;
+            node->left  = left->right;
+            left->right = node;
+            node        = left;
+            continue;
+            }
+
+        Node* right = node->right;
+
+        node->data.val   = 0;
+        node->right      = arena->free_list;
+        arena->free_list = node;
+
+        node = right;
+        }
+
+    return Ok;
+    }
+
+static Node* ChunkNodes(NodeChunk* chunk)
+    {
+    return (Node*) (chunk + 1);
+    }
+
+static Node* AllocNode(NodeArena* arena)
     {
-    assert(node != NULL);
+    assert(arena != NULL);
+
+    if (arena->free_list)
+        {
+        Node* node = arena->free_list;
+        arena->free_list = node->right;
+        return node;
+        }
 
-    if (node->left)  DeleteNode(node->left);
-    if (node->right) DeleteNode(node->right);
+    NodeChunk* chunk = arena->chunks;
+    if (!chunk || chunk->size == chunk->capacity)
+        {
+        int capacity = chunk ? chunk->capacity * 2 : NODE_CHUNK_MIN_SIZE;
+        if (capacity > NODE_CHUNK_MAX_SIZE) capacity = NODE_CHUNK_MAX_SIZE;
 
-    node->data.val = 0;
-    free(node);
+        chunk = (NodeChunk*) malloc(sizeof(NodeChunk) + (size_t) capacity * sizeof(Node));
+        if (!chunk) return nullptr;
 
-    return Ok;
+        chunk->prev     = arena->chunks;
+        chunk->size     = 0;
+        chunk->capacity = capacity;
+        arena->chunks   = chunk;
+        }
+
+    return ChunkNodes(chunk) + chunk->size++;
     }
 
 Error_t EditNode(Node* node, const int type, const Data_t data)
@@ -87,8 +87,29 @@ struct Node
     Node*  right;
     };
 
-Error_t NewNode(Node** node, const int type, const Data_t data);
+const int NODE_CHUNK_MIN_SIZE = 256;
+const int NODE_CHUNK_MAX_SIZE = 1 << 16;
+
+struct NodeChunk
+    {
+    NodeChunk*  prev;
+    int         size;
+    int         capacity;
+    };
+
+// Узлы выделяются сдвигом указателя внутри блоков, удалённые узлы
+// возвращаются в список свободных (связаны через right).
+struct NodeArena
+    {
+    NodeChunk*  chunks;
+    Node*       free_list;
+    };
+
+Error_t NodeArenaCtor(NodeArena* arena);
+Error_t NodeArenaDtor(NodeArena* arena);
+
+Error_t NewNode(Node** node, const int type, const Data_t data, NodeArena* arena);
 Error_t EditNode(Node* node, const int type, const Data_t data);
-Error_t DeleteNode(Node* node);
+Error_t DeleteNode(Node* node, NodeArena* arena);
 
 #endif //NODE_H
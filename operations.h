@@ -1,142 +1,118 @@
-#define WriteBothNodes()    WriteEquation(node->left, fp); \
-                            WriteEquation(node->right, fp);
+#define WriteBothNodes()    WriteEquation(tree, tree->left[node], code); \
+                            WriteEquation(tree, tree->right[node], code);
 
 DEFINE_OPERATION (OP_GREATER,       {
                                     WriteBothNodes()
-                                    fprintf(fp, "gt\n");
+                                    AsmEmit(code, ASM_GT);
                                     })
 
 DEFINE_OPERATION (OP_LESS,          {
                                     WriteBothNodes()
-                                    fprintf(fp, "lt\n");
+                                    AsmEmit(code, ASM_LT);
                                     })
 
 DEFINE_OPERATION (OP_GREATER_EQUAL, {
                                     WriteBothNodes()
-                                    fprintf(fp, "ge\n");
+                                    AsmEmit(code, ASM_GE);
                                     })
 
 DEFINE_OPERATION (OP_LESS_EQUAL,    {
                                     WriteBothNodes()
-                                    fprintf(fp, "le\n");
+                                    AsmEmit(code, ASM_LE);
                                     })
 
 DEFINE_OPERATION (OP_EQUAL,         {
                                     WriteBothNodes()
-                                    fprintf(fp, "eq\n");
+                                    AsmEmit(code, ASM_EQ);
                                     })
 
 DEFINE_OPERATION (OP_NOT_EQUAL,     {
                                     WriteBothNodes()
-                                    fprintf(fp, "ne\n");
+                                    AsmEmit(code, ASM_NE);
                                     })
 
 DEFINE_OPERATION (OP_ADD,           {
                                     WriteBothNodes()
-                                    fprintf(fp, "add\n");
+                                    AsmEmit(code, ASM_ADD);
                                     })
 
 DEFINE_OPERATION (OP_SUB,           {
                                     WriteBothNodes()
-                                    fprintf(fp, "sub\n");
+                                    AsmEmit(code, ASM_SUB);
                                     })
 
 DEFINE_OPERATION (OP_INCREMENT,     {
-                                    fprintf(fp, "push [%d]\n", node->right->data.id);
-                                    fprintf(fp, "push 1\n");
-                                    fprintf(fp, "add\n");
-                                    fprintf(fp, "pop [%d]\n", node->right->data.id);
-                                    fprintf(fp, "push [%d]\n", node->right->data.id);
+                                    if (WriteStep(tree, tree->right[node], code, ASM_ADD) != Ok) return SyntaxError;
                                     })
 
 DEFINE_OPERATION (OP_DECREMENT,     {
-                                    fprintf(fp, "push [%d]\n", node->right->data.id);
-                                    fprintf(fp, "push 1\n");
-                                    fprintf(fp, "sub\n");
-                                    fprintf(fp, "pop [%d]\n", node->right->data.id);
-                                    fprintf(fp, "push [%d]\n", node->right->data.id);
+                                    if (WriteStep(tree, tree->right[node], code, ASM_SUB) != Ok) return SyntaxError;
                                     })
 
 DEFINE_OPERATION (OP_MUL,           {
                                     WriteBothNodes()
-                                    fprintf(fp, "mul\n");
+                                    AsmEmit(code, ASM_MUL);
                                     })
 
 DEFINE_OPERATION (OP_DIV,           {
                                     WriteBothNodes()
-                                    fprintf(fp, "div\n");
+                                    AsmEmit(code, ASM_DIV);
                                     })
 
 DEFINE_OPERATION (OP_POW,           {
                                     WriteBothNodes()
-                                    fprintf(fp, "pow\n");
+                                    AsmEmit(code, ASM_POW);
                                     })
 
 DEFINE_OPERATION (OP_AND,           {
                                     WriteBothNodes()
-                                    fprintf(fp, "and\n");
+                                    AsmEmit(code, ASM_AND);
                                     })
 
 DEFINE_OPERATION (OP_OR,            {
                                     WriteBothNodes()
-                                    fprintf(fp, "or\n");
+                                    AsmEmit(code, ASM_OR);
                                     })
 
 DEFINE_OPERATION (OP_NOT,           {
-                                    WriteEquation(node->right, fp);
-                                    fprintf(fp, "not\n");
+                                    WriteEquation(tree, tree->right[node], code);
+                                    AsmEmit(code, ASM_NOT);
                                     })
 
 DEFINE_OPERATION (OP_SIN,           {
-                                    WriteEquation(node->right, fp);
-                                    fprintf(fp, "sin\n");
+                                    WriteEquation(tree, tree->right[node], code);
+                                    AsmEmit(code, ASM_SIN);
                                     })
 
 DEFINE_OPERATION (OP_COS,           {
-                                    WriteEquation(node->right, fp);
-                                    fprintf(fp, "cos\n");
+                                    WriteEquation(tree, tree->right[node], code);
+                                    AsmEmit(code, ASM_COS);
                                     })
 
 DEFINE_OPERATION (OP_SQRT,          {
-                                    WriteEquation(node->right, fp);
-                                    fprintf(fp, "sqrt\n");
+                                    WriteEquation(tree, tree->right[node], code);
+                                    AsmEmit(code, ASM_SQRT);
                                     })
 
 DEFINE_OPERATION (OP_INPUT,         {
-                                    if (node->right->type == VARIABLE)
-                                        {
-                                        fprintf(fp, "in\n");
-                                        fprintf(fp, "pop [%d]\n", node->right->data.id);
-                                        fprintf(fp, "push [%d]\n", node->right->data.id);
-                                        }
-                                    else if (node->right->type == ARRAY)
-                                        {
-                                        fprintf(fp, "in\n");
-                                        fprintf(fp, "pop [%d]\n", node->right->data.id * ARRAY_MAX_SIZE + ARRAY_SEGMENT + (int) node->right->right->data.val);
-                                        fprintf(fp, "push [%d]\n", node->right->data.id);
-                                        }
-                                    else
-                                        {
-                                        printf("Syntax error: input type is not variable\n");
-                                        return SyntaxError;
-                                        }
+                                    if (WriteInput(tree, tree->right[node], code) != Ok) return SyntaxError;
                                     })
 
 DEFINE_OPERATION (OP_OUTPUT,        {
-                                    WriteEquation(node->right, fp);
-                                    fprintf(fp, "out\n");
+                                    WriteEquation(tree, tree->right[node], code);
+                                    AsmEmit(code, ASM_OUT);
                                     })
 
 DEFINE_OPERATION (OP_RETURN,        {
-                                    if (node->right)
+                                    if (tree->right[node] != NIL_NODE)
                                         {
-                                        WriteEquation(node->right, fp);
-                                        fprintf(fp, "pop reg0\n");
+                                        WriteEquation(tree, tree->right[node], code);
+                                        AsmEmit(code, ASM_POP, ARG_REGISTER, 0);
                                         }
                                     else
                                         {
-                                        fprintf(fp, "push 0\n");
-                                        fprintf(fp, "pop reg0\n");
+                                        AsmEmitNumber(code, 0);
+                                        AsmEmit(code, ASM_POP, ARG_REGISTER, 0);
                                         }
-                                    fprintf(fp, "ret\n");
+                                    AsmEmit(code, ASM_RET);
                                     })
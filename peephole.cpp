@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "errors.h"
+#include "node.h"
+#include "flattree.h"
+#include "treeio.h"
+#include "asmcode.h"
+#include "peephole.h"
+
+struct StackEffect
+    {
+    signed char pops;
+    signed char pushes;
+    };
+
+struct PeepholePattern
+    {
+    const char* name;
+    bool      (*apply)(AsmCode* code, int pos);
+    };
+
+static const StackEffect STACK_EFFECTS[ASM_OPCODE_COUNT] =
+    {
+    {0, 0},                                                 // label
+    {0, 1}, {1, 0},                                         // push pop
+    {2, 1}, {2, 1}, {2, 1}, {2, 1}, {2, 1},                 // add sub mul div pow
+    {2, 1}, {2, 1}, {2, 1}, {2, 1}, {2, 1}, {2, 1},         // gt lt ge le eq ne
+    {2, 1}, {2, 1}, {1, 1},                                 // and or not
+    {1, 1}, {1, 1}, {1, 1},                                 // sin cos sqrt
+    {0, 1}, {1, 1},                                         // in out, out оставляет число на стеке
+    {0, 0}, {2, 0}, {2, 0},                                 // jmp je jne
+    {0, 0}, {0, 0}, {0, 0},                                 // call ret nop
+    {1, 1}, {2, 0}                                          // pushi popi
+    };
+
+static bool UnusedPush(AsmCode* code, int pos);
+static bool SelfMove(AsmCode* code, int pos);
+static bool DeadStore(AsmCode* code, int pos);
+static bool JumpToNext(AsmCode* code, int pos);
+static bool Unreachable(AsmCode* code, int pos);
+
+static const PeepholePattern PATTERNS[PEEP_RULE_COUNT] =
+    {
+    {"push x ... pop trash",    UnusedPush},
+    {"push x; pop x",           SelfMove},
+    {"dead pop [n]",            DeadStore},
+    {"jmp L; L:",               JumpToNext},
+    {"code after jmp/ret",      Unreachable},
+    };
+
+static int  NextLive(const AsmCode* code, int pos);
+static bool IsBlockEnd(const Instruction* instruction);
+static bool IsMemory(const Instruction* instruction, const int opcode, const int address);
+static void Remove(AsmCode* code, int pos);
+static void Compact(AsmCode* code);
+static long CountInstructions(const AsmCode* code);
+
+Error_t Peephole(AsmCode* code, PeepholeStats* stats)
+    {
+    assert(code);
+    assert(stats);
+
+    stats->before += CountInstructions(code);
+
+    bool changed = true;
+    while (changed)
+        {
+        changed = false;
+        stats->passes++;
+
+        for (int pos = 0; pos < code->size; pos++)
+            {
+            for (int rule = 0; rule < PEEP_RULE_COUNT && code->code[pos].opcode != ASM_NOP; rule++)
+                {
+                if (PATTERNS[rule].apply(code, pos))
+                    {
+                    stats->applied[rule]++;
+                    changed = true;
+                    }
+                }
+            }
+
+        Compact(code);
+        }
+
+    stats->after += CountInstructions(code);
+
+    return Ok;
+    }
+
+void PeepholeReport(const PeepholeStats* stats, FILE* fp)
+    {
+    assert(stats);
+    assert(fp);
+
+    fprintf(fp, "Peephole: %ld -> %ld instructions, %ld removed, %d passes\n",
+            stats->before, stats->after, stats->before - stats->after, stats->passes);
+
+    for (int rule = 0; rule < PEEP_RULE_COUNT; rule++)
+        {
+        fprintf(fp, "    %-24s %ld\n", PATTERNS[rule].name, stats->applied[rule]);
+        }
+    }
+
+// Значение, которое снимает pop trash, никто не читает: если между ними стек
+// ни разу не опускается ниже него, и push, и pop можно убрать
+static bool UnusedPush(AsmCode* code, int pos)
+    {
+    if (code->code[pos].opcode != ASM_PUSH) return false;
+
+    int depth  = 1;
+    int window = 0;
+    for (int i = NextLive(code, pos); i < code->size && window < PEEPHOLE_WINDOW; i = NextLive(code, i), window++)
+        {
+        const Instruction* instruction = code->code + i;
+        if (IsBlockEnd(instruction)) return false;
+
+        if (instruction->opcode == ASM_POP && instruction->kind == ARG_TRASH && depth == 1)
+            {
+            Remove(code, pos);
+            Remove(code, i);
+            return true;
+            }
+
+        StackEffect effect = STACK_EFFECTS[instruction->opcode];
+        if (depth - effect.pops < 1) return false;
+        depth += effect.pushes - effect.pops;
+        }
+
+    return false;
+    }
+
+static bool SelfMove(AsmCode* code, int pos)
+    {
+    const Instruction* push = code->code + pos;
+    if (push->opcode != ASM_PUSH || (push->kind != ARG_MEMORY && push->kind != ARG_REGISTER)) return false;
+
+    int next = NextLive(code, pos);
+    if (next == code->size) return false;
+
+    const Instruction* pop = code->code + next;
+    if (pop->opcode != ASM_POP || pop->kind != push->kind || pop->arg.id != push->arg.id) return false;
+
+    Remove(code, pos);
+    Remove(code, next);
+    return true;
+    }
+
+// Запись в память, которую перезаписывают раньше, чем читают. Вызов может
+// прочитать любую переменную, поэтому он, как и переходы, обрывает поиск.
+static bool DeadStore(AsmCode* code, int pos)
+    {
+    Instruction* store = code->code + pos;
+    if (store->opcode != ASM_POP || store->kind != ARG_MEMORY) return false;
+
+    int window = 0;
+    for (int i = NextLive(code, pos); i < code->size && window < PEEPHOLE_WINDOW; i = NextLive(code, i), window++)
+        {
+        const Instruction* instruction = code->code + i;
+        if (IsBlockEnd(instruction) || instruction->opcode == ASM_CALL) return false;
+        if (IsMemory(instruction, ASM_PUSH, store->arg.id))          return false;
+        // pushi может прочитать любую ячейку массива
+        if (instruction->opcode == ASM_PUSHI)                         return false;
+
+        if (IsMemory(instruction, ASM_POP, store->arg.id))
+            {
+            store->kind   = ARG_TRASH;
+            store->arg.id = 0;
+            return true;
+            }
+        }
+
+    return false;
+    }
+
+static bool JumpToNext(AsmCode* code, int pos)
+    {
+    const Instruction* jump = code->code + pos;
+    if (jump->opcode != ASM_JMP) return false;
+
+    for (int i = NextLive(code, pos); i < code->size && code->code[i].opcode == ASM_LABEL; i = NextLive(code, i))
+        {
+        if (code->code[i].arg.id == jump->arg.id)
+            {
+            Remove(code, pos);
+            return true;
+            }
+        }
+
+    return false;
+    }
+
+static bool Unreachable(AsmCode* code, int pos)
+    {
+    int opcode = code->code[pos].opcode;
+    if (opcode != ASM_JMP && opcode != ASM_RET) return false;
+
+    bool removed = false;
+    for (int i = NextLive(code, pos); i < code->size && code->code[i].opcode != ASM_LABEL; i = NextLive(code, i))
+        {
+        Remove(code, i);
+        removed = true;
+        }
+
+    return removed;
+    }
+
+static int NextLive(const AsmCode* code, int pos)
+    {
+    do pos++;
+    while (pos < code->size && code->code[pos].opcode == ASM_NOP);
+
+    return pos;
+    }
+
+static bool IsBlockEnd(const Instruction* instruction)
+    {
+    switch (instruction->opcode)
+        {
+        case ASM_LABEL:
+        case ASM_JMP:
+        case ASM_JE:
+        case ASM_JNE:
+        case ASM_RET:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+static bool IsMemory(const Instruction* instruction, const int opcode, const int address)
+    {
+    return instruction->opcode == opcode && instruction->kind == ARG_MEMORY && instruction->arg.id == address;
+    }
+
+static void Remove(AsmCode* code, int pos)
+    {
+    code->code[pos].opcode = ASM_NOP;
+    code->code[pos].kind   = ARG_NONE;
+    }
+
+static void Compact(AsmCode* code)
+    {
+    int size = 0;
+    for (int pos = 0; pos < code->size; pos++)
+        {
+        if (code->code[pos].opcode != ASM_NOP) code->code[size++] = code->code[pos];
+        }
+
+    code->size = size;
+    }
+
+static long CountInstructions(const AsmCode* code)
+    {
+    long count = 0;
+    for (int pos = 0; pos < code->size; pos++)
+        {
+        if (code->code[pos].opcode != ASM_LABEL) count++;
+        }
+
+    return count;
+    }
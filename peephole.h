@@ -0,0 +1,29 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+const int PEEPHOLE_WINDOW = 256;
+
+enum PeepholeRule
+    {
+    PEEP_UNUSED_PUSH    = 0,
+    PEEP_SELF_MOVE      = 1,
+    PEEP_DEAD_STORE     = 2,
+    PEEP_JUMP_TO_NEXT   = 3,
+    PEEP_UNREACHABLE    = 4,
+    PEEP_RULE_COUNT
+    };
+
+struct PeepholeStats
+    {
+    long        before;
+    long        after;
+    int         passes;
+    long        applied[PEEP_RULE_COUNT];
+    };
+
+// Проходы по коду с таблицей правил, пока хоть одно срабатывает.
+// Метки, переходы, вызовы и ret ограничивают окно правил.
+Error_t Peephole(AsmCode* code, PeepholeStats* stats);
+void    PeepholeReport(const PeepholeStats* stats, FILE* fp);
+
+#endif //PEEPHOLE_H
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "errors.h"
+#include "node.h"
+#include "tree.h"
+#include "tokens.h"
+#include "nametable.h"
+#include "frontend.h"
+#include "flattree.h"
+#include "treeio.h"
+#include "asmcode.h"
+#include "bytecode.h"
+#include "peephole.h"
+#include "backend.h"
+#include "native.h"
+#include "rami.h"
+
+static const char DEFAULT_ASM_FILENAME[] = "output.txt";
+static const char TREE_FILE_FLAG[]       = "--tree";
+static const char TEXT_TREE_FLAG[]       = "--text";
+static const char OPTIMIZE_FLAG[]        = "-O";
+static const char STATS_FLAG[]           = "--stats";
+static const char NATIVE_FLAG[]          = "--native";
+static const char BYTECODE_FLAG[]        = "--bytecode";
+
+int main(int argc, char *argv[])
+    {
+    const char*  file_from = nullptr;
+    const char*  file_to   = nullptr;
+    const char*  tree_file = nullptr;
+    bool         text      = false;
+    BackendFlags flags     = {};
+
+    for (int i = 1; i < argc; i++)
+        {
+        if      (!strcmp(argv[i], TEXT_TREE_FLAG))                 text           = true;
+        else if (!strcmp(argv[i], OPTIMIZE_FLAG))                  flags.optimize = true;
+        else if (!strcmp(argv[i], STATS_FLAG))                     flags.report   = true;
+        else if (!strcmp(argv[i], NATIVE_FLAG))                    flags.native   = true;
+        else if (!strcmp(argv[i], BYTECODE_FLAG))                  flags.bytecode = true;
+        else if (!strcmp(argv[i], TREE_FILE_FLAG) && i + 1 < argc) tree_file      = argv[++i];
+        else if (!file_from)                                       file_from      = argv[i];
+        else if (!file_to)                                         file_to        = argv[i];
+        }
+
+    if (!file_from)
+        {
+        printf("Incorrect args number\n");
+        return FileError;
+        }
+    if (!file_to) file_to = DEFAULT_ASM_FILENAME;
+
+    return Rami(file_from, file_to, tree_file, text, &flags) == Ok ? 0 : 1;
+    }
+
+Error_t Rami(const char* file_from, const char* file_to, const char* tree_file, bool text, const BackendFlags* flags)
+    {
+    assert(file_from);
+    assert(file_to);
+    assert(flags);
+
+    Compiler cmp = {};
+    CompilerCtor(&cmp, file_from);
+    if (cmp.error)
+        {
+        return cmp.error;
+        }
+
+    if (ParseProgram(&cmp) != Ok || (flags->optimize && OptimizeProgram(&cmp, flags->report) != Ok))
+        {
+        CompilerDtor(&cmp);
+        return cmp.error;
+        }
+
+    if (tree_file)
+        {
+        if (text) WriteTree(&cmp, tree_file);
+        else      WriteFlatTree(&cmp, tree_file);
+        if (cmp.error)
+            {
+            CompilerDtor(&cmp);
+            return cmp.error;
+            }
+        }
+
+    FlatTree flat  = {};
+    Error_t  state = FlatTreeCtor(&flat);
+    if (state == Ok) state = FlattenTree(&flat, cmp.tree.root);
+
+    // Исходник, лексемы и дерево из узлов бэкенду уже не нужны
+    CompilerDtor(&cmp);
+
+    FILE* fp = (state == Ok) ? fopen(file_to, "wb") : nullptr;
+    if (state == Ok && fp == NULL)
+        {
+        perror("Cannot open file\n");
+        state = FileError;
+        }
+
+    if (fp)
+        {
+        if (flags->native) state = WriteNativeCode(&flat, fp);
+        else               state = WriteAsmCode(&flat, fp, flags);
+        fclose(fp);
+        }
+
+    FlatTreeDtor(&flat);
+
+    return state;
+    }
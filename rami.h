@@ -0,0 +1,11 @@
+#ifndef RAMI_H
+#define RAMI_H
+
+// Компиляция в одном процессе: исходник -> дерево в памяти -> ассемблер
+// (текст или, при bytecode, объектный файл стековой машины; при native - x86-64).
+// Если tree_file не nullptr, промежуточное дерево тоже записывается
+// (двоичное или, при text, текстовое). flags - как у бэкенда, stream не используется,
+// optimize ещё и упрощает выражения дерева до бэкенда.
+Error_t Rami(const char* file_from, const char* file_to, const char* tree_file, bool text, const BackendFlags* flags);
+
+#endif //RAMI_H
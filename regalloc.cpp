@@ -0,0 +1,349 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "errors.h"
+#include "node.h"
+#include "stack.h"
+#include "flattree.h"
+#include "treeio.h"
+#include "asmcode.h"
+#include "regalloc.h"
+
+typedef unsigned long long VarSet;
+
+const int NO_REGION         = -1;
+const int NO_SLOT           = -1;
+const int NO_REGISTER       = -1;
+const int LOOP_WEIGHT_SHIFT = 3;
+const int LOOP_WEIGHT_DEPTH = 10;
+
+// region - номер функции (0 - программа), slot - номер бита в VarSet
+struct VarInfo
+    {
+    long        weight;
+    int         region;
+    int         slot;
+    int         reg;
+    bool        shared;
+    };
+
+struct Candidate
+    {
+    long        weight;
+    int         address;
+    };
+
+struct Liveness
+    {
+    const AsmCode*  code;
+    const VarInfo*  vars;
+    const int*      label_pos;
+    VarSet*         live;
+    };
+
+static Error_t MarkRegions(const AsmCode* code, VarInfo* vars, int* label_pos);
+static int     PickCandidates(VarInfo* vars, int var_count, int* slots);
+static int     CompareCandidates(const void* first, const void* second);
+static void    ComputeLiveness(const Liveness* liveness);
+static VarSet  FindConflicts(const Liveness* liveness, VarSet* interference, int slot_count);
+static int     Colour(VarInfo* vars, const int* slots, int slot_count, const VarSet* interference, VarSet rejected, int reserved);
+static VarSet  LiveOut(const Liveness* liveness, int pos);
+static VarSet  Access(const Liveness* liveness, int pos, int opcode);
+
+Error_t RegAlloc(AsmCode* code, RegAllocStats* stats)
+    {
+    assert(code);
+    assert(stats);
+
+    // reg0 - возвращаемое значение, регистры параметров тоже не трогаем
+    int var_count = 0;
+    int reserved  = 1;
+    for (int pos = 0; pos < code->size; pos++)
+        {
+        const Instruction* instruction = code->code + pos;
+        if (instruction->kind == ARG_MEMORY   && instruction->arg.id >= var_count) var_count = instruction->arg.id + 1;
+        if (instruction->kind == ARG_ELEMENT  && instruction->arg.id + ASM_ARRAY_SIZE > var_count)
+            var_count = instruction->arg.id + ASM_ARRAY_SIZE;
+        if (instruction->kind == ARG_REGISTER && instruction->arg.id >= reserved)  reserved  = instruction->arg.id + 1;
+        }
+    if (!var_count || reserved >= ASM_REGISTER_COUNT) return Ok;
+
+    VarInfo* vars      = (VarInfo*) calloc((size_t) var_count, sizeof(VarInfo));
+    int*     label_pos = (int*)     calloc((size_t) code->label_count + 1, sizeof(int));
+    VarSet*  live      = (VarSet*)  calloc((size_t) code->size, sizeof(VarSet));
+    if (!vars || !label_pos || !live)
+        {
+        printf("Error: cannot allocate memory for register allocation\n");
+        free(vars);
+        free(label_pos);
+        free(live);
+        return AllocationError;
+        }
+
+    for (int address = 0; address < var_count; address++) vars[address] = {0, NO_REGION, NO_SLOT, NO_REGISTER, false};
+
+    Error_t state = MarkRegions(code, vars, label_pos);
+
+    int slots[REGALLOC_MAX_VARS] = {};
+    int slot_count = (state == Ok) ? PickCandidates(vars, var_count, slots) : 0;
+
+    if (slot_count)
+        {
+        Liveness liveness = {code, vars, label_pos, live};
+        ComputeLiveness(&liveness);
+
+        VarSet interference[REGALLOC_MAX_VARS] = {};
+        VarSet rejected = FindConflicts(&liveness, interference, slot_count);
+
+        stats->registers = Colour(vars, slots, slot_count, interference, rejected, reserved);
+
+        for (int pos = 0; pos < code->size; pos++)
+            {
+            Instruction* instruction = code->code + pos;
+            if (instruction->kind != ARG_MEMORY || vars[instruction->arg.id].reg == NO_REGISTER) continue;
+
+            instruction->kind   = ARG_REGISTER;
+            instruction->arg.id = vars[instruction->arg.id].reg;
+            stats->rewritten++;
+            }
+        }
+
+    for (int address = 0; address < var_count; address++)
+        {
+        if (vars[address].region == NO_REGION) continue;
+
+        stats->variables++;
+        if (vars[address].slot != NO_SLOT)       stats->candidates++;
+        if (vars[address].reg  != NO_REGISTER)   stats->allocated++;
+        }
+
+    free(vars);
+    free(label_pos);
+    free(live);
+
+    return state;
+    }
+
+void RegAllocReport(const RegAllocStats* stats, FILE* fp)
+    {
+    assert(stats);
+    assert(fp);
+
+    fprintf(fp, "Registers: %d of %d variables (%d candidates) in %d registers, %ld accesses rewritten\n",
+            stats->allocated, stats->variables, stats->candidates, stats->registers, stats->rewritten);
+    }
+
+// Функция - это код от метки func_N до func_guard_N. Вес обращения растёт
+// с глубиной вложенности циклов, чтобы первыми в регистры попали счётчики.
+static Error_t MarkRegions(const AsmCode* code, VarInfo* vars, int* label_pos)
+    {
+    Stack regions = {};
+    if (StackCtor(&regions, sizeof(int)) != Ok) return AllocationError;
+
+    for (int label = 0; label < code->label_count; label++) label_pos[label] = NO_LABEL;
+
+    int     region = 0;
+    int     depth  = 0;
+    Error_t state  = Ok;
+    for (int pos = 0; pos < code->size && state == Ok; pos++)
+        {
+        const Instruction* instruction = code->code + pos;
+
+        if (instruction->opcode == ASM_LABEL)
+            {
+            label_pos[instruction->arg.id] = pos;
+            switch (code->labels[instruction->arg.id].kind)
+                {
+                case LABEL_FUNC:
+                    state  = StackPush(&regions, &region);
+                    region = pos + 1;
+                    break;
+                case LABEL_FUNC_GUARD:
+                    if (regions.size) StackPop(&regions, &region);
+                    break;
+                case LABEL_WHILE:
+                    depth++;
+                    break;
+                case LABEL_END_WHILE:
+                    depth--;
+                    break;
+                default:
+                    break;
+                }
+            }
+
+        // К ячейкам массива с вычисляемым индексом обращаются в обход регистров
+        if (instruction->kind == ARG_ELEMENT)
+            {
+            for (int cell = 0; cell < ASM_ARRAY_SIZE; cell++) vars[instruction->arg.id + cell].shared = true;
+            continue;
+            }
+        if (instruction->kind != ARG_MEMORY) continue;
+
+        VarInfo* var = vars + instruction->arg.id;
+        if (var->region == NO_REGION) var->region = region;
+        else if (var->region != region) var->shared = true;
+
+        int shift = LOOP_WEIGHT_SHIFT * (depth < LOOP_WEIGHT_DEPTH ? (depth > 0 ? depth : 0) : LOOP_WEIGHT_DEPTH);
+        var->weight += 1L << shift;
+        }
+
+    StackDtor(&regions);
+
+    return state;
+    }
+
+static int PickCandidates(VarInfo* vars, int var_count, int* slots)
+    {
+    Candidate* candidates = (Candidate*) calloc((size_t) var_count, sizeof(Candidate));
+    if (!candidates) return 0;
+
+    int count = 0;
+    for (int address = 0; address < var_count; address++)
+        {
+        if (vars[address].weight && !vars[address].shared) candidates[count++] = {vars[address].weight, address};
+        }
+
+    qsort(candidates, (size_t) count, sizeof(Candidate), CompareCandidates);
+    if (count > REGALLOC_MAX_VARS) count = REGALLOC_MAX_VARS;
+
+    for (int slot = 0; slot < count; slot++)
+        {
+        slots[slot] = candidates[slot].address;
+        vars[candidates[slot].address].slot = slot;
+        }
+
+    free(candidates);
+
+    return count;
+    }
+
+static int CompareCandidates(const void* first, const void* second)
+    {
+    const Candidate* a = (const Candidate*) first;
+    const Candidate* b = (const Candidate*) second;
+
+    if (a->weight != b->weight) return a->weight > b->weight ? -1 : 1;
+    return a->address - b->address;
+    }
+
+// Обратный проход до неподвижной точки: live[pos] - переменные, живые перед командой
+static void ComputeLiveness(const Liveness* liveness)
+    {
+    const AsmCode* code = liveness->code;
+
+    bool changed = true;
+    while (changed)
+        {
+        changed = false;
+        for (int pos = code->size - 1; pos >= 0; pos--)
+            {
+            VarSet def = Access(liveness, pos, ASM_POP);
+            VarSet in  = (LiveOut(liveness, pos) & ~def) | Access(liveness, pos, ASM_PUSH);
+            if (in != liveness->live[pos])
+                {
+                liveness->live[pos] = in;
+                changed = true;
+                }
+            }
+        }
+    }
+
+// Переменная конфликтует со всеми, кто жив после её записи. Живые через call
+// отбрасываются, потому что вызываемая функция свободно пользуется регистрами,
+// живые на входе в функцию или программу - потому что читают старое значение памяти.
+static VarSet FindConflicts(const Liveness* liveness, VarSet* interference, int slot_count)
+    {
+    const AsmCode* code = liveness->code;
+
+    VarSet rejected = code->size ? liveness->live[0] : 0;
+    for (int pos = 0; pos < code->size; pos++)
+        {
+        const Instruction* instruction = code->code + pos;
+        VarSet out = LiveOut(liveness, pos);
+
+        if (instruction->opcode == ASM_CALL) rejected |= out;
+        if (instruction->opcode == ASM_LABEL && code->labels[instruction->arg.id].kind == LABEL_FUNC) rejected |= liveness->live[pos];
+
+        VarSet def = Access(liveness, pos, ASM_POP);
+        if (!def) continue;
+
+        out &= ~def;
+        interference[liveness->vars[instruction->arg.id].slot] |= out;
+        for (int slot = 0; slot < slot_count; slot++)
+            {
+            if (out >> slot & 1) interference[slot] |= def;
+            }
+        }
+
+    return rejected;
+    }
+
+// Жадная раскраска в порядке убывания веса, возвращает число занятых регистров
+static int Colour(VarInfo* vars, const int* slots, int slot_count, const VarSet* interference, VarSet rejected, int reserved)
+    {
+    unsigned used_total = 0;
+    for (int slot = 0; slot < slot_count; slot++)
+        {
+        VarInfo* var = vars + slots[slot];
+        if (rejected >> slot & 1) continue;
+
+        unsigned used = 0;
+        for (int other = 0; other < slot; other++)
+            {
+            int reg = vars[slots[other]].reg;
+            if (reg != NO_REGISTER && (interference[slot] >> other & 1)) used |= 1U << reg;
+            }
+
+        for (int reg = reserved; reg < ASM_REGISTER_COUNT; reg++)
+            {
+            if (used >> reg & 1) continue;
+
+            var->reg    = reg;
+            used_total |= 1U << reg;
+            break;
+            }
+        }
+
+    int count = 0;
+    for (int reg = 0; reg < ASM_REGISTER_COUNT; reg++) count += (int) (used_total >> reg & 1);
+
+    return count;
+    }
+
+static VarSet LiveOut(const Liveness* liveness, int pos)
+    {
+    const AsmCode*     code        = liveness->code;
+    const Instruction* instruction = code->code + pos;
+    VarSet             next        = (pos + 1 < code->size) ? liveness->live[pos + 1] : 0;
+    VarSet             target      = 0;
+
+    if (instruction->kind == ARG_LABEL && instruction->opcode != ASM_LABEL && instruction->opcode != ASM_CALL)
+        {
+        int target_pos = liveness->label_pos[instruction->arg.id];
+        if (target_pos != NO_LABEL) target = liveness->live[target_pos];
+        }
+
+    switch (instruction->opcode)
+        {
+        case ASM_JMP:
+            return target;
+        case ASM_JE:
+        case ASM_JNE:
+            return target | next;
+        case ASM_RET:
+            return 0;
+        default:
+            return next;
+        }
+    }
+
+static VarSet Access(const Liveness* liveness, int pos, int opcode)
+    {
+    const Instruction* instruction = liveness->code->code + pos;
+    if (instruction->opcode != opcode || instruction->kind != ARG_MEMORY) return 0;
+
+    int slot = liveness->vars[instruction->arg.id].slot;
+    return slot == NO_SLOT ? 0 : 1ULL << slot;
+    }
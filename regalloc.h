@@ -0,0 +1,22 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+const int REGALLOC_MAX_VARS = 64;
+
+struct RegAllocStats
+    {
+    int         variables;
+    int         candidates;
+    int         allocated;
+    int         registers;
+    long        rewritten;
+    };
+
+// Переносит самые нагруженные переменные из [id] в регистры, не занятые
+// передачей параметров. Живость считается по командам, переменная остаётся
+// в памяти, если она живёт через call или на входе в функцию, встречается
+// в нескольких функциях или ей не хватило регистра.
+Error_t RegAlloc(AsmCode* code, RegAllocStats* stats);
+void    RegAllocReport(const RegAllocStats* stats, FILE* fp);
+
+#endif //REGALLOC_H
@@ -0,0 +1,87 @@
+#include <assert.h>
+#include "scan.h"
+
+#if defined(__SSE2__) && !defined(SCAN_NO_SIMD)
+#include <emmintrin.h>
+#define SCAN_SIMD
+#endif
+
+static inline bool IsSpaceByte(const unsigned char c)
+    {
+    return c == ' ' || (unsigned char) (c - '\t') <= '\r' - '\t';
+    }
+
+static inline bool IsDigitByte(const unsigned char c)
+    {
+    return (unsigned char) (c - '0') <= 9;
+    }
+
+static inline bool IsWordByte(const unsigned char c)
+    {
+    return (unsigned char) ((c | 0x20) - 'a') <= 'z' - 'a' || IsDigitByte(c) || c == '_' || c == '$';
+    }
+
+#ifdef SCAN_SIMD
+
+// Маска байтов блока, для которых (c - low) <= high - low без знака
+static inline __m128i InRange(const __m128i block, const char low, const char high)
+    {
+    __m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8(low));
+    return _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8((char) (high - low))), shifted);
+    }
+
+static inline __m128i SpaceMask(const __m128i block)
+    {
+    return _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')), InRange(block, '\t', '\r'));
+    }
+
+static inline __m128i DigitMask(const __m128i block)
+    {
+    return InRange(block, '0', '9');
+    }
+
+static inline __m128i WordMask(const __m128i block)
+    {
+    __m128i letters = InRange(_mm_or_si128(block, _mm_set1_epi8(0x20)), 'a', 'z');
+    __m128i others  = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('_')),
+                                   _mm_cmpeq_epi8(block, _mm_set1_epi8('$')));
+    return _mm_or_si128(_mm_or_si128(letters, others), DigitMask(block));
+    }
+
+// Блоки читаются только целиком внутри [pos, size), хвост проверяется по байту
+#define SCAN_BLOCKS(mask_func)                                                          \
+    while (pos + SCAN_BLOCK_SIZE <= size)                                               \
+        {                                                                               \
+        __m128i block = _mm_loadu_si128((const __m128i*) (const void*) (str + pos));    \
+        unsigned mask = (unsigned) _mm_movemask_epi8(mask_func(block)) ^ 0xFFFFu;       \
+        if (mask) return pos + __builtin_ctz(mask);                                     \
+        pos += SCAN_BLOCK_SIZE;                                                         \
+        }
+
+#else
+
+#define SCAN_BLOCKS(mask_func)
+
+#endif
+
+int ScanSpaces(const char* str, int pos, int size)
+    {
+    assert(str);
+
+    SCAN_BLOCKS(SpaceMask)
+    while (pos < size && IsSpaceByte((unsigned char) str[pos])) pos++;
+
+    return pos;
+    }
+
+int ScanAsciiWord(const char* str, int pos, int size)
+    {
+    assert(str);
+
+    SCAN_BLOCKS(WordMask)
+    while (pos < size && IsWordByte((unsigned char) str[pos])) pos++;
+
+    return pos;
+    }
+
+#undef SCAN_BLOCKS
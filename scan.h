@@ -0,0 +1,11 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+const int SCAN_BLOCK_SIZE = 16;
+
+// Позиция первого байта в [pos, size), который не пробел / не ASCII-буква или цифра.
+// Пробелы и буквы понимаются так же, как в CharClasses.
+int ScanSpaces(const char* str, int pos, int size);
+int ScanAsciiWord(const char* str, int pos, int size);
+
+#endif //SCAN_H
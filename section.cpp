@@ -0,0 +1,23 @@
+#include <stdio.h>
+#include <assert.h>
+#include "section.h"
+
+unsigned AlignOffset(unsigned offset)
+    {
+    return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+    }
+
+// Дописывает нули до выровненного смещения, затем size байт data. offset - сколько байт уже записано.
+void WriteSection(const void* data, unsigned size, unsigned* offset, FILE* fp)
+    {
+    assert(offset);
+    assert(fp);
+
+    static const char PADDING[SECTION_ALIGNMENT] = {};
+
+    unsigned start = AlignOffset(*offset);
+    fwrite(PADDING, sizeof(char), start - *offset, fp);
+
+    if (size) fwrite(data, sizeof(char), size, fp);
+    *offset = start + size;
+    }
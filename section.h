@@ -0,0 +1,10 @@
+#ifndef SECTION_H
+#define SECTION_H
+
+const int SECTION_ALIGNMENT = 8;
+
+// Разделы двоичных файлов (дерево, байт-код) начинаются со смещений, кратных SECTION_ALIGNMENT
+unsigned AlignOffset(unsigned offset);
+void     WriteSection(const void* data, unsigned size, unsigned* offset, FILE* fp);
+
+#endif //SECTION_H
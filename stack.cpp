@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "errors.h"
+#include "stack.h"
+
+Error_t StackCtor(Stack* stack, const int elem_size)
+    {
+    assert(stack);
+    assert(elem_size > 0);
+
+    stack->size      = 0;
+    stack->capacity  = STACK_DEFAULT_CAPACITY;
+    stack->elem_size = elem_size;
+    stack->data      = (char*) calloc((size_t) stack->capacity, (size_t) elem_size);
+
+    if (!stack->data)
+        {
+        printf("Error: cannot allocate memory for stack\n");
+        stack->capacity = 0;
+        return AllocationError;
+        }
+
+    return Ok;
+    }
+
+Error_t StackDtor(Stack* stack)
+    {
+    assert(stack);
+
+    free(stack->data);
+    stack->data     = nullptr;
+    stack->size     = 0;
+    stack->capacity = 0;
+
+    return Ok;
+    }
+
+Error_t StackPush(Stack* stack, const void* elem)
+    {
+    assert(stack);
+    assert(elem);
+
+    if (stack->size == stack->capacity)
+        {
+        int   capacity = stack->capacity ? stack->capacity * STACK_GROW_COEFF : STACK_DEFAULT_CAPACITY;
+        char* new_data = (char*) realloc(stack->data, (size_t) capacity * (size_t) stack->elem_size);
+        if (!new_data)
+            {
+            printf("Error: cannot allocate memory for stack\n");
+            return AllocationError;
+            }
+        stack->data     = new_data;
+        stack->capacity = capacity;
+        }
+
+    memcpy(stack->data + stack->size * stack->elem_size, elem, (size_t) stack->elem_size);
+    stack->size++;
+
+    return Ok;
+    }
+
+Error_t StackPop(Stack* stack, void* elem)
+    {
+    assert(stack);
+    assert(stack->size > 0);
+
+    stack->size--;
+    if (elem) memcpy(elem, stack->data + stack->size * stack->elem_size, (size_t) stack->elem_size);
+
+    return Ok;
+    }
+
+void* StackTop(Stack* stack)
+    {
+    assert(stack);
+
+    if (!stack->size) return nullptr;
+
+    return stack->data + (stack->size - 1) * stack->elem_size;
+    }
@@ -0,0 +1,23 @@
+#ifndef STACK_H
+#define STACK_H
+
+const int STACK_DEFAULT_CAPACITY = 64;
+const int STACK_GROW_COEFF       = 2;
+
+// Стек элементов произвольного размера, нужен обходам дерева без рекурсии
+struct Stack
+    {
+    char*   data;
+    int     size;
+    int     capacity;
+    int     elem_size;
+    };
+
+Error_t StackCtor(Stack* stack, const int elem_size);
+Error_t StackDtor(Stack* stack);
+
+Error_t StackPush(Stack* stack, const void* elem);
+Error_t StackPop(Stack* stack, void* elem);
+void*   StackTop(Stack* stack);
+
+#endif //STACK_H
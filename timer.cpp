@@ -0,0 +1,10 @@
+#include <time.h>
+#include "timer.h"
+
+double Now()
+    {
+    struct timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+    }
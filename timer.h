@@ -0,0 +1,7 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+// Монотонное время в секундах, для замеров виртуальной машины, JIT и интерпретатора
+double Now();
+
+#endif //TIMER_H
@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "errors.h"
+#include "logfiles.h"
+#include "node.h"
+#include "tokens.h"
+
+static void TokensAssert(Tokens* tokens);
+static void TokensRelease(Tokens* tokens);
+static const char* GetTokensErrorBitMsg(const size_t bit);
+
+Error_t MyTokensCtor(Tokens* tokens,
+                     const char* name,
+                     const unsigned line,
+                     const char* file,
+                     const char* func)
+    {
+    assert(tokens != NULL);
+
+    tokens->array = nullptr;
+    tokens->size  = 0;
+    tokens->first = 0;
+    tokens->pos   = 0;
+    tokens->mark  = TOKENS_NO_MARK;
+
+    if (TokensReserve(tokens, TOKENS_DEFAULT_CAPACITY) != Ok)
+        {
+        return AllocationError;
+        }
+
+    Data_t start = {.id = PROGRAM_START};
+    TokensPush(tokens, PUNCTUATION, start, 0, 0);
+
+    tokens->name = name;
+    tokens->line = line;
+    tokens->file = file;
+    tokens->func = func;
+
+    if (LogFileInit(&tokens->logfile, "logfile", name, "html") == FileError)
+        {
+        perror("cannot open tokens logfile\n");
+        return FileError;
+        }
+
+    tokens->dumps_count = 0;
+
+    return Ok;
+    }
+
+Error_t TokensDtor(Tokens* tokens)
+    {
+    TokensAssert(tokens);
+
+    free(tokens->array);
+    tokens->array    = nullptr;
+    tokens->size     = 0;
+    tokens->capacity = 0;
+    tokens->first    = 0;
+    tokens->pos      = 0;
+    tokens->mark     = TOKENS_NO_MARK;
+
+    fclose(tokens->logfile);
+
+    return Ok;
+    }
+
+Error_t TokensReserve(Tokens* tokens, int capacity)
+    {
+    assert(tokens != NULL);
+
+    if (tokens->array && capacity <= tokens->capacity) return Ok;
+
+    Token* new_array = (Token*) realloc(tokens->array, (size_t) capacity * sizeof(Token));
+    if (!new_array)
+        {
+        printf("Error: cannot allocate memory for tokens\n");
+        return AllocationError;
+        }
+
+    tokens->array    = new_array;
+    tokens->capacity = capacity;
+
+    return Ok;
+    }
+
+Error_t TokensPush(Tokens* tokens, const int type, const Data_t data, const long offset, const int length)
+    {
+    assert(tokens != NULL);
+
+    if (tokens->size == tokens->capacity) TokensRelease(tokens);
+    if (tokens->size == tokens->capacity &&
+        TokensReserve(tokens, tokens->capacity * TOKENS_GROW_COEFF) != Ok)
+        {
+        return AllocationError;
+        }
+
+    Token* token = tokens->array + tokens->size++;
+
+    token->type   = type;
+    token->data   = data;
+    token->offset = offset;
+    token->length = length;
+
+    return Ok;
+    }
+
+// Окно растёт, только если парсеру нужны все лексемы в нём
+static void TokensRelease(Tokens* tokens)
+    {
+    assert(tokens != NULL);
+
+    long keep = tokens->pos;
+    if (tokens->mark != TOKENS_NO_MARK && tokens->mark < keep) keep = tokens->mark;
+    if (keep > tokens->first + tokens->size - 1)               keep = tokens->first + tokens->size - 1;
+
+    int drop = (int) (keep - tokens->first);
+    if (drop <= 0) return;
+
+    memmove(tokens->array, tokens->array + drop, (size_t) (tokens->size - drop) * sizeof(Token));
+    tokens->size  -= drop;
+    tokens->first += drop;
+    }
+
+State_t TokensVerify(const Tokens* tokens)
+    {
+    State_t state = 0;
+
+    if (tokens == NULL)
+        {
+        state |= TokensNullptr;
+        return state;
+        }
+
+    if (tokens->array == NULL) state |= TokensArrayNullptr;
+    if (tokens->size < 0 || tokens->size > tokens->capacity ||
+        tokens->pos  < tokens->first || tokens->pos > tokens->first + tokens->size)
+        {
+        state |= TokensInvalidSize;
+        }
+
+    return state;
+    }
+
+static void TokensAssert(Tokens* tokens)
+    {
+    State_t state = TokensVerify(tokens);
+    if (state) TokensDump(tokens, state);
+    }
+
+Error_t MyTokensDump(Tokens* tokens,
+                     State_t state,
+                     const char* name,
+                     const unsigned line,
+                     const char* file,
+                     const char* func)
+    {
+    assert(tokens != NULL);
+    assert(tokens->logfile != NULL);
+
+    fprintf(tokens->logfile, "<pre>\n\n");
+
+    fprintf(tokens->logfile, "Tokens[%p] '%s' from %s(%u) %s()\n", tokens, tokens->name, tokens->file, tokens->line, tokens->func);
+    fprintf(tokens->logfile, "\tcalled like '%s' from %s(%u) %s()\n",          name,         file,         line,         func);
+    fprintf(tokens->logfile, "\tsize = %d, capacity = %d, first = %ld, pos = %ld\n", tokens->size, tokens->capacity, tokens->first, tokens->pos);
+    fprintf(tokens->logfile, "\ttokens:\n");
+
+    for (int i = 0; tokens->array && i < tokens->size; i++)
+        {
+        const Token* token = tokens->array + i;
+        switch (token->type)
+            {
+            case VALUE:
+                fprintf(tokens->logfile, "\t\t[%ld] VALUE: %f\n", token->offset, token->data.val);
+                break;
+            case VARIABLE:
+                fprintf(tokens->logfile, "\t\t[%ld] VARIABLE: %d\n", token->offset, token->data.id);
+                break;
+            case ARRAY:
+                fprintf(tokens->logfile, "\t\t[%ld] ARRAY: %d\n", token->offset, token->data.id);
+                break;
+            case OPERATION:
+                fprintf(tokens->logfile, "\t\t[%ld] OPERATION: %d\n", token->offset, token->data.id);
+                break;
+            case FUNCTION:
+                fprintf(tokens->logfile, "\t\t[%ld] FUNCTION: %d\n", token->offset, token->data.id);
+                break;
+            case PUNCTUATION:
+                fprintf(tokens->logfile, "\t\t[%ld] PUNCTUATION: %d\n", token->offset, token->data.id);
+                break;
+            default:
+                fprintf(tokens->logfile, "\t\t[%ld] UNKNOWN %d: %d\n", token->offset, token->type, token->data.id);
+                break;
+            }
+        }
+
+    for(size_t bit = 0; bit < CHAR_BIT * sizeof(state); bit++)
+        {
+        if (state & 1 << bit)
+            {
+            fprintf(tokens->logfile, "%s\n", GetTokensErrorBitMsg(bit));
+            }
+        }
+
+    fprintf(tokens->logfile, "</pre>\n\n");
+
+    ++tokens->dumps_count;
+
+    return Ok;
+    }
+
+static const char* GetTokensErrorBitMsg(const size_t bit)
+    {
+    static const int  ERROR_COUNT = sizeof(State_t) * CHAR_BIT;
+    static const char * const ERROR_MESSAGES[ERROR_COUNT] = {
+        "Tokens is nullptr",
+        "Tokens->array is nullptr",
+        "Tokens size, capacity or pos is invalid"
+    };
+
+    return ERROR_MESSAGES[bit];
+    }
@@ -0,0 +1,59 @@
+#ifndef TOKENS_H
+#define TOKENS_H
+
+#define TOKENS_DEFN_ARGS const char* /* name */, const unsigned /* line */, \
+                         const char* /* file */, const char*    /* func */
+#define TOKENS_PASS_ARGS __LINE__, __FILE__, __FUNCTION__
+#define TokensCtor(stk)         MyTokensCtor((stk),           #stk, TOKENS_PASS_ARGS)
+#define TokensDump(stk, stk_st) MyTokensDump((stk), (stk_st), #stk, TOKENS_PASS_ARGS)
+
+const int  TOKENS_DEFAULT_CAPACITY = 64;
+const int  TOKENS_GROW_COEFF       = 2;
+const long TOKENS_NO_MARK          = -1;
+
+struct Token
+    {
+    Data_t  data;
+    long    offset;
+    int     type;
+    int     length;
+    };
+
+// Окно лексем: array[0] - лексема номер first. Когда окно заполнено, лексемы
+// до pos (и до mark, если парсер может вернуться) выбрасываются, последняя остаётся.
+struct Tokens
+    {
+    Token*  array;
+    int     size;
+    int     capacity;
+    long    first;
+    long    pos;
+    long    mark;
+
+    const char* name;
+    unsigned    line;
+    const char* file;
+    const char* func;
+
+    FILE* logfile;
+    int   dumps_count;
+    };
+
+enum TokensErrorBit
+    {
+    TokensNullptr                   = 1 << 0,
+    TokensArrayNullptr              = 1 << 1,
+    TokensInvalidSize               = 1 << 2
+    };
+
+Error_t MyTokensCtor(Tokens* tokens, TOKENS_DEFN_ARGS);
+Error_t TokensDtor(Tokens* tokens);
+
+Error_t TokensReserve(Tokens* tokens, int capacity);
+Error_t TokensPush(Tokens* tokens, const int type, const Data_t data, const long offset, const int length);
+
+State_t TokensVerify(const Tokens* tokens);
+
+Error_t MyTokensDump(Tokens* tokens, State_t state, TOKENS_DEFN_ARGS);
+
+#endif //TOKENS_H
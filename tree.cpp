@@ -6,8 +6,40 @@
 #include "errors.h"
 #include "logfiles.h"
 #include "node.h"
+#include "stack.h"
 #include "tree.h"
 
+enum WalkStage
+    {
+    WALK_VISIT      = 0,
+    WALK_BETWEEN    = 1,
+    WALK_LEAVE      = 2,
+    WALK_CLOSE      = 3,
+    };
+
+struct WalkFrame
+    {
+    const Node* node;
+    int         stage;
+    int         count;
+    };
+
+struct CopyFrame
+    {
+    const Node* src;
+    Node**      dest;
+    };
+
+static Error_t PushWalkFrame(Stack* stack, const Node* node, const int stage);
+static Error_t PushWalkClose(Stack* stack, const TreeWalker* walker, const Node* node);
+
+static Error_t PrintNil(void* file);
+static Error_t PrintOpen(const Node* node, void* file);
+static Error_t PrintData(const Node* node, void* file);
+static Error_t PrintOpenData(const Node* node, void* file);
+static Error_t PrintClose(int count, void* file);
+static Error_t DumpNode(const Node* node, void* fp);
+
 static bool IsTreeErrorState(const State_t state);
 static void TreeAssert(Tree* tree);
 static const char* GetTreeErrorBitMsg(const size_t bit);
@@ -21,6 +53,7 @@ Error_t MyTreeCtor(Tree* tree,
     assert(tree != NULL);
 
     tree->root = nullptr;
+    NodeArenaCtor(&tree->arena);
 
     tree->name = name;
     tree->line = line;
@@ -42,100 +75,186 @@ Error_t TreeDtor(Tree* tree)
     {
     TreeAssert(tree);
 
-    if (tree->root) DeleteNode(tree->root);
+    NodeArenaDtor(&tree->arena);
+    tree->root = nullptr;
 
     fclose(tree->logfile);
 
     return Ok;
     }
 
-Error_t CopyTree(Node** dest, const Node* src)
+Error_t CopyTree(Node** dest, const Node* src, NodeArena* arena)
     {
-    assert(src != NULL);
+    assert(src   != NULL);
+    assert(arena != NULL);
 
-    if (*dest) DeleteNode(*dest);
+    if (*dest) DeleteNode(*dest, arena);
     *dest = nullptr;
 
-    if (NewNode(dest, src->type, src->data) == AllocationError)
+    Stack stack = {};
+    if (StackCtor(&stack, sizeof(CopyFrame)) != Ok) return CopyError;
+
+    CopyFrame frame = {src, dest};
+    Error_t   state = StackPush(&stack, &frame);
+
+    while (state == Ok && stack.size)
+        {
+        StackPop(&stack, &frame);
+
+        if (NewNode(frame.dest, frame.src->type, frame.src->data, arena) == AllocationError)
+            {
+            state = AllocationError;
+            break;
+            }
+
+        // Правый потомок кладётся первым, поэтому стек не растёт вдоль правой цепочки
+        CopyFrame right = {frame.src->right, &(*frame.dest)->right};
+        CopyFrame left  = {frame.src->left,  &(*frame.dest)->left};
+        if (right.src) state = StackPush(&stack, &right);
+        if (left.src && state == Ok) state = StackPush(&stack, &left);
+        }
+
+    StackDtor(&stack);
+
+    if (state != Ok)
         {
         printf("Внимание: в связи с ошибкой копирование дерева не завершилось.\n");
         return CopyError;
         }
 
-    if (src->left)  CopyTree(&(*dest)->left,  src->left);
-    if (src->right) CopyTree(&(*dest)->right, src->right);
-
     return Ok;
     }
 
-Error_t PreorderNode(const Node* node, FILE* file)
+Error_t WalkTree(const Node* root, const TreeWalker* walker)
     {
-    if (!node)
-        {
-        fprintf(file, "_ ");
-        return Ok;
-        }
+    assert(walker != NULL);
 
-    fprintf(file, "( ");
+    Stack stack = {};
+    if (StackCtor(&stack, sizeof(WalkFrame)) != Ok) return AllocationError;
 
-    fprintf(file, "%d ", node->type);
+    Error_t state = PushWalkFrame(&stack, root, WALK_VISIT);
 
-    if (node->type == VALUE) fprintf(file, "%f ", node->data.val);
-    else fprintf(file, "%d ", node->data.id);
+    while (state == Ok && stack.size)
+        {
+        WalkFrame frame = {};
+        StackPop(&stack, &frame);
 
-    PreorderNode(node->left, file);
-    PreorderNode(node->right, file);
+        const Node* node = frame.node;
+        switch (frame.stage)
+            {
+            case WALK_VISIT:
+                {
+                if (!node)
+                    {
+                    if (walker->nil) state = walker->nil(walker->context);
+                    break;
+                    }
+
+                if (walker->enter) state = walker->enter(node, walker->context);
+
+                if (state == Ok)                    state = PushWalkClose(&stack, walker, node);
+                if (state == Ok)                    state = PushWalkFrame(&stack, node->right, WALK_VISIT);
+                if (state == Ok && walker->between) state = PushWalkFrame(&stack, node, WALK_BETWEEN);
+                if (state == Ok)                    state = PushWalkFrame(&stack, node->left, WALK_VISIT);
+                break;
+                }
+            case WALK_BETWEEN:
+                {
+                state = walker->between(node, walker->context);
+                break;
+                }
+            case WALK_LEAVE:
+                {
+                state = walker->leave(node, walker->context);
+                if (state == Ok && walker->close) state = walker->close(1, walker->context);
+                break;
+                }
+            case WALK_CLOSE:
+                {
+                if (walker->close) state = walker->close(frame.count, walker->context);
+                break;
+                }
+            default:
+                assert(!"unknown walk stage");
+                break;
+            }
+        }
 
-    fprintf(file, ") ");
+    StackDtor(&stack);
 
-    return Ok;
+    return state;
     }
 
-Error_t PostorderNode(const Node* node, FILE* file)
+static Error_t PushWalkFrame(Stack* stack, const Node* node, const int stage)
     {
-    if (!node)
+    WalkFrame frame = {node, stage, 1};
+    return StackPush(stack, &frame);
+    }
+
+// Закрытие узла, который идёт сразу после закрытия предка, добавляется к нему
+static Error_t PushWalkClose(Stack* stack, const TreeWalker* walker, const Node* node)
+    {
+    if (walker->leave) return PushWalkFrame(stack, node, WALK_LEAVE);
+
+    WalkFrame* top = (WalkFrame*) StackTop(stack);
+    if (top && top->stage == WALK_CLOSE)
         {
-        fprintf(file, "_ ");
+        top->count++;
         return Ok;
         }
 
-    fprintf(file, "( ");
-
-    PostorderNode(node->left, file);
-    PostorderNode(node->right, file);
-
-    fprintf(file, "%d ", node->type);
-
-    if (node->type == VALUE) fprintf(file, "%f ", node->data.val);
-    else fprintf(file, "%d ", node->data.id);
-
-    fprintf(file, ") ");
+    return PushWalkFrame(stack, node, WALK_CLOSE);
+    }
 
-    return Ok;
+Error_t PreorderNode(const Node* node, FILE* file)
+    {
+    TreeWalker walker = {PrintOpenData, PrintNil, nullptr, nullptr, PrintClose, file};
+    return WalkTree(node, &walker);
     }
 
+Error_t PostorderNode(const Node* node, FILE* file)
+    {
+    TreeWalker walker = {PrintOpen, PrintNil, nullptr, PrintData, PrintClose, file};
+    return WalkTree(node, &walker);
+    }
 
 Error_t InorderNode(const Node* node, FILE* file)
     {
-    if (!node)
-        {
-        fprintf(file, "_ ");
-        return Ok;
-        }
+    TreeWalker walker = {PrintOpen, PrintNil, PrintData, nullptr, PrintClose, file};
+    return WalkTree(node, &walker);
+    }
 
-    fprintf(file, "( ");
+static Error_t PrintNil(void* file)
+    {
+    fprintf((FILE*) file, "_ ");
+    return Ok;
+    }
 
-    InorderNode(node->left, file);
+static Error_t PrintOpen(const Node* /* node */, void* file)
+    {
+    fprintf((FILE*) file, "( ");
+    return Ok;
+    }
 
-    fprintf(file, "%d ", node->type);
+static Error_t PrintData(const Node* node, void* file)
+    {
+    fprintf((FILE*) file, "%d ", node->type);
 
-    if (node->type == VALUE) fprintf(file, "%f ", node->data.val);
-    else fprintf(file, "%d ", node->data.id);
+    if (node->type == VALUE) fprintf((FILE*) file, "%f ", node->data.val);
+    else fprintf((FILE*) file, "%d ", node->data.id);
 
-    InorderNode(node->right, file);
+    return Ok;
+    }
 
-    fprintf(file, ") ");
+static Error_t PrintOpenData(const Node* node, void* file)
+    {
+    PrintOpen(node, file);
+    return PrintData(node, file);
+    }
 
+static Error_t PrintClose(int count, void* file)
+    {
+    while (count--) fprintf((FILE*) file, ") ");
     return Ok;
     }
 
@@ -289,7 +408,19 @@ Error_t TreeNodeDump(const Node *node, FILE *fp)
         fprintf(fp,  "\t\t\"0\" [shape=oval, height = 1, label = \"nil\"];\n");
         return Ok;
         }
-    else if (node->type == VALUE) fprintf(fp,  "\t\t\"%p\" [shape=oval, height = 1, label = \"VALUE: %f\"];\n", node, node->data.val);
+
+    TreeWalker walker = {DumpNode, nullptr, nullptr, nullptr, nullptr, fp};
+    return WalkTree(node, &walker);
+    }
+
+static Error_t DumpNode(const Node* node, void* file)
+    {
+    assert(node != NULL);
+    assert(file != NULL);
+
+    FILE* fp = (FILE*) file;
+
+    if (node->type == VALUE) fprintf(fp,  "\t\t\"%p\" [shape=oval, height = 1, label = \"VALUE: %f\"];\n", node, node->data.val);
     else if (node->type == VARIABLE) fprintf(fp,  "\t\t\"%p\" [shape=oval, height = 1, label = \"VARIABLE %d\"];\n", node, node->data.id);
     else if (node->type == ARRAY) fprintf(fp,  "\t\t\"%p\" [shape=oval, height = 1, label = \"ARRAY %d\"];\n", node, node->data.id);
     else if (node->type == FUNCTION) fprintf(fp,  "\t\t\"%p\" [shape=oval, height = 1, label = \"FUNCTION %d\"];\n", node, node->data.id);
@@ -354,17 +485,8 @@ Error_t TreeNodeDump(const Node *node, FILE *fp)
             }
         }
 
-    if (node->left)
-        {
-        fprintf(fp, "\t\t\"%p\" -> \"%p\" [color = red];\n", node, node->left);
-        TreeNodeDump(node->left, fp);
-        }
-
-    if (node->right)
-        {
-        fprintf(fp, "\t\t\"%p\" -> \"%p\" [color = cyan];\n", node, node->right);
-        TreeNodeDump(node->right, fp);
-        }
+    if (node->left)  fprintf(fp, "\t\t\"%p\" -> \"%p\" [color = red];\n",  node, node->left);
+    if (node->right) fprintf(fp, "\t\t\"%p\" -> \"%p\" [color = cyan];\n", node, node->right);
 
     return Ok;
     }
@@ -9,7 +9,8 @@
 
 struct Tree
     {
-    Node*  root;
+    Node*       root;
+    NodeArena   arena;
 
     const char* name;
     unsigned    line;
@@ -20,6 +21,20 @@ struct Tree
     int   dumps_count;
     };
 
+// Обход без рекурсии, любой обработчик может отсутствовать. enter вызывается
+// до детей, between - между ними, leave и close - после. Если leave не задан,
+// закрытия узлов правой цепочки сливаются в один close(count), поэтому стек
+// обхода растёт с вложенностью, а не с длиной цепочки команд.
+struct TreeWalker
+    {
+    Error_t (*enter)  (const Node* node, void* context);
+    Error_t (*nil)    (void* context);
+    Error_t (*between)(const Node* node, void* context);
+    Error_t (*leave)  (const Node* node, void* context);
+    Error_t (*close)  (int count, void* context);
+    void*   context;
+    };
+
 enum TreeErrorBit
     {
     TreeNullptr                = 1 << 0
@@ -28,7 +43,9 @@ enum TreeErrorBit
 Error_t MyTreeCtor(Tree* tree, TREE_DEFN_ARGS);
 Error_t TreeDtor(Tree* tree);
 
-Error_t CopyTree(Node** dest, const Node* src);
+Error_t CopyTree(Node** dest, const Node* src, NodeArena* arena);
+
+Error_t WalkTree(const Node* root, const TreeWalker* walker);
 
 Error_t PreorderNode(const Node* node, FILE* file = stdout);
 Error_t PostorderNode(const Node* node, FILE* file = stdout);
@@ -0,0 +1,424 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <charconv>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "errors.h"
+#include "node.h"
+#include "stack.h"
+#include "tree.h"
+#include "flattree.h"
+#include "treeio.h"
+
+struct ReadFrame
+    {
+    NodeIndex   parent;
+    bool        right;
+    int         closes;
+    };
+
+
+static char* WriterReserve(TextWriter* writer);
+
+static Error_t WriteNil(void* context);
+static Error_t WriteNode(const Node* node, void* context);
+static Error_t WriteClose(int count, void* context);
+
+static void TextReaderFill(TextReader* reader);
+static int  ReadSymbol(TextReader* reader);
+static void SkipSpaces(TextReader* reader);
+
+template <typename Number>
+static bool ReadNumber(TextReader* reader, Number* number)
+    {
+    SkipSpaces(reader);
+
+    const char* first = reader->pos;
+    if (first < reader->end && *first == '+') first++;
+
+    std::from_chars_result result = std::from_chars(first, reader->end, *number);
+    if (result.ec != std::errc()) return false;
+
+    reader->pos = result.ptr;
+    return true;
+    }
+
+Error_t TextWriterCtor(TextWriter* writer, FILE* fp)
+    {
+    assert(writer);
+    assert(fp);
+
+    writer->fp     = fp;
+    writer->size   = 0;
+    writer->error  = Ok;
+    writer->buffer = (char*) malloc(TEXT_WRITER_SIZE);
+    if (!writer->buffer)
+        {
+        printf("Error: cannot allocate memory for text writer\n");
+        writer->error = AllocationError;
+        return AllocationError;
+        }
+
+    return Ok;
+    }
+
+Error_t TextWriterDtor(TextWriter* writer)
+    {
+    assert(writer);
+
+    if (writer->buffer) TextWriterFlush(writer);
+
+    free(writer->buffer);
+    writer->buffer = nullptr;
+    writer->fp     = nullptr;
+
+    return writer->error;
+    }
+
+Error_t TextWriterFlush(TextWriter* writer)
+    {
+    assert(writer);
+    assert(writer->buffer);
+
+    if (writer->size && fwrite(writer->buffer, sizeof(char), (size_t) writer->size, writer->fp) != (size_t) writer->size)
+        {
+        perror("Cannot write file");
+        writer->error = FileError;
+        }
+    writer->size = 0;
+
+    return writer->error;
+    }
+
+static char* WriterReserve(TextWriter* writer)
+    {
+    if (TEXT_WRITER_SIZE - writer->size < TEXT_WRITER_RESERVE) TextWriterFlush(writer);
+
+    return writer->buffer + writer->size;
+    }
+
+void WriteChars(TextWriter* writer, const char* str, int length)
+    {
+    assert(writer);
+    assert(str);
+
+    if (length >= TEXT_WRITER_RESERVE)
+        {
+        TextWriterFlush(writer);
+        if (fwrite(str, sizeof(char), (size_t) length, writer->fp) != (size_t) length) writer->error = FileError;
+        return;
+        }
+
+    memcpy(WriterReserve(writer), str, (size_t) length);
+    writer->size += length;
+    }
+
+void WriteInt(TextWriter* writer, const int value)
+    {
+    assert(writer);
+
+    char* first = WriterReserve(writer);
+    writer->size += (int) (std::to_chars(first, first + TEXT_WRITER_RESERVE, value).ptr - first);
+    }
+
+void WriteDouble(TextWriter* writer, const double value)
+    {
+    assert(writer);
+
+    char* first = WriterReserve(writer);
+    writer->size += (int) (std::to_chars(first, first + TEXT_WRITER_RESERVE, value).ptr - first);
+    }
+
+Error_t WriteTextTree(const Node* root, FILE* fp)
+    {
+    assert(fp);
+
+    TextWriter writer = {};
+    if (TextWriterCtor(&writer, fp) != Ok) return AllocationError;
+
+    TreeWalker walker = {WriteNode, WriteNil, nullptr, nullptr, WriteClose, &writer};
+    WalkTree(root, &walker);
+
+    return TextWriterDtor(&writer);
+    }
+
+static Error_t WriteNil(void* context)
+    {
+    TextWriter* writer = (TextWriter*) context;
+
+    WriteChars(writer, "_ ", 2);
+    return writer->error;
+    }
+
+static Error_t WriteNode(const Node* node, void* context)
+    {
+    TextWriter* writer = (TextWriter*) context;
+
+    WriteChars(writer, "( ", 2);
+    WriteInt(writer, node->type);
+    WriteChars(writer, " ", 1);
+
+    if (node->type == VALUE) WriteDouble(writer, node->data.val);
+    else                     WriteInt(writer, node->data.id);
+    WriteChars(writer, " ", 1);
+
+    return writer->error;
+    }
+
+static Error_t WriteClose(int count, void* context)
+    {
+    TextWriter* writer = (TextWriter*) context;
+
+    while (count--) WriteChars(writer, ") ", 2);
+    return writer->error;
+    }
+
+Error_t TextReaderCtor(TextReader* reader, const char* text, size_t size)
+    {
+    assert(reader);
+    assert(text || !size);
+
+    reader->start  = text;
+    reader->pos    = text;
+    reader->end    = text + size;
+    reader->base   = 0;
+    reader->buffer = nullptr;
+    reader->fp     = nullptr;
+
+    return Ok;
+    }
+
+Error_t TextStreamCtor(TextReader* reader, FILE* fp)
+    {
+    assert(reader);
+    assert(fp);
+
+    reader->buffer = (char*) malloc(TEXT_READ_CHUNK);
+    if (!reader->buffer)
+        {
+        printf("Error: cannot allocate memory for tree reader\n");
+        return AllocationError;
+        }
+
+    reader->start = reader->buffer;
+    reader->pos   = reader->buffer;
+    reader->end   = reader->buffer;
+    reader->base  = 0;
+    reader->fp    = fp;
+
+    TextReaderFill(reader);
+
+    return Ok;
+    }
+
+Error_t TextReaderDtor(TextReader* reader)
+    {
+    assert(reader);
+
+    free(reader->buffer);
+    reader->buffer = nullptr;
+    reader->fp     = nullptr;
+    reader->start  = nullptr;
+    reader->pos    = nullptr;
+    reader->end    = nullptr;
+
+    return Ok;
+    }
+
+// Держит в окне не меньше TEXT_READ_LOOKAHEAD байт или весь остаток файла,
+// чтобы число никогда не обрывалось на границе окна
+static void TextReaderFill(TextReader* reader)
+    {
+    if (!reader->fp || reader->end - reader->pos >= TEXT_READ_LOOKAHEAD) return;
+
+    size_t rest = (size_t) (reader->end - reader->pos);
+    memmove(reader->buffer, reader->pos, rest);
+    reader->base += reader->pos - reader->start;
+
+    size_t read = fread(reader->buffer + rest, sizeof(char), TEXT_READ_CHUNK - rest, reader->fp);
+    if (!read) reader->fp = nullptr;
+
+    reader->start = reader->buffer;
+    reader->pos   = reader->buffer;
+    reader->end   = reader->buffer + rest + read;
+    }
+
+Error_t ReadTextHead(TextReader* reader, bool* opened, int* type, Data_t* data)
+    {
+    assert(reader);
+    assert(opened);
+    assert(type);
+    assert(data);
+
+    *opened = false;
+
+    int c = ReadSymbol(reader);
+    if (c == '_') return Ok;
+    if (c != '(')
+        {
+        if (c == EOF) printf("Error: reached End of file\n");
+        else          printf("Syntax error, wrong %c symbol\n", c);
+        return SyntaxError;
+        }
+
+    data->val = 0;
+    if (!ReadNumber(reader, type) ||
+        !(*type == VALUE ? ReadNumber(reader, &data->val) : ReadNumber(reader, &data->id)))
+        {
+        printf("Syntax error, wrong number at %ld\n", reader->base + (reader->pos - reader->start));
+        return SyntaxError;
+        }
+
+    *opened = true;
+    return Ok;
+    }
+
+Error_t ReadTextClose(TextReader* reader, int count)
+    {
+    assert(reader);
+
+    while (count--)
+        {
+        if (ReadSymbol(reader) != ')')
+            {
+            printf("Error: forget to close bracket\n");
+            return SyntaxError;
+            }
+        }
+
+    return Ok;
+    }
+
+// Разбор "( тип данные левое правое )" без рекурсии прямо в плоское дерево, узлы
+// нумеруются в прямом порядке, как в FlattenTree. В стеке лежат места для ещё не
+// прочитанных узлов и ожидаемые закрывающие скобки (closes), скобки узлов правой
+// цепочки складываются в один элемент.
+Error_t ReadTextNode(FlatTree* tree, TextReader* reader, NodeIndex* root)
+    {
+    assert(tree);
+    assert(reader);
+    assert(root);
+
+    *root = NIL_NODE;
+
+    Stack stack = {};
+    if (StackCtor(&stack, sizeof(ReadFrame)) != Ok) return AllocationError;
+
+    ReadFrame frame = {NIL_NODE, false, 0};
+    Error_t   state = StackPush(&stack, &frame);
+
+    while (state == Ok && stack.size)
+        {
+        StackPop(&stack, &frame);
+
+        if (frame.closes)
+            {
+            state = ReadTextClose(reader, frame.closes);
+            continue;
+            }
+
+        bool   opened = false;
+        int    type   = 0;
+        Data_t data   = {.val = 0};
+        state = ReadTextHead(reader, &opened, &type, &data);
+        if (state != Ok || !opened) continue;
+
+        NodeIndex node = FlatTreeAdd(tree, type, data);
+        if (node == NIL_NODE)
+            {
+            state = AllocationError;
+            break;
+            }
+
+        if      (frame.parent == NIL_NODE) *root                     = node;
+        else if (frame.right)              tree->right[frame.parent] = node;
+        else                               tree->left[frame.parent]  = node;
+
+        ReadFrame* top = (ReadFrame*) StackTop(&stack);
+        if (top && top->closes) top->closes++;
+        else
+            {
+            ReadFrame close = {NIL_NODE, false, 1};
+            state = StackPush(&stack, &close);
+            }
+
+        ReadFrame right = {node, true,  0};
+        ReadFrame left  = {node, false, 0};
+        if (state == Ok) state = StackPush(&stack, &right);
+        if (state == Ok) state = StackPush(&stack, &left);
+        }
+
+    StackDtor(&stack);
+
+    return state;
+    }
+
+Error_t ReadTextTree(FlatTree* tree, const char* text, size_t size)
+    {
+    assert(tree);
+
+    TextReader reader = {};
+    TextReaderCtor(&reader, text, size);
+
+    Error_t state = ReadTextNode(tree, &reader, &tree->root);
+    TextReaderDtor(&reader);
+
+    return state;
+    }
+
+// Обычный файл разбирается прямо из отображения, остальное читается окнами
+Error_t ReadTextTreeFile(FlatTree* tree, FILE* fp)
+    {
+    assert(tree);
+    assert(fp);
+
+    struct stat sb = {};
+    if (fstat(fileno(fp), &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_size > 0)
+        {
+        size_t size = (size_t) sb.st_size;
+        void*  map  = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+        if (map != MAP_FAILED)
+            {
+            madvise(map, size, MADV_SEQUENTIAL);
+
+            Error_t state = ReadTextTree(tree, (const char*) map, size);
+            munmap(map, size);
+
+            return state;
+            }
+        }
+
+    TextReader reader = {};
+    if (TextStreamCtor(&reader, fp) != Ok) return AllocationError;
+
+    Error_t state = ReadTextNode(tree, &reader, &tree->root);
+    TextReaderDtor(&reader);
+
+    return state;
+    }
+
+static void SkipSpaces(TextReader* reader)
+    {
+    while (true)
+        {
+        TextReaderFill(reader);
+
+        const char* pos = reader->pos;
+        while (pos < reader->end && (*pos == ' ' || (*pos >= '\t' && *pos <= '\r'))) pos++;
+        reader->pos = pos;
+
+        if (pos < reader->end || !reader->fp) break;
+        }
+
+    TextReaderFill(reader);
+    }
+
+static int ReadSymbol(TextReader* reader)
+    {
+    SkipSpaces(reader);
+    if (reader->pos == reader->end) return EOF;
+
+    return (unsigned char) *reader->pos++;
+    }
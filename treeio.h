@@ -0,0 +1,55 @@
+#ifndef TREEIO_H
+#define TREEIO_H
+
+const int TEXT_WRITER_SIZE    = 1 << 16;
+const int TEXT_WRITER_RESERVE = 64;
+const int TEXT_READ_CHUNK     = 1 << 16;
+const int TEXT_READ_LOOKAHEAD = 1 << 10;
+
+// Буферизованный вывод: числа форматируются через std::to_chars прямо в буфер,
+// буфер сбрасывается, когда в нём остаётся меньше TEXT_WRITER_RESERVE байт.
+struct TextWriter
+    {
+    FILE*       fp;
+    char*       buffer;
+    int         size;
+    Error_t     error;
+    };
+
+Error_t TextWriterCtor(TextWriter* writer, FILE* fp);
+Error_t TextWriterDtor(TextWriter* writer);
+Error_t TextWriterFlush(TextWriter* writer);
+
+void    WriteChars(TextWriter* writer, const char* str, int length);
+void    WriteInt(TextWriter* writer, const int value);
+void    WriteDouble(TextWriter* writer, const double value);
+
+// Чтение из текста в памяти или из потока окнами по TEXT_READ_CHUNK байт.
+// start - начало текста или окна, base - его смещение в файле.
+struct TextReader
+    {
+    const char* start;
+    const char* pos;
+    const char* end;
+    long        base;
+
+    char*       buffer;
+    FILE*       fp;
+    };
+
+// Текстовое дерево "( тип данные левое правое )", "_" - пустой узел.
+// Константы пишутся кратчайшей записью, которая читается обратно без потерь.
+Error_t WriteTextTree(const Node* root, FILE* fp);
+
+Error_t TextReaderCtor(TextReader* reader, const char* text, size_t size);
+Error_t TextStreamCtor(TextReader* reader, FILE* fp);
+Error_t TextReaderDtor(TextReader* reader);
+
+Error_t ReadTextHead(TextReader* reader, bool* opened, int* type, Data_t* data);
+Error_t ReadTextClose(TextReader* reader, int count);
+Error_t ReadTextNode(FlatTree* tree, TextReader* reader, NodeIndex* root);
+
+Error_t ReadTextTree(FlatTree* tree, const char* text, size_t size);
+Error_t ReadTextTreeFile(FlatTree* tree, FILE* fp);
+
+#endif //TREEIO_H
@@ -0,0 +1,98 @@
+#ifndef TRIE_H
+#define TRIE_H
+
+const int TRIE_ROOT       = 0;
+const int TRIE_NO_NODE    = 0;
+const int TRIE_NO_WORD    = -1;
+const int TRIE_ALPHABET   = 256;
+
+struct TrieNode
+    {
+    unsigned char   byte;
+    short           child;
+    short           sibling;
+    short           word;
+    };
+
+// Префиксное дерево ключевых слов, строится на этапе компиляции.
+// Корень хранит полную таблицу переходов, остальные узлы - список братьев
+// (у них почти всегда один потомок).
+template <size_t MaxNodes>
+struct Trie
+    {
+    TrieNode    nodes[MaxNodes];
+    short       root_edges[TRIE_ALPHABET];
+    int         size;
+    };
+
+constexpr int TrieStrlen(const char* str)
+    {
+    int length = 0;
+    while (str[length]) length++;
+    return length;
+    }
+
+template <typename Word, size_t Count>
+constexpr size_t TrieMaxNodes(const Word (&words)[Count])
+    {
+    size_t size = 1;
+    for (size_t i = 0; i < Count; i++) size += (size_t) TrieStrlen(words[i].name);
+    return size;
+    }
+
+template <size_t MaxNodes>
+constexpr int TrieNext(const Trie<MaxNodes>* trie, const int node, const char c)
+    {
+    if (node == TRIE_ROOT) return trie->root_edges[(unsigned char) c];
+
+    for (int child = trie->nodes[node].child; child != TRIE_NO_NODE; child = trie->nodes[child].sibling)
+        {
+        if (trie->nodes[child].byte == (unsigned char) c) return child;
+        }
+
+    return TRIE_NO_NODE;
+    }
+
+template <size_t MaxNodes, typename Word, size_t Count>
+constexpr Trie<MaxNodes> BuildTrie(const Word (&words)[Count])
+    {
+    Trie<MaxNodes> trie = {};
+
+    trie.nodes[TRIE_ROOT].word = TRIE_NO_WORD;
+    trie.size = 1;
+
+    for (size_t i = 0; i < Count; i++)
+        {
+        int node = TRIE_ROOT;
+
+        for (const char* c = words[i].name; *c; c++)
+            {
+            int next = TrieNext(&trie, node, *c);
+            if (next == TRIE_NO_NODE)
+                {
+                next = trie.size++;
+                trie.nodes[next].byte    = (unsigned char) *c;
+                trie.nodes[next].child   = TRIE_NO_NODE;
+                trie.nodes[next].word    = TRIE_NO_WORD;
+
+                if (node == TRIE_ROOT)
+                    {
+                    trie.nodes[next].sibling = TRIE_NO_NODE;
+                    trie.root_edges[(unsigned char) *c] = (short) next;
+                    }
+                else
+                    {
+                    trie.nodes[next].sibling = trie.nodes[node].child;
+                    trie.nodes[node].child   = (short) next;
+                    }
+                }
+            node = next;
+            }
+
+        if (trie.nodes[node].word == TRIE_NO_WORD) trie.nodes[node].word = (short) i;
+        }
+
+    return trie;
+    }
+
+#endif //TRIE_H
@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "errors.h"
+#include "timer.h"
+#include "node.h"
+#include "flattree.h"
+#include "treeio.h"
+#include "asmcode.h"
+#include "bytecode.h"
+#include "vm.h"
+
+// Команда после загрузки: адрес обработчика и уже разобранный аргумент
+struct Threaded
+    {
+    const void*         handler;
+    union
+        {
+        double          value;
+        double*         cell;
+        const Threaded* target;
+        };
+    };
+
+
+Error_t VmCtor(Vm* vm, const ByteCode* code, FILE* in, FILE* out)
+    {
+    assert(vm);
+    assert(code);
+    assert(in);
+    assert(out);
+
+    vm->memory_size = code->memory_size;
+    vm->stack       = (double*) calloc(VM_STACK_SIZE, sizeof(double));
+    vm->memory      = (double*) calloc((size_t) code->memory_size + 1, sizeof(double));
+    if (!vm->stack || !vm->memory)
+        {
+        printf("Error: cannot allocate memory for virtual machine\n");
+        free(vm->stack);
+        free(vm->memory);
+        vm->stack  = nullptr;
+        vm->memory = nullptr;
+        return AllocationError;
+        }
+
+    for (int reg = 0; reg < ASM_REGISTER_COUNT; reg++) vm->registers[reg] = 0;
+
+    vm->in       = in;
+    vm->out      = out;
+    vm->executed = 0;
+    vm->seconds  = 0;
+
+    return Ok;
+    }
+
+Error_t VmDtor(Vm* vm)
+    {
+    assert(vm);
+
+    free(vm->stack);
+    free(vm->memory);
+    vm->stack  = nullptr;
+    vm->memory = nullptr;
+
+    return Ok;
+    }
+
+void VmReport(const Vm* vm, FILE* fp)
+    {
+    assert(vm);
+    assert(fp);
+
+    double ips = vm->seconds > 0 ? (double) vm->executed / vm->seconds : 0;
+    fprintf(fp, "VM: %ld instructions in %.3f s, %.1f M instructions/s\n", vm->executed, vm->seconds, ips / 1e6);
+    }
+
+// Шитый код: при загрузке каждая команда получает адрес своего обработчика,
+// и обработчик сам переходит к следующему (computed goto, расширение GCC).
+// Ячейки памяти и регистры заранее превращены в указатели, метки - в адреса команд.
+Error_t VmRun(Vm* vm, const ByteCode* code)
+    {
+    assert(vm);
+    assert(code);
+
+    static const void* const HANDLERS[BC_OPCODE_COUNT] =
+        {
+        &&op_halt,
+        &&op_push_number, &&op_push_cell, &&op_push_cell,
+        &&op_pop_cell, &&op_pop_cell, &&op_pop_trash,
+        &&op_add, &&op_sub, &&op_mul, &&op_div, &&op_pow,
+        &&op_gt, &&op_lt, &&op_ge, &&op_le, &&op_eq, &&op_ne,
+        &&op_and, &&op_or, &&op_not,
+        &&op_sin, &&op_cos, &&op_sqrt,
+        &&op_in, &&op_out,
+        &&op_jmp, &&op_je, &&op_jne, &&op_call, &&op_ret,
+        &&op_push_element, &&op_pop_element,
+        };
+
+    Threaded*        program = (Threaded*)        calloc((size_t) code->size + 1, sizeof(Threaded));
+    const Threaded** calls   = (const Threaded**) calloc(VM_CALL_DEPTH, sizeof(Threaded*));
+    if (!program || !calls)
+        {
+        printf("Error: cannot allocate memory for virtual machine\n");
+        free(program);
+        free(calls);
+        return AllocationError;
+        }
+
+    for (int pos = 0; pos < code->size; pos++)
+        {
+        const ByteInstr* instr  = code->code + pos;
+        Threaded*        thread = program + pos;
+
+        thread->handler = HANDLERS[instr->opcode];
+        switch (instr->opcode)
+            {
+            case BC_PUSH_NUMBER:
+                thread->value = code->constants[instr->arg];
+                break;
+            case BC_PUSH_MEMORY: case BC_POP_MEMORY:
+            case BC_PUSH_ELEMENT: case BC_POP_ELEMENT:
+                thread->cell = vm->memory + instr->arg;
+                break;
+            case BC_PUSH_REG: case BC_POP_REG:
+                thread->cell = vm->registers + instr->arg;
+                break;
+            case BC_JMP: case BC_JE: case BC_JNE: case BC_CALL:
+                thread->target = program + instr->arg;
+                break;
+            default:
+                break;
+            }
+        }
+    program[code->size].handler = &&op_halt;
+
+    const Threaded*  ip         = program;
+    const Threaded** csp        = calls;
+    const Threaded** calls_end  = calls + VM_CALL_DEPTH;
+    double*          sp         = vm->stack;
+    double*          stack      = vm->stack;
+    double*          stack_end  = vm->stack + VM_STACK_SIZE;
+    long             executed   = 0;
+    Error_t          state      = Ok;
+
+    #define DISPATCH()   do { executed++; goto *ip->handler; } while (0)
+    #define NEXT()       do { ip++; DISPATCH(); } while (0)
+    #define PUSH_ROOM()  if (sp == stack_end)  goto stack_overflow
+    #define NEED(count)  if (sp - (count) < stack) goto stack_underflow
+    #define BINARY(expr) NEED(2); sp--; sp[-1] = (expr); NEXT()
+    #define UNARY(expr)  NEED(1); sp[-1] = (expr); NEXT()
+    #define IS_TRUE(x)   ((x) < 0 || (x) > 0)
+
+    double start = Now();
+    DISPATCH();
+
+    op_push_number: PUSH_ROOM(); *sp++ = ip->value; NEXT();
+    op_push_cell:   PUSH_ROOM(); *sp++ = *ip->cell; NEXT();
+    op_pop_cell:    NEED(1); *ip->cell = *--sp;     NEXT();
+    op_pop_trash:   NEED(1); sp--;                  NEXT();
+
+    // Индекс лежит на вершине стека, cell - начало массива
+    op_push_element:
+        NEED(1);
+        if (!(0 <= sp[-1] && sp[-1] < ASM_ARRAY_SIZE)) goto index_error;
+        sp[-1] = ip->cell[(int) sp[-1]];
+        NEXT();
+    op_pop_element:
+        NEED(2);
+        if (!(0 <= sp[-1] && sp[-1] < ASM_ARRAY_SIZE)) goto index_error;
+        ip->cell[(int) sp[-1]] = sp[-2];
+        sp -= 2;
+        NEXT();
+
+    op_add: BINARY(sp[-1] + sp[0]);
+    op_sub: BINARY(sp[-1] - sp[0]);
+    op_mul: BINARY(sp[-1] * sp[0]);
+    op_div: BINARY(sp[-1] / sp[0]);
+    op_pow: BINARY(pow(sp[-1], sp[0]));
+    op_gt:  BINARY(sp[-1] >  sp[0]);
+    op_lt:  BINARY(sp[-1] <  sp[0]);
+    op_ge:  BINARY(sp[-1] >= sp[0]);
+    op_le:  BINARY(sp[-1] <= sp[0]);
+    op_eq:  BINARY(!(sp[-1] < sp[0] || sp[-1] > sp[0]));
+    op_ne:  BINARY(  sp[-1] < sp[0] || sp[-1] > sp[0]);
+    op_and: BINARY(IS_TRUE(sp[-1]) && IS_TRUE(sp[0]));
+    op_or:  BINARY(IS_TRUE(sp[-1]) || IS_TRUE(sp[0]));
+    op_not:  UNARY(!IS_TRUE(sp[-1]));
+    op_sin:  UNARY(sin(sp[-1]));
+    op_cos:  UNARY(cos(sp[-1]));
+    op_sqrt: UNARY(sqrt(sp[-1]));
+
+    op_in:
+        PUSH_ROOM();
+        if (fscanf(vm->in, "%lf", sp) != 1) goto input_error;
+        sp++;
+        NEXT();
+    // Число остаётся на стеке: вывод - тоже выражение, его значение снимает pop trash
+    op_out:
+        NEED(1);
+        fprintf(vm->out, "%lg\n", sp[-1]);
+        NEXT();
+
+    op_jmp:
+        ip = ip->target;
+        DISPATCH();
+    op_je:
+        NEED(2);
+        sp -= 2;
+        ip = !(sp[0] < sp[1] || sp[0] > sp[1]) ? ip->target : ip + 1;
+        DISPATCH();
+    op_jne:
+        NEED(2);
+        sp -= 2;
+        ip = (sp[0] < sp[1] || sp[0] > sp[1]) ? ip->target : ip + 1;
+        DISPATCH();
+    op_call:
+        if (csp == calls_end) goto stack_overflow;
+        *csp++ = ip + 1;
+        ip = ip->target;
+        DISPATCH();
+    op_ret:
+        if (csp == calls) goto op_halt;
+        ip = *--csp;
+        DISPATCH();
+
+    stack_overflow:
+        printf("Error: virtual machine stack overflow\n");
+        state = CalculationError;
+        goto op_halt;
+    stack_underflow:
+        printf("Error: virtual machine stack is empty at command %td\n", ip - program);
+        state = CalculationError;
+        goto op_halt;
+    input_error:
+        printf("Error: cannot read a number\n");
+        state = FileError;
+        goto op_halt;
+    index_error:
+        printf("Error: array index out of range\n");
+        state = CalculationError;
+        goto op_halt;
+
+    op_halt:
+    vm->seconds  = Now() - start;
+    vm->executed = executed;
+
+    #undef DISPATCH
+    #undef NEXT
+    #undef PUSH_ROOM
+    #undef NEED
+    #undef BINARY
+    #undef UNARY
+    #undef IS_TRUE
+
+    free(program);
+    free(calls);
+
+    return state;
+    }
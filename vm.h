@@ -0,0 +1,29 @@
+#ifndef VM_H
+#define VM_H
+
+const int VM_STACK_SIZE = 1 << 16;
+const int VM_CALL_DEPTH = 1 << 16;
+
+// Исполнитель байткода. Ячейки памяти и регистры - числа double,
+// executed и seconds заполняет VmRun для отчёта о скорости.
+struct Vm
+    {
+    double*     stack;
+    double*     memory;
+    int         memory_size;
+    double      registers[ASM_REGISTER_COUNT];
+
+    FILE*       in;
+    FILE*       out;
+
+    long        executed;
+    double      seconds;
+    };
+
+Error_t VmCtor(Vm* vm, const ByteCode* code, FILE* in, FILE* out);
+Error_t VmDtor(Vm* vm);
+
+Error_t VmRun(Vm* vm, const ByteCode* code);
+void    VmReport(const Vm* vm, FILE* fp);
+
+#endif //VM_H
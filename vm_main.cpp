@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <string.h>
+#include "errors.h"
+#include "node.h"
+#include "flattree.h"
+#include "treeio.h"
+#include "asmcode.h"
+#include "bytecode.h"
+#include "assembler.h"
+#include "vm.h"
+#include "jit.h"
+
+static const char DEFAULT_ASM_FILENAME[] = "output.txt";
+static const char STATS_FLAG[]           = "--stats";
+static const char JIT_FLAG[]             = "--jit";
+static const char DISASM_FLAG[]          = "--disasm";
+
+static Error_t Disassemble(const ByteCode* code, FILE* fp);
+
+int main(int argc, char *argv[])
+    {
+    const char* file_from = nullptr;
+    bool        report    = false;
+    bool        jit_flag  = false;
+    bool        disasm    = false;
+
+    for (int i = 1; i < argc; i++)
+        {
+        if      (!strcmp(argv[i], STATS_FLAG))  report    = true;
+        else if (!strcmp(argv[i], JIT_FLAG))    jit_flag  = true;
+        else if (!strcmp(argv[i], DISASM_FLAG)) disasm    = true;
+        else if (!file_from)                    file_from = argv[i];
+        }
+    if (!file_from) file_from = DEFAULT_ASM_FILENAME;
+
+    ByteCode code = {};
+    ByteCodeCtor(&code);
+
+    Error_t state = AssembleFile(&code, file_from);
+    if (state == Ok && disasm)
+        {
+        state = Disassemble(&code, stdout);
+        ByteCodeDtor(&code);
+        return state == Ok ? 0 : 1;
+        }
+
+    Vm vm = {};
+    if (state == Ok) state = VmCtor(&vm, &code, stdin, stdout);
+
+    // Если машинный код не получился, программу исполняет VmRun
+    JitCode jit = {};
+    JitCtor(&jit);
+    bool compiled = state == Ok && jit_flag && JitCompile(&jit, &code) == Ok;
+
+    if (state == Ok)
+        {
+        if (compiled) state = JitRun(&jit, &vm);
+        else          state = VmRun(&vm, &code);
+
+        if (report && compiled)  JitReport(&jit, stdout);
+        if (report && !compiled) VmReport(&vm, stdout);
+        VmDtor(&vm);
+        }
+
+    JitDtor(&jit);
+
+    ByteCodeDtor(&code);
+
+    return state == Ok ? 0 : 1;
+    }
+
+// Байткод (обычно объектный файл) печатается текстом ассемблера, который снова собирается
+static Error_t Disassemble(const ByteCode* code, FILE* fp)
+    {
+    AsmCode asm_code = {};
+    AsmCodeCtor(&asm_code);
+
+    TextWriter writer = {};
+    Error_t    state  = ByteCodeToAsm(&asm_code, code);
+    if (state == Ok) state = TextWriterCtor(&writer, fp);
+    if (state == Ok)
+        {
+        WriteAsmText(&asm_code, &writer);
+        state = TextWriterDtor(&writer);
+        }
+
+    AsmCodeDtor(&asm_code);
+
+    return state;
+    }
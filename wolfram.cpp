@@ -11,6 +11,13 @@
 static bool IsEqual(double a, double b);
 static bool FindAddSub(Node* node);
 static bool FindVariable(Node* node);
+static bool IsOperation(const Node* node, const int code);
+static bool IsValue(const Node* node, const double value);
+static bool IsFoldable(const int code);
+static bool IsConstant(const Node* node);
+static bool IsPure(const Node* node);
+static void ReplaceWithValue(Node** node, const double value, NodeArena* arena);
+static void ReplaceWithChild(Node** node, Node* child, NodeArena* arena);
 
 double Eval(const Node* node, double x)
     {
@@ -30,30 +37,39 @@ double Eval(const Node* node, double x)
     double left  = Eval(node->left,  x);
     double right = Eval(node->right, x);
 
-    switch (node->data.oper)
+    switch (node->data.id)
         {
-        case OP_ADD:  return left + right;
-        case OP_SUB:  return left - right;
-        case OP_MUL:  return left * right;
-        case OP_DIV:  return left / right;
-        case OP_POW:  return pow(left, right);
-        case OP_SIN:  return sin(right);
-        case OP_COS:  return cos(right);
-        case OP_LOG:  return log(right);
-        case OP_EXP:  return exp(right);
-        case OP_SQRT: return sqrt(right);
-        case NO_OPER: return 0;
+        case OP_ADD:           return left + right;
+        case OP_SUB:           return left - right;
+        case OP_MUL:           return left * right;
+        case OP_DIV:           return left / right;
+        case OP_POW:           return pow(left, right);
+        case OP_SIN:           return sin(right);
+        case OP_COS:           return cos(right);
+        case OP_LOG:           return log(right);
+        case OP_EXP:           return exp(right);
+        case OP_SQRT:          return sqrt(right);
+        case OP_GREATER:       return left >  right;
+        case OP_LESS:          return left <  right;
+        case OP_GREATER_EQUAL: return left >= right;
+        case OP_LESS_EQUAL:    return left <= right;
+        case OP_EQUAL:         return !(left < right || left > right);
+        case OP_NOT_EQUAL:     return   left < right || left > right;
+        case OP_AND:           return (left < 0 || left > 0) && (right < 0 || right > 0);
+        case OP_OR:            return (left < 0 || left > 0) || (right < 0 || right > 0);
+        case OP_NOT:           return !(right < 0 || right > 0);
+        case NO_OPER:          return 0;
         default: printf("Error: unknown operation");
         }
     return 0;
     }
 
-Error_t Differentiation(Node** dest, const Node* src)
+Error_t Differentiation(Node** dest, const Node* src, NodeArena* arena)
     {
     assert(dest != NULL);
     assert(src  != NULL);
 
-    if (*dest) DeleteNode(*dest);
+    if (*dest) DeleteNode(*dest, arena);
     *dest = nullptr;
 
     Data_t add = {.id = OP_ADD};
@@ -70,7 +86,7 @@ Error_t Differentiation(Node** dest, const Node* src)
     if (src->type == VALUE)
         {
         Data_t data = {.val = 0};
-        if (NewNode(dest, VALUE, data) == AllocationError)
+        if (NewNode(dest, VALUE, data, arena) == AllocationError)
             {
             printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
             return DifferentiationError;
@@ -80,7 +96,7 @@ Error_t Differentiation(Node** dest, const Node* src)
     else if (src->type == VARIABLE)
         {
         Data_t data = {.val = 1};
-        if (NewNode(dest, VALUE, data) == AllocationError)
+        if (NewNode(dest, VALUE, data, arena) == AllocationError)
             {
             printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
             return DifferentiationError;
@@ -88,18 +104,18 @@ Error_t Differentiation(Node** dest, const Node* src)
         return Ok;
         }
 
-    switch (src->data.oper)
+    switch (src->data.id)
         {
         case OP_ADD: case OP_SUB:
             {
-            if (NewNode(dest, OPERATION, src->data) == AllocationError)
+            if (NewNode(dest, OPERATION, src->data, arena) == AllocationError)
                 {
                 printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                 return DifferentiationError;
                 }
 
-            if (Differentiation(&(*dest)->left,  src->left)  == DifferentiationError ||
-                Differentiation(&(*dest)->right, src->right) == DifferentiationError)
+            if (Differentiation(&(*dest)->left,  src->left,  arena) == DifferentiationError ||
+                Differentiation(&(*dest)->right, src->right, arena) == DifferentiationError)
                 {
                 return DifferentiationError;
                 }
@@ -108,22 +124,22 @@ Error_t Differentiation(Node** dest, const Node* src)
             }
         case OP_MUL:
             {
-            if (NewNode(dest,            OPERATION, add) == AllocationError ||
-                NewNode(&(*dest)->left,  OPERATION, mul) == AllocationError ||
-                NewNode(&(*dest)->right, OPERATION, mul) == AllocationError)
+            if (NewNode(dest,            OPERATION, add, arena) == AllocationError ||
+                NewNode(&(*dest)->left,  OPERATION, mul, arena) == AllocationError ||
+                NewNode(&(*dest)->right, OPERATION, mul, arena) == AllocationError)
                 {
                 printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                 return DifferentiationError;
                 }
 
-            if (Differentiation(&(*dest)->left->left,   src->left)  == DifferentiationError ||
-                Differentiation(&(*dest)->right->right, src->right) == DifferentiationError)
+            if (Differentiation(&(*dest)->left->left,   src->left,  arena) == DifferentiationError ||
+                Differentiation(&(*dest)->right->right, src->right, arena) == DifferentiationError)
                 {
                 return DifferentiationError;
                 }
 
-            if (CopyTree(&(*dest)->left->right, src->right) == CopyError ||
-                CopyTree(&(*dest)->right->left, src->left)  == CopyError)
+            if (CopyTree(&(*dest)->left->right, src->right, arena) == CopyError ||
+                CopyTree(&(*dest)->right->left, src->left,  arena) == CopyError)
                 {
                 return DifferentiationError;
                 }
@@ -132,26 +148,26 @@ Error_t Differentiation(Node** dest, const Node* src)
             }
         case OP_DIV:
             {
-            if (NewNode(dest,                   OPERATION, div) == AllocationError ||
-                NewNode(&(*dest)->left,         OPERATION, sub) == AllocationError ||
-                NewNode(&(*dest)->left->left,   OPERATION, mul) == AllocationError ||
-                NewNode(&(*dest)->left->right,  OPERATION, mul) == AllocationError ||
-                NewNode(&(*dest)->right,        OPERATION, mul) == AllocationError)
+            if (NewNode(dest,                   OPERATION, div, arena) == AllocationError ||
+                NewNode(&(*dest)->left,         OPERATION, sub, arena) == AllocationError ||
+                NewNode(&(*dest)->left->left,   OPERATION, mul, arena) == AllocationError ||
+                NewNode(&(*dest)->left->right,  OPERATION, mul, arena) == AllocationError ||
+                NewNode(&(*dest)->right,        OPERATION, mul, arena) == AllocationError)
                 {
                 printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                 return DifferentiationError;
                 }
 
-            if (Differentiation(&(*dest)->left->left->left,   src->left)  == DifferentiationError ||
-                Differentiation(&(*dest)->left->right->right, src->right) == DifferentiationError)
+            if (Differentiation(&(*dest)->left->left->left,   src->left,  arena) == DifferentiationError ||
+                Differentiation(&(*dest)->left->right->right, src->right, arena) == DifferentiationError)
                 {
                 return DifferentiationError;
                 }
 
-            if (CopyTree(&(*dest)->left->left->right, src->right) == CopyError ||
-                CopyTree(&(*dest)->left->right->left, src->left)  == CopyError ||
-                CopyTree(&(*dest)->right->left,       src->right) == CopyError ||
-                CopyTree(&(*dest)->right->right,      src->right) == CopyError)
+            if (CopyTree(&(*dest)->left->left->right, src->right, arena) == CopyError ||
+                CopyTree(&(*dest)->left->right->left, src->left,  arena) == CopyError ||
+                CopyTree(&(*dest)->right->left,       src->right, arena) == CopyError ||
+                CopyTree(&(*dest)->right->right,      src->right, arena) == CopyError)
                 {
                 return DifferentiationError;
                 }
@@ -164,29 +180,29 @@ Error_t Differentiation(Node** dest, const Node* src)
             bool right_is_func = FindVariable(src->right);
             if (left_is_func && right_is_func)
                 {
-                if (NewNode(dest,                           OPERATION, mul) == AllocationError ||
-                    NewNode(&(*dest)->left,                 OPERATION, pow) == AllocationError ||
-                    NewNode(&(*dest)->right,                OPERATION, add) == AllocationError ||
-                    NewNode(&(*dest)->right->left,          OPERATION, mul) == AllocationError ||
-                    NewNode(&(*dest)->right->right,         OPERATION, mul) == AllocationError ||
-                    NewNode(&(*dest)->right->left->left,    OPERATION, div) == AllocationError ||
-                    NewNode(&(*dest)->right->right->right,  OPERATION, log) == AllocationError)
+                if (NewNode(dest,                           OPERATION, mul, arena) == AllocationError ||
+                    NewNode(&(*dest)->left,                 OPERATION, pow, arena) == AllocationError ||
+                    NewNode(&(*dest)->right,                OPERATION, add, arena) == AllocationError ||
+                    NewNode(&(*dest)->right->left,          OPERATION, mul, arena) == AllocationError ||
+                    NewNode(&(*dest)->right->right,         OPERATION, mul, arena) == AllocationError ||
+                    NewNode(&(*dest)->right->left->left,    OPERATION, div, arena) == AllocationError ||
+                    NewNode(&(*dest)->right->right->right,  OPERATION, log, arena) == AllocationError)
                     {
                     printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                     return DifferentiationError;
                     }
 
-                if (Differentiation(&(*dest)->right->left->left->left,  src->left)  == DifferentiationError ||
-                    Differentiation(&(*dest)->right->right->left,       src->right) == DifferentiationError)
+                if (Differentiation(&(*dest)->right->left->left->left,  src->left,  arena) == DifferentiationError ||
+                    Differentiation(&(*dest)->right->right->left,       src->right, arena) == DifferentiationError)
                     {
                     return DifferentiationError;
                     }
 
-                if (CopyTree(&(*dest)->left->left,                  src->left)  == CopyError ||
-                    CopyTree(&(*dest)->right->left->left->right,    src->left)  == CopyError ||
-                    CopyTree(&(*dest)->right->right->right->right,  src->left)  == CopyError ||
-                    CopyTree(&(*dest)->left->right,                 src->right) == CopyError ||
-                    CopyTree(&(*dest)->right->left->right,          src->right) == CopyError)
+                if (CopyTree(&(*dest)->left->left,                  src->left,  arena) == CopyError ||
+                    CopyTree(&(*dest)->right->left->left->right,    src->left,  arena) == CopyError ||
+                    CopyTree(&(*dest)->right->right->right->right,  src->left,  arena) == CopyError ||
+                    CopyTree(&(*dest)->left->right,                 src->right, arena) == CopyError ||
+                    CopyTree(&(*dest)->right->left->right,          src->right, arena) == CopyError)
                     {
                     return DifferentiationError;
                     }
@@ -195,29 +211,29 @@ Error_t Differentiation(Node** dest, const Node* src)
                 }
             if (left_is_func && !right_is_func)
                 {
-                if (NewNode(dest,                   OPERATION, mul) == AllocationError ||
-                    NewNode(&(*dest)->right,        OPERATION, mul) == AllocationError ||
-                    NewNode(&(*dest)->right->left,  OPERATION, pow) == AllocationError)
+                if (NewNode(dest,                   OPERATION, mul, arena) == AllocationError ||
+                    NewNode(&(*dest)->right,        OPERATION, mul, arena) == AllocationError ||
+                    NewNode(&(*dest)->right->left,  OPERATION, pow, arena) == AllocationError)
                     {
                     printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                     return DifferentiationError;
                     }
 
-                if (Differentiation(&(*dest)->right->right,     src->left) == DifferentiationError ||
-                    CopyTree(&(*dest)->right->left->left,       src->left) == CopyError)
+                if (Differentiation(&(*dest)->right->right,     src->left, arena) == DifferentiationError ||
+                    CopyTree(&(*dest)->right->left->left,       src->left, arena) == CopyError)
                     {
                     return DifferentiationError;
                     }
 
                 Data_t data = {.val = Eval(src->right, 0)};
-                if (NewNode(&(*dest)->left, VALUE, data) == AllocationError)
+                if (NewNode(&(*dest)->left, VALUE, data, arena) == AllocationError)
                     {
                     printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                     return DifferentiationError;
                     }
 
                 data.val -= 1;
-                if (NewNode(&(*dest)->right->left->right, VALUE, data) == AllocationError)
+                if (NewNode(&(*dest)->right->left->right, VALUE, data, arena) == AllocationError)
                     {
                     printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                     return DifferentiationError;
@@ -227,29 +243,29 @@ Error_t Differentiation(Node** dest, const Node* src)
                 }
             if (!left_is_func && right_is_func)
                 {
-                if (NewNode(dest,                   OPERATION, mul) == AllocationError ||
-                    NewNode(&(*dest)->left,         OPERATION, pow) == AllocationError ||
-                    NewNode(&(*dest)->right,        OPERATION, mul) == AllocationError ||
-                    NewNode(&(*dest)->right->left,  OPERATION, log) == AllocationError)
+                if (NewNode(dest,                   OPERATION, mul, arena) == AllocationError ||
+                    NewNode(&(*dest)->left,         OPERATION, pow, arena) == AllocationError ||
+                    NewNode(&(*dest)->right,        OPERATION, mul, arena) == AllocationError ||
+                    NewNode(&(*dest)->right->left,  OPERATION, log, arena) == AllocationError)
                     {
                     printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                     return DifferentiationError;
                     }
 
-                if (Differentiation(&(*dest)->right->right,  src->right) == DifferentiationError ||
-                    CopyTree(&(*dest)->left->right,          src->right) == CopyError)
+                if (Differentiation(&(*dest)->right->right,  src->right, arena) == DifferentiationError ||
+                    CopyTree(&(*dest)->left->right,          src->right, arena) == CopyError)
                     {
                     return DifferentiationError;
                     }
 
                 Data_t data = {.val = Eval(src->left, 0)};
-                if (NewNode(&(*dest)->left->left, VALUE, data) == AllocationError)
+                if (NewNode(&(*dest)->left->left, VALUE, data, arena) == AllocationError)
                     {
                     printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                     return DifferentiationError;
                     }
 
-                if (NewNode(&(*dest)->right->left->right, VALUE, data) == AllocationError)
+                if (NewNode(&(*dest)->right->left->right, VALUE, data, arena) == AllocationError)
                     {
                     printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                     return DifferentiationError;
@@ -260,7 +276,7 @@ Error_t Differentiation(Node** dest, const Node* src)
             else
                 {
                 Data_t data = {.val = 0};
-                if (NewNode(dest, VALUE, data) == AllocationError)
+                if (NewNode(dest, VALUE, data, arena) == AllocationError)
                     {
                     printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                     return DifferentiationError;
@@ -271,15 +287,15 @@ Error_t Differentiation(Node** dest, const Node* src)
             }
         case OP_SIN:
             {
-            if (NewNode(dest,           OPERATION, mul) == AllocationError ||
-                NewNode(&(*dest)->left, OPERATION, cos) == AllocationError)
+            if (NewNode(dest,           OPERATION, mul, arena) == AllocationError ||
+                NewNode(&(*dest)->left, OPERATION, cos, arena) == AllocationError)
                 {
                 printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                 return DifferentiationError;
                 }
 
-            if (Differentiation(&(*dest)->right,  src->right) == DifferentiationError ||
-                CopyTree(&(*dest)->left->right,   src->right) == CopyError)
+            if (Differentiation(&(*dest)->right,  src->right, arena) == DifferentiationError ||
+                CopyTree(&(*dest)->left->right,   src->right, arena) == CopyError)
                 {
                 return DifferentiationError;
                 }
@@ -288,22 +304,22 @@ Error_t Differentiation(Node** dest, const Node* src)
             }
         case OP_COS:
             {
-            if (NewNode(dest,                   OPERATION, mul) == AllocationError ||
-                NewNode(&(*dest)->left,         OPERATION, mul) == AllocationError ||
-                NewNode(&(*dest)->left->right,  OPERATION, sin) == AllocationError)
+            if (NewNode(dest,                   OPERATION, mul, arena) == AllocationError ||
+                NewNode(&(*dest)->left,         OPERATION, mul, arena) == AllocationError ||
+                NewNode(&(*dest)->left->right,  OPERATION, sin, arena) == AllocationError)
                 {
                 printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                 return DifferentiationError;
                 }
 
-            if (Differentiation(&(*dest)->right,        src->right) == DifferentiationError ||
-                CopyTree(&(*dest)->left->right->right,  src->right) == CopyError)
+            if (Differentiation(&(*dest)->right,        src->right, arena) == DifferentiationError ||
+                CopyTree(&(*dest)->left->right->right,  src->right, arena) == CopyError)
                 {
                 return DifferentiationError;
                 }
 
             Data_t data = {.val = -1};
-            if (NewNode(&(*dest)->left->left, VALUE, data) == AllocationError)
+            if (NewNode(&(*dest)->left->left, VALUE, data, arena) == AllocationError)
                 {
                 printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                 return DifferentiationError;
@@ -313,14 +329,14 @@ Error_t Differentiation(Node** dest, const Node* src)
             }
         case OP_LOG:
             {
-            if (NewNode(dest, OPERATION, div) == AllocationError)
+            if (NewNode(dest, OPERATION, div, arena) == AllocationError)
                 {
                 printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                 return DifferentiationError;
                 }
 
-            if (Differentiation(&(*dest)->left, src->right) == DifferentiationError ||
-                CopyTree(&(*dest)->right,       src->right) == CopyError)
+            if (Differentiation(&(*dest)->left, src->right, arena) == DifferentiationError ||
+                CopyTree(&(*dest)->right,       src->right, arena) == CopyError)
                 {
                 return DifferentiationError;
                 }
@@ -329,15 +345,15 @@ Error_t Differentiation(Node** dest, const Node* src)
             }
         case OP_EXP:
             {
-            if (NewNode(dest,           OPERATION, div) == AllocationError ||
-                NewNode(&(*dest)->left, OPERATION, exp) == AllocationError)
+            if (NewNode(dest,           OPERATION, div, arena) == AllocationError ||
+                NewNode(&(*dest)->left, OPERATION, exp, arena) == AllocationError)
                 {
                 printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                 return DifferentiationError;
                 }
 
-            if (Differentiation(&(*dest)->right,  src->right) == DifferentiationError ||
-                CopyTree(&(*dest)->left->right,   src->right) == CopyError)
+            if (Differentiation(&(*dest)->right,  src->right, arena) == DifferentiationError ||
+                CopyTree(&(*dest)->left->right,   src->right, arena) == CopyError)
                 {
                 return DifferentiationError;
                 }
@@ -346,22 +362,22 @@ Error_t Differentiation(Node** dest, const Node* src)
             }
         case OP_SQRT:
             {
-            if (NewNode(dest,                    OPERATION, div)  == AllocationError ||
-                NewNode(&(*dest)->right,         OPERATION, mul)  == AllocationError ||
-                NewNode(&(*dest)->right->right,  OPERATION, sqrt) == AllocationError)
+            if (NewNode(dest,                    OPERATION, div, arena)  == AllocationError ||
+                NewNode(&(*dest)->right,         OPERATION, mul, arena)  == AllocationError ||
+                NewNode(&(*dest)->right->right,  OPERATION, sqrt, arena) == AllocationError)
                 {
                 printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                 return DifferentiationError;
                 }
 
-            if (Differentiation(&(*dest)->left,         src->right) == DifferentiationError ||
-                CopyTree(&(*dest)->right->right->right, src->right) == CopyError)
+            if (Differentiation(&(*dest)->left,         src->right, arena) == DifferentiationError ||
+                CopyTree(&(*dest)->right->right->right, src->right, arena) == CopyError)
                 {
                 return DifferentiationError;
                 }
 
             Data_t data = {.val = 2};
-            if (NewNode(&(*dest)->right->left, VALUE, data) == AllocationError)
+            if (NewNode(&(*dest)->right->left, VALUE, data, arena) == AllocationError)
                 {
                 printf("Внимание: в связи с ошибкой дифференцирование дерева не завершилось.\n");
                 return DifferentiationError;
@@ -374,7 +390,10 @@ Error_t Differentiation(Node** dest, const Node* src)
     return Ok;
     }
 
-bool Simplifier(Node** node)
+// Сворачивает константы и применяет тождества к выражению. Поддерево
+// выбрасывается (0 * x, x ^ 0, ...) только если в нём нет вызовов, ввода
+// и присваиваний, поэтому упрощать можно и выражения программы.
+bool Simplifier(Node** node, NodeArena* arena)
     {
     assert(node  != NULL);
     if (!*node) return false;
@@ -383,100 +402,150 @@ bool Simplifier(Node** node)
 
     bool changed = false;
 
-    if (!FindVariable(*node))
+    if (IsConstant(*node))
         {
-        Data_t data = {.val = Eval(*node, 0)};
-
-        DeleteNode((*node)->left);
-        (*node)->left = nullptr;
-        DeleteNode((*node)->right);
-        (*node)->right = nullptr;
-
-        EditNode(*node, VALUE, data);
+        ReplaceWithValue(node, Eval(*node, 0), arena);
         return true;
         }
 
-    while (Simplifier(&(*node)->left))  changed = true;
-    while (Simplifier(&(*node)->right)) changed = true;
+    while (Simplifier(&(*node)->left, arena))  changed = true;
+    while (Simplifier(&(*node)->right, arena)) changed = true;
+
+    Node* left  = (*node)->left;
+    Node* right = (*node)->right;
 
     // 1 * x || 0 + x
-    if ( (*node)->left              && (*node)->left->type == VALUE &&
-        ((*node)->data.id == OP_MUL && (*node)->left->data.val == 1 ||
-         (*node)->data.id == OP_ADD && (*node)->left->data.val == 0))
+    if ((IsOperation(*node, OP_MUL) && IsValue(left, 1)) ||
+        (IsOperation(*node, OP_ADD) && IsValue(left, 0)))
         {
-        DeleteNode((*node)->left);
-        (*node)->left = nullptr;
-
-        Node* old_node = *node;
-        *node = (*node)->right;
-        free(old_node);
-
+        ReplaceWithChild(node, right, arena);
         return true;
         }
     // x * 1 || x + 0 || x ^ 1 || x - 0 || x / 1
-    if ( (*node)->right             && (*node)->right->type == VALUE &&
-        ((*node)->data.id == OP_MUL && (*node)->right->data.val == 1 ||
-         (*node)->data.id == OP_ADD && (*node)->right->data.val == 0 ||
-         (*node)->data.id == OP_POW && (*node)->right->data.val == 1 ||
-         (*node)->data.id == OP_SUB && (*node)->right->data.val == 0 ||
-         (*node)->data.id == OP_DIV && (*node)->right->data.val == 1))
+    if ((IsOperation(*node, OP_MUL) && IsValue(right, 1)) ||
+        (IsOperation(*node, OP_ADD) && IsValue(right, 0)) ||
+        (IsOperation(*node, OP_POW) && IsValue(right, 1)) ||
+        (IsOperation(*node, OP_SUB) && IsValue(right, 0)) ||
+        (IsOperation(*node, OP_DIV) && IsValue(right, 1)))
         {
-        DeleteNode((*node)->right);
-        (*node)->right = nullptr;
-
-        Node* old_node = *node;
-        *node = (*node)->left;
-        free(old_node);
-
+        ReplaceWithChild(node, left, arena);
         return true;
         }
-    // 0 * x || x * 0 || 0 ^ x
-    if ( (*node)->data.id == OP_MUL && (*node)->left->type  == VALUE && (*node)->left->data.val  == 0 ||
-         (*node)->data.id == OP_MUL && (*node)->right->type == VALUE && (*node)->right->data.val == 0 ||
-         (*node)->data.id == OP_POW && (*node)->left->type  == VALUE && (*node)->left->data.val == 0)
+    // 0 һәм x || x һәм 0. Умножение на 0 не упрощается: inf * 0 и NaN * 0 дают NaN,
+    // а константы и так сворачиваются
+    if (IsOperation(*node, OP_AND) &&
+        ((IsValue(left, 0) && IsPure(right)) || (IsValue(right, 0) && IsPure(left))))
         {
-        DeleteNode((*node)->left);
-        (*node)->left = nullptr;
-
-        DeleteNode((*node)->right);
-        (*node)->right = nullptr;
-
-        Data_t data = {.val = 0};
-        EditNode(*node, VALUE, data);
-
+        ReplaceWithValue(node, 0, arena);
         return true;
         }
     // x ^ 0 || 1 ^ x
-    if (  (*node)->data.id == OP_POW   &&
-        ((*node)->right->type == VALUE && (*node)->right->data.val == 0 ||
-         (*node)->left->type  == VALUE &&  (*node)->left->data.val == 1))
+    if (IsOperation(*node, OP_POW) &&
+        ((IsValue(right, 0) && IsPure(left)) || (IsValue(left, 1) && IsPure(right))))
         {
-        DeleteNode((*node)->left);
-        (*node)->left = nullptr;
-
-        DeleteNode((*node)->right);
-        (*node)->right = nullptr;
-
-        Data_t data = {.val = 1};
-        EditNode(*node, VALUE, data);
-
+        ReplaceWithValue(node, 1, arena);
+        return true;
+        }
+    // 1 әллә x || x әллә 1
+    if (IsOperation(*node, OP_OR) &&
+        ((IsValue(left, 1) && IsPure(right)) || (IsValue(right, 1) && IsPure(left))))
+        {
+        ReplaceWithValue(node, 1, arena);
         return true;
         }
     // x + (-y) || x - (-y)
-    if (((*node)->data.id == OP_ADD    || (*node)->data.id == OP_SUB) &&
-         (*node)->right->type == VALUE && (*node)->right->data.val < 0)
+    if ((IsOperation(*node, OP_ADD) || IsOperation(*node, OP_SUB)) &&
+         right && right->type == VALUE && right->data.val < 0)
         {
         Data_t data = {0};
-        data.id = ((*node)->data.id == OP_ADD) ? (OP_SUB) : (OP_ADD);
+        data.id = IsOperation(*node, OP_ADD) ? (OP_SUB) : (OP_ADD);
         EditNode(*node, OPERATION, data);
-        data.val = -1 * (*node)->right->data.val;
-        EditNode((*node)->right, VALUE, data);
+        data.val = -1 * right->data.val;
+        EditNode(right, VALUE, data);
         return true;
         }
 
     return changed;
     }
 
+static bool IsOperation(const Node* node, const int code)
+    {
+    return node && node->type == OPERATION && node->data.id == code;
+    }
+
+static bool IsValue(const Node* node, const double value)
+    {
+    return node && node->type == VALUE && !(node->data.val < value) && !(node->data.val > value);
+    }
+
+// log и exp Eval умеет, но их не умеет ни один бэкенд: свёрнутая программа
+// не должна проходить там, где несвёрнутая - ошибка
+static bool IsFoldable(const int code)
+    {
+    switch (code)
+        {
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_POW:
+        case OP_GREATER: case OP_LESS: case OP_GREATER_EQUAL:
+        case OP_LESS_EQUAL: case OP_EQUAL: case OP_NOT_EQUAL:
+        case OP_AND: case OP_OR: case OP_NOT:
+        case OP_SIN: case OP_COS: case OP_SQRT:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+// Только числа и операции, которые умеет Eval
+static bool IsConstant(const Node* node)
+    {
+    if (!node) return true;
+    if (node->type == VALUE) return true;
+    if (node->type != OPERATION || !IsFoldable(node->data.id)) return false;
+
+    return IsConstant(node->left) && IsConstant(node->right);
+    }
+
+// Вычисление без побочных эффектов: его можно выбросить
+static bool IsPure(const Node* node)
+    {
+    if (!node) return true;
+
+    switch (node->type)
+        {
+        case VALUE: case VARIABLE: case ARRAY:
+            return IsPure(node->right);
+        case OPERATION:
+            return IsFoldable(node->data.id) && IsPure(node->left) && IsPure(node->right);
+        default:
+            return false;
+        }
+    }
+
+static void ReplaceWithValue(Node** node, const double value, NodeArena* arena)
+    {
+    if ((*node)->left)  DeleteNode((*node)->left,  arena);
+    if ((*node)->right) DeleteNode((*node)->right, arena);
+    (*node)->left  = nullptr;
+    (*node)->right = nullptr;
+
+    Data_t data = {.val = value};
+    EditNode(*node, VALUE, data);
+    }
+
+// Узел заменяется ребёнком child, второй ребёнок удаляется
+static void ReplaceWithChild(Node** node, Node* child, NodeArena* arena)
+    {
+    Node* old_node = *node;
+    Node* other    = (old_node->left == child) ? old_node->right : old_node->left;
+
+    if (other) DeleteNode(other, arena);
+    old_node->left  = nullptr;
+    old_node->right = nullptr;
+    DeleteNode(old_node, arena);
+
+    *node = child;
+    }
+
 static bool FindAddSub(Node* node)
     {
     if (!node) return false;
@@ -9,7 +9,7 @@ const double PI = 3.1415926;
 const double MEASURE_ERROR = 0.000001;
 
 double Eval(const Node* node, double x);
-Error_t Differentiation(Node** dest, const Node* src);
-bool Simplifier(Node** node);
+Error_t Differentiation(Node** dest, const Node* src, NodeArena* arena);
+bool Simplifier(Node** node, NodeArena* arena);
 
 #endif // WOLFRAM_H